@@ -1,8 +1,8 @@
 #ifndef ADAPTIVE_COMPRESSION_H
 #define ADAPTIVE_COMPRESSION_H
 
+#include "ByteBuffer.h"
 #include "CompressionAlgorithm.h"
-#include "IdentityCompression.h"
 #include "RLECompression.h"
 
 /**
@@ -21,9 +21,16 @@ public:
     std::vector<char> compress(const std::vector<char>& data) override;
     std::vector<char> decompress(const std::vector<char>& data) override;
 
+    std::vector<char> compress(const char* data, size_t len);
+
+    /**
+     * @brief Decompress a shared buffer. An identity payload comes back as a slice of `data`
+     *        (dropping the tag byte is O(1)); only RLE payloads produce new bytes.
+     */
+    ByteBuffer decompress(const ByteBuffer& data);
+
 private:
     RLECompression rle;
-    IdentityCompression identity;
 };
 
 #endif
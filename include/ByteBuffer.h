@@ -0,0 +1,70 @@
+#ifndef BYTE_BUFFER_H
+#define BYTE_BUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Immutable, reference-counted byte range: a shared chunk plus offset and length.
+ *
+ * Copies and slices share the chunk, so handing bytes from the HTTP layer to a codec, a
+ * cache and back to the response (or dropping a one-byte header) costs a reference-count
+ * bump, not a memcpy. The chunk is freed with the last buffer that refers to it.
+ *
+ * A chunk is usually an adopted std::vector<char>, but may be any memory kept alive by an
+ * owner object (e.g. a SpoolFile mapping).
+ */
+class ByteBuffer {
+public:
+    ByteBuffer() = default;
+
+    /**
+     * @brief Adopt `bytes` without copying them (implicit, so vector-returning code converts).
+     */
+    ByteBuffer(std::vector<char>&& bytes);
+
+    /**
+     * @brief View of `size` bytes at `data`, valid as long as `owner` is alive.
+     */
+    ByteBuffer(std::shared_ptr<const void> owner, const char* data, size_t size);
+
+    static ByteBuffer copyOf(const char* data, size_t size);
+    static ByteBuffer copyOf(std::string_view bytes) { return copyOf(bytes.data(), bytes.size()); }
+
+    const char* data() const { return ptr; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    const char* begin() const { return ptr; }
+    const char* end() const { return ptr + length; }
+    char operator[](size_t i) const { return ptr[i]; }
+    std::string_view view() const { return std::string_view(ptr, length); }
+
+    /**
+     * @brief `length` bytes starting at `offset` (clamped to the end), sharing the chunk. O(1).
+     * @throws std::out_of_range if `offset` > size().
+     */
+    ByteBuffer slice(size_t offset, size_t length = static_cast<size_t>(-1)) const;
+
+    /**
+     * @brief This buffer, or a private copy of it if it is a small part of a larger chunk.
+     *
+     * For long-lived holders (caches): a slice keeps its whole chunk alive, so storing a
+     * 100-byte slice of a 100 MB request would pin the 100 MB.
+     */
+    ByteBuffer compact() const;
+
+    std::vector<char> toVector() const { return std::vector<char>(begin(), end()); }
+
+    bool operator==(const ByteBuffer& o) const { return view() == o.view(); }
+    bool operator!=(const ByteBuffer& o) const { return !(*this == o); }
+
+private:
+    std::shared_ptr<const void> owner;
+    const char* ptr = nullptr;
+    size_t length = 0;
+    size_t chunkBytes = 0; // size of the owner's chunk, for compact()
+};
+
+#endif
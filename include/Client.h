@@ -1,6 +1,9 @@
 #ifndef CLIENT_H
 #define CLIENT_H
 
+#include "SocketIo.h"
+#include "SocketOptions.h"
+
 #include <string>
 #include <vector>
 
@@ -8,18 +11,69 @@
  * @brief Simple TCP client wrapper.
  *
  * Encapsulates socket lifecycle (RAII-ish) and basic send/receive helpers.
+ * `host` is an IPv4 address, or "unix:/path/to.sock" ("unix:@name" for the Linux abstract
+ * namespace) to connect to a Unix domain socket listener; `port` is then ignored.
  */
 class Client {
 public:
-    Client(const std::string& host, int port);
+    Client(const std::string& host, int port, const SocketOptions& options = SocketOptions());
     ~Client();
 
     bool connect();
     void disconnect();
 
     bool sendData(const std::vector<char>& data);
+
+    /**
+     * @brief Send the whole contents of a file without staging it in user space.
+     *
+     * Uses sendfile(2) where the platform supports it (see SocketIo::sendFile).
+     * @return true if every byte of the file was sent.
+     */
+    bool sendFile(const std::string& path);
     std::vector<char> receiveData(size_t maxSize = 4096);
 
+    /**
+     * @brief Receive exactly `len` bytes straight into caller-owned memory.
+     *
+     * Use when the response length is known (e.g. from a length prefix): no intermediate
+     * buffers, and the kernel is asked for the whole remainder on every call.
+     * @return false on error or if the peer closed early.
+     */
+    bool receiveInto(char* data, size_t len);
+
+    /**
+     * @brief Fill `buffer` completely (buffer.size() bytes).
+     */
+    bool receiveInto(std::vector<char>& buffer);
+
+    /**
+     * @brief Receive what the kernel has buffered (waiting for at least one byte), up to `len`.
+     *
+     * For protocols that delimit their own messages (e.g. HTTP responses): read a chunk, parse
+     * it, and ask for more only when the message is incomplete.
+     * @return bytes received; 0 if the peer closed or the connection failed.
+     */
+    size_t receiveSome(char* data, size_t len);
+
+    /**
+     * @brief Gather-send several buffers with as few syscalls as possible (sendmsg/writev).
+     */
+    bool sendBuffers(const std::vector<SocketIo::ConstSlice>& slices);
+
+    /**
+     * @brief Scatter-receive exactly the total size of `slices`, filling each in order (recvmsg/readv).
+     */
+    bool receiveBuffers(const std::vector<SocketIo::Slice>& slices);
+
+    /**
+     * @brief Request SO_RCVBUF / SO_SNDBUF sizes (bytes; <= 0 keeps the kernel default).
+     *
+     * Applied immediately if connected and on every subsequent connect(). Larger buffers let
+     * bulk transfers complete in fewer, larger syscalls.
+     */
+    void setBufferSizes(int receiveBytes, int sendBytes);
+
     /**
      * @brief Half-close the connection for writing (send FIN) while keeping it open for reading.
      *
@@ -28,11 +82,37 @@ public:
      */
     bool shutdownWrite();
 
+    bool isConnected() const { return connected; }
+
+    /**
+     * @brief True if the peer has closed or reset the connection; checked without blocking.
+     *
+     * Lets a pool replace a kept-alive connection the server dropped while it sat idle,
+     * before a request is written to it.
+     */
+    bool peerClosed() const;
+
+    /**
+     * @brief Send one FrameProtocol frame (type 'D') carrying `payload`.
+     *
+     * Unlike sendData()/receiveData(), framed messages do not rely on peer-close,
+     * so the connection can be reused for further requests.
+     */
+    bool sendFrame(const std::vector<char>& payload);
+
+    /**
+     * @brief Receive one FrameProtocol frame.
+     * @param type Set to the frame type ('D' for data, 'E' for a server-side error).
+     * @return false on connection error or EOF.
+     */
+    bool receiveFrame(std::vector<char>& payload, char& type);
+
 private:
     std::string host;
     int port;
     int clientSocket;
     bool connected;
+    SocketOptions options;
 };
 
 #endif
@@ -0,0 +1,64 @@
+#ifndef CLIENT_POOL_H
+#define CLIENT_POOL_H
+
+#include "Client.h"
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Pool of persistent, framed connections to a FrameProtocol server.
+ *
+ * - Connections are opened eagerly (best-effort) so the first requests skip connect latency.
+ * - `submit()` queues a request; any idle connection picks it up, so concurrent requests
+ *   are spread over all pooled connections.
+ * - A pooled connection the server closed while idle is replaced before the request is
+ *   written, and a request whose send fails on a reused connection goes out once more on a
+ *   fresh one. A request that was sent is never repeated: if its response is lost, the
+ *   server may already have acted on it, so the failure goes to the caller.
+ * - Server-side failures ('E' frames) and connection errors are delivered as
+ *   std::runtime_error through the returned future.
+ */
+class ClientPool {
+public:
+    ClientPool(const std::string& host, int port, size_t connections = 4);
+    ~ClientPool();
+
+    ClientPool(const ClientPool&) = delete;
+    ClientPool& operator=(const ClientPool&) = delete;
+
+    std::future<std::vector<char>> submit(std::vector<char> payload);
+
+    /**
+     * @brief Finish queued requests, then close all connections. Called by the destructor.
+     */
+    void shutdown();
+
+    size_t size() const { return workers.size(); }
+
+private:
+    struct Job {
+        std::vector<char> payload;
+        std::promise<std::vector<char>> result;
+    };
+
+    std::string host;
+    int port;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<Job> queue;
+    bool stopping;
+    std::vector<std::thread> workers;
+
+    void workerLoop(std::shared_ptr<Client> conn);
+    static bool roundTrip(Client& conn, const std::vector<char>& payload, std::vector<char>& response, char& type,
+                          std::string& error);
+};
+
+#endif
@@ -2,7 +2,15 @@
 #define COMPRESSION_API_H
 
 #include "HttpTypes.h"
+#include "HttpServer.h"
 #include "AdaptiveCompression.h"
+#include "ResultCache.h"
+#include "WorkerPool.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
 
 /**
  * @brief HTTP handler that exposes compression/decompression endpoints.
@@ -10,15 +18,106 @@
  * Endpoints (binary body):
  * - POST /compress   -> returns compressed bytes (application/octet-stream)
  * - POST /decompress -> returns decompressed bytes (application/octet-stream)
+ * - POST /batch/compress, /batch/decompress -> many payloads in one request (below)
+ * - GET  /algorithms -> JSON description of the codecs and parameters below
+ * - GET  /health     -> "ok"
+ * - GET  /metrics    -> Prometheus text format (see Metrics)
+ * - GET  /debug/allocations -> allocation and copy counters as JSON (see Instrumentation)
+ *
+ * Uses AdaptiveCompression by default (RLE when beneficial, otherwise identity). Callers that
+ * know their data can force a codec, and tune it, for /compress and /batch/compress (see
+ * CodecParams); the output is always AdaptiveCompression's tagged container, so
+ * /decompress needs no parameters.
+ * Large or chunked uploads can instead be piped through the streaming codecs with
+ * handleStream(), keeping memory use independent of the payload size.
+ * Bodies HttpServer spooled to disk (HttpRequest::spooledBody) are run through the same
+ * streaming codecs into another temp file, which becomes the response's bodyFile; they
+ * bypass the cache.
  *
- * Uses AdaptiveCompression by default (RLE when beneficial, otherwise identity).
+ * Buffered /compress and /decompress results are cached by content hash (see ResultCache):
+ * responses carry an ETag derived from the request body, a matching If-None-Match gets a
+ * 304 without running the codec, and a repeated body is answered from the cache. Streamed
+ * responses cannot carry an ETag, so handleStream() leaves cacheable sizes to handle().
+ *
+ * Batch framing (all lengths 32-bit big-endian):
+ * - request:  zero or more items `[length][bytes]`, back to back
+ * - response: one entry per item, in request order: `[status][length][bytes]`, where
+ *   status is kBatchOk (bytes = result) or kBatchError (bytes = UTF-8 error message).
+ * Items are spread over the worker pool (setWorkerPool), so one client can use every core;
+ * a malformed item fails only its own entry, malformed framing fails the request (400).
  */
 class CompressionApi {
 public:
+    static constexpr size_t kDefaultCacheBytes = 64 * 1024 * 1024;
+    static constexpr size_t kMaxBatchItems = 100000;
+    static constexpr unsigned char kBatchOk = 0;
+    static constexpr unsigned char kBatchError = 1;
+
+    /**
+     * @param cacheBytes result cache budget; 0 disables caching (ETags are still sent).
+     */
+    explicit CompressionApi(size_t cacheBytes = kDefaultCacheBytes);
+
+    /**
+     * @brief Codec selection: query parameters `algorithm`, `level` and `block`, or headers
+     *        X-Compression-Algorithm, X-Compression-Level and X-Compression-Block-Size (the
+     *        query wins). Fields a codec does not use are 0.
+     */
+    struct CodecParams {
+        std::string algorithm = "adaptive";
+        int level = 0;
+        size_t blockSize = 0;
+    };
+
+    /**
+     * @brief Validated parameters of `req`, with codec defaults filled in.
+     * @throws std::invalid_argument for unknown codecs or unsupported/out-of-range values.
+     */
+    static CodecParams codecParams(const HttpRequest& req);
+
+    /**
+     * @brief Pool used to fan out batch items; without one, batches run on the calling thread.
+     */
+    void setWorkerPool(std::shared_ptr<WorkerPool> pool);
+
+    /**
+     * @brief Where results of spooled requests are written (empty = $TMPDIR or /tmp).
+     */
+    void setSpoolDirectory(std::string directory);
+
     HttpResponse handle(const HttpRequest& req) const;
 
+    /**
+     * @brief HttpServer::PreflightHandler: refuses, from the head alone, what handle() would
+     *        refuse anyway (405 wrong method, 404 unknown path, 400 bad codec parameters).
+     */
+    bool preflight(const HttpRequest& req, HttpResponse& rejection) const;
+
+    /**
+     * @brief Make this API `server`'s Handler, PreflightHandler and StreamHandler (what
+     *        http_server runs). The API must outlive the server.
+     */
+    void install(HttpServer& server) const;
+
+    /**
+     * @brief HttpServer::StreamHandler for POST /compress and /decompress; declines anything else,
+     *        and bodies with a Content-Length small enough for their result to be cached.
+     */
+    bool handleStream(const HttpRequest& req, HttpBodyReader& in, HttpResponseWriter& out) const;
+
 private:
     mutable AdaptiveCompression algo;
+    std::unique_ptr<ResultCache> cache;
+    std::shared_ptr<WorkerPool> pool;
+    std::string spoolDirectory;
+
+    HttpResponse respond(const HttpRequest& req) const;
+    HttpResponse runCodec(const HttpRequest& req, bool compressing) const;
+    HttpResponse runBatch(const HttpRequest& req, bool compressing) const;
+    ByteBuffer transform(const ByteBuffer& input, bool compressing, const CodecParams& params,
+                         const ResultCache::Key& key) const;
+    std::shared_ptr<SpoolFile> transformToFile(std::string_view input, bool compressing,
+                                               const CodecParams& params) const;
 };
 
 #endif
@@ -0,0 +1,49 @@
+#ifndef FRAME_PROTOCOL_H
+#define FRAME_PROTOCOL_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Length-prefixed message framing for persistent TCP connections.
+ *
+ * The raw Server/Client pair treats peer-close as "end of message", which costs one
+ * connection per request. Framing lets many requests share a connection.
+ *
+ * Wire format (both directions):
+ *   [1 byte type][4 byte big-endian payload length][payload...]
+ * - 'D' => data (request payload, or a successful response)
+ * - 'E' => error response; payload is a human-readable message
+ */
+class FrameProtocol {
+public:
+    static constexpr char kData = 'D';
+    static constexpr char kError = 'E';
+    static constexpr size_t kHeaderSize = 5;
+    static constexpr uint32_t kMaxPayload = 256u * 1024u * 1024u;
+
+    using Processor = std::function<std::vector<char>(const std::vector<char>&)>;
+
+    /**
+     * @brief Write one frame.
+     * @return false if the connection failed.
+     */
+    static bool writeFrame(int sock, char type, const std::vector<char>& payload);
+
+    /**
+     * @brief Read one frame.
+     * @return false on EOF, connection error or a malformed/oversized header.
+     */
+    static bool readFrame(int sock, char& type, std::vector<char>& payload);
+
+    /**
+     * @brief Build a Server handler that answers every 'D' frame with `fn(payload)`
+     * until the client closes the connection.
+     *
+     * Exceptions thrown by `fn` are returned to the client as 'E' frames; the connection stays open.
+     */
+    static std::function<void(int)> makeHandler(Processor fn);
+};
+
+#endif
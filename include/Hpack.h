@@ -0,0 +1,119 @@
+#ifndef HPACK_H
+#define HPACK_H
+
+#include "HttpTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * @brief HPACK Huffman code (RFC 7541 Appendix B).
+ */
+class HpackHuffman {
+public:
+    static size_t encodedSize(std::string_view s);
+    static void encode(std::string_view s, std::string& out);
+
+    /**
+     * @brief Append the decoding of `len` bytes at `data` to `out`.
+     * @return false if the input is not a valid encoding (EOS inside, bad padding).
+     */
+    static bool decode(const char* data, size_t len, std::string& out);
+};
+
+/**
+ * @brief HPACK dynamic table: newest entry first, evicted oldest-first to stay within maxSize.
+ *
+ * Entry sizes are counted as RFC 7541 4.1 defines them (name + value + 32).
+ */
+class HpackTable {
+public:
+    static constexpr size_t kStaticEntries = 61;
+
+    explicit HpackTable(size_t maxSize) : maxBytes(maxSize) {}
+
+    void insert(std::string_view name, std::string_view value);
+    void setMaxSize(size_t bytes);
+    size_t maxSize() const { return maxBytes; }
+    size_t size() const { return bytes; }
+    size_t count() const { return entries.size(); }
+
+    /**
+     * @brief Entry `index` of the combined address space: 1..61 static, 62.. dynamic.
+     * @throws std::runtime_error if there is no such entry.
+     */
+    std::pair<std::string_view, std::string_view> get(size_t index) const;
+
+    /**
+     * @brief Index of an entry equal to `name: value` (0 if none); `nameIndex` receives the
+     * index of an entry with that name (0 if none).
+     */
+    size_t find(std::string_view name, std::string_view value, size_t& nameIndex) const;
+
+private:
+    std::deque<std::pair<std::string, std::string>> entries;
+    size_t bytes = 0;
+    size_t maxBytes;
+
+    void evictTo(size_t limit);
+};
+
+/**
+ * @brief Decodes HTTP/2 header blocks (one decoder per connection, blocks in arrival order).
+ */
+class HpackDecoder {
+public:
+    explicit HpackDecoder(size_t maxTableSize = 4096) : table(maxTableSize), settingsMax(maxTableSize) {}
+
+    /**
+     * @brief Decode a complete header block and append its fields to `out`.
+     *
+     * Fields beyond `maxListSize` bytes (RFC 7540 SETTINGS_MAX_HEADER_LIST_SIZE accounting)
+     * are still decoded, to keep the table in sync with the peer, but not appended.
+     * @return false if fields were dropped because of `maxListSize`.
+     * @throws std::runtime_error on malformed input (an HTTP/2 COMPRESSION_ERROR).
+     */
+    bool decode(const char* data, size_t len, HttpHeaders& out, size_t maxListSize);
+
+private:
+    HpackTable table;
+    size_t settingsMax;
+};
+
+/**
+ * @brief Encodes HTTP/2 header blocks (one encoder per connection, blocks in sending order).
+ *
+ * Repeated fields (content types, CORS headers) are entered into the dynamic table and cost
+ * one byte on later responses; per-response values such as content-length are sent as
+ * literals so they do not churn the table. Strings are Huffman-coded when that is shorter.
+ */
+class HpackEncoder {
+public:
+    explicit HpackEncoder(size_t maxTableSize = 4096) : table(maxTableSize) {}
+
+    /**
+     * @brief Peer's SETTINGS_HEADER_TABLE_SIZE; announced at the start of the next block.
+     */
+    void setMaxTableSize(size_t bytes);
+
+    /**
+     * @brief Start a header block in `out` (emits pending table size updates).
+     */
+    void beginBlock(std::string& out);
+
+    /**
+     * @brief Append one field; `name` must already be lowercase.
+     */
+    void add(std::string_view name, std::string_view value, std::string& out);
+
+private:
+    HpackTable table;
+    size_t pendingMinSize = SIZE_MAX; // smallest size set since the last block
+    bool sizeChanged = false;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef HTTP2_SESSION_H
+#define HTTP2_SESSION_H
+
+#include "Hpack.h"
+#include "HttpServer.h"
+#include "HttpTypes.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class WorkerPool;
+
+/**
+ * @brief One cleartext HTTP/2 connection (h2c, RFC 9113) of HttpServer.
+ *
+ * Entered either with prior knowledge (the connection starts with the client preface) or
+ * after answering an HTTP/1.1 `Upgrade: h2c` request with 101, in which case that request
+ * becomes stream 1. Requests are dispatched to the same Handler as HTTP/1.x, on the compute
+ * pool, as soon as their stream is complete, so one connection carries many requests at once
+ * and a slow one does not hold up the others.
+ *
+ * The connection thread reads and parses frames; a writer thread sends responses, sharing
+ * the connection among ready streams a frame at a time within the peer's flow-control
+ * windows. Request bodies are buffered in memory (no spooling or StreamHandler) and count
+ * against the server's in-flight byte budget; receive windows are returned as data arrives.
+ */
+class Http2Session {
+public:
+    Http2Session(int sock, const HttpServerOptions& options, WorkerPool& compute, const HttpServer::Handler& handler,
+                 const HttpServer::PreflightHandler& preflight, const std::atomic<bool>& running,
+                 std::atomic<size_t>& inFlightBytes);
+    ~Http2Session();
+
+    Http2Session(const Http2Session&) = delete;
+    Http2Session& operator=(const Http2Session&) = delete;
+
+    /**
+     * @brief Serve the connection until it is closed.
+     * @param buffer    bytes received so far, starting with the client connection preface
+     * @param upgraded  the HTTP/1.1 request that asked for h2c (answered on stream 1), or null
+     */
+    void run(std::string buffer, HttpRequest* upgraded);
+
+private:
+    // A request whose headers arrived and whose body is still being received.
+    struct Incoming {
+        HttpRequest req;
+        std::vector<char> body;
+        size_t maxBody = 0;
+        int64_t window = 0;  // receive window left
+        size_t unacked = 0;  // bytes received since the last WINDOW_UPDATE
+        size_t reserved = 0; // share of inFlightBytes
+    };
+
+    // A response being sent.
+    struct Outgoing {
+        uint32_t id;
+        HttpResponse head;
+        ByteBuffer body;
+        size_t offset = 0;
+        bool headersSent = false;
+        bool resetAfter = false; // request body was not read: RST_STREAM(NO_ERROR) when done
+    };
+
+    int sock;
+    const HttpServerOptions& options;
+    WorkerPool& compute;
+    const HttpServer::Handler& handler;
+    const HttpServer::PreflightHandler& preflight;
+    const std::atomic<bool>& running;
+    std::atomic<size_t>& inFlightBytes;
+
+    // Connection thread only.
+    HpackDecoder decoder;
+    std::unordered_map<uint32_t, Incoming> incoming;
+    uint32_t lastStreamId = 0;
+    std::string headerBlock;      // HEADERS + CONTINUATION fragments being collected
+    uint32_t headerStream = 0;    // stream of headerBlock (0 = none)
+    bool headerEndStream = false;
+    int64_t connectionWindow = 0; // receive window left
+    size_t connectionUnacked = 0;
+    bool peerGoingAway = false;
+
+    // Shared with the writer thread and with handler jobs; guarded by `mutex`.
+    std::mutex mutex;
+    std::condition_variable writerWake;
+    std::condition_variable progress;
+    std::string control;          // serialized control frames, sent before anything else
+    std::list<Outgoing> ready;
+    std::unordered_map<uint32_t, int64_t> sendWindows; // open streams awaiting (the rest of) a response
+    int64_t connectionSendWindow = 65535;
+    int64_t peerInitialWindow = 65535;
+    size_t peerMaxFrame = 16384;
+    size_t pendingJobs = 0;
+    bool closing = false;
+    bool broken = false;
+    HpackEncoder encoder;
+    std::thread writer;
+
+    bool parseFrame(const std::string& buffer, size_t& pos);
+    void onHeaders(uint32_t id, uint8_t flags, const char* payload, size_t len);
+    void onHeaderBlock();
+    void onData(uint32_t id, uint8_t flags, const char* payload, size_t len);
+    void onSettings(uint8_t flags, const char* payload, size_t len);
+    void onWindowUpdate(uint32_t id, const char* payload, size_t len);
+    void applySetting(uint16_t id, uint32_t value);
+
+    void openStream(uint32_t id, HttpRequest req, bool endStream, size_t headerBytes);
+    void dispatch(uint32_t id, Incoming stream);
+    void respond(uint32_t id, HttpResponse res, bool resetAfter);
+    void resetStream(uint32_t id, uint32_t errorCode);
+    void releaseInFlight(size_t bytes);
+    void queueControl(uint8_t type, uint8_t flags, uint32_t id, const char* payload, size_t len);
+
+    void writerLoop();
+    bool sendable() const;
+    void appendHeaders(Outgoing& out, std::string& wire);
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include "HttpTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief Incremental HTTP/1.x request-head parser (request line + header fields).
+ *
+ * A byte-at-a-time state machine: parse() is called with the whole receive buffer each time
+ * more bytes arrive and resumes exactly where it stopped, so no byte is scanned twice and
+ * nothing is copied or allocated while parsing. Results are offsets into the buffer, exposed
+ * as string_views over the buffer passed to the latest parse() call; they stay valid as long
+ * as that buffer's first headerBytes() bytes are neither moved nor modified.
+ */
+class HttpRequestParser {
+public:
+    static constexpr size_t kMaxHeaders = 64;
+
+    enum class Result { Incomplete, Complete, Error };
+
+    /**
+     * @brief Continue parsing `buf[0, len)`. The buffer may have moved and grown since the
+     * previous call, but its already-parsed prefix must be unchanged.
+     */
+    Result parse(const char* buf, size_t len);
+
+    /**
+     * @brief Start over for the next request (call after consuming headerBytes()).
+     */
+    void reset();
+
+    /**
+     * @brief Size of the request head including the terminating blank line (after Complete).
+     */
+    size_t headerBytes() const { return position; }
+
+    std::string_view method() const { return view(methodSpan); }
+    std::string_view target() const { return view(targetSpan); }
+    std::string_view version() const { return view(versionSpan); }
+
+    size_t headerCount() const { return count; }
+    HttpHeaders::Field header(size_t i) const { return {view(fields[i].name), view(fields[i].value)}; }
+
+    /**
+     * @brief First value of header `name` (case-insensitive), or an empty view.
+     */
+    std::string_view find(std::string_view name) const;
+
+    /**
+     * @brief Why parsing failed (after Error).
+     */
+    const char* error() const { return errorText; }
+
+    /**
+     * @brief Copy the parsed head into `req` (method, path, version, headers); one arena
+     * allocation for all header bytes.
+     */
+    void fill(HttpRequest& req) const;
+
+private:
+    struct Span {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+    struct Field {
+        Span name;
+        Span value;
+    };
+    enum class State {
+        Method,
+        Target,
+        Version,
+        RequestLineLf,
+        LineStart,
+        Name,
+        ValueStart,
+        Value,
+        FieldLf,
+        FinalLf,
+        Done,
+        Failed
+    };
+
+    const char* base = nullptr;
+    size_t position = 0;
+    State state = State::Method;
+    Span methodSpan;
+    Span targetSpan;
+    Span versionSpan;
+    Field fields[kMaxHeaders];
+    size_t count = 0;
+    size_t tokenStart = 0;
+    size_t valueEnd = 0; // one past the last non-whitespace value byte
+    const char* errorText = "";
+
+    std::string_view view(const Span& s) const { return std::string_view(base + s.offset, s.length); }
+    Span span(size_t from, size_t to) const {
+        return Span{static_cast<uint32_t>(from), static_cast<uint32_t>(to - from)};
+    }
+    Result fail(const char* why);
+};
+
+#endif
@@ -2,10 +2,92 @@
 #define HTTP_SERVER_H
 
 #include "HttpTypes.h"
+#include "SocketOptions.h"
+#include "WorkerPool.h"
 
 #include <atomic>
+#include <condition_variable>
+#include <cstddef>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <unordered_set>
+#include <vector>
+
+class ZeroCopySender;
+
+/**
+ * @brief Size limits for one route, overriding the server-wide ones (0 = use those).
+ */
+struct HttpRouteLimits {
+    std::string path; // exact request path, or a prefix if it ends with '/'
+    size_t maxHeaderBytes = 0;
+    size_t maxBodyBytes = 0;
+};
+
+/**
+ * @brief HTTP-level behavior of HttpServer (socket tuning lives in SocketOptions).
+ */
+struct HttpServerOptions {
+    bool keepAlive = true;                  // allow persistent connections at all
+    int idleTimeoutMs = 5000;               // close a kept-alive connection idle this long
+    size_t maxRequestsPerConnection = 1000; // close after this many responses (0 = unlimited)
+    size_t maxHeaderBytes = 64 * 1024;      // request line + headers
+    size_t maxBodyBytes = 0;                // larger bodies get 413 (0 = unlimited)
+    std::vector<HttpRouteLimits> routeLimits; // first matching entry wins
+    // Slow-client protection (0 = no limit). headerTimeoutMs bounds receiving a whole request
+    // head; bodyTimeoutMs and writeTimeoutMs bound each wait for body bytes or send-buffer
+    // space, so a stalled peer cannot pin a connection thread (or the compute thread running its
+    // stream handler). Timeouts are answered with 408.
+    int headerTimeoutMs = 10000;
+    int bodyTimeoutMs = 30000;
+    int writeTimeoutMs = 30000;
+    // Chunked uploads, and bodies with at least this Content-Length, are offered to the
+    // stream handler (if one is set) instead of being buffered. Above spoolThreshold (below),
+    // so known-length bodies are kept in memory, then spooled, and only the largest streamed.
+    size_t streamThreshold = 64 * 1024 * 1024;
+    // Regular handlers run on a WorkerPool of this many threads (0 = one per core), not on
+    // the connection threads; requests with a body below computeSmallJobBytes jump the queue.
+    size_t computeThreads = 0;
+    size_t computeSmallJobBytes = 64 * 1024;
+    // Use this pool instead of creating one (e.g. to share it with CompressionApi batches).
+    std::shared_ptr<WorkerPool> computePool;
+    // Buffered bodies larger than this go to an unlinked temp file (HttpRequest::spooledBody)
+    // instead of the heap; so does any body once in-memory bodies of all connections together
+    // would exceed maxBufferedBodyBytes. Empty spoolDirectory = $TMPDIR or /tmp.
+    size_t spoolThreshold = 8 * 1024 * 1024;
+    size_t maxBufferedBodyBytes = 256 * 1024 * 1024;
+    std::string spoolDirectory;
+    // Overload protection: request heads plus bodies (in memory or spooled) of all requests
+    // being received or handled may not exceed maxInFlightBytes, and at most maxConnections
+    // connections are served (0 = unlimited). Beyond either, clients get 503 with
+    // Retry-After: retryAfterSeconds instead of the server running out of memory or threads.
+    size_t maxInFlightBytes = static_cast<size_t>(1) << 30;
+    size_t maxConnections = 4096;
+    int retryAfterSeconds = 1;
+    // In-memory response bodies of at least this size are sent with MSG_ZEROCOPY (Linux, TCP;
+    // 0 = off). The body is kept alive until the kernel reports it sent; where the kernel
+    // would copy anyway (loopback, no scatter-gather NIC) the connection falls back to send().
+    size_t zeroCopyThreshold = 0;
+    // Cleartext HTTP/2 (h2c), by prior knowledge or `Upgrade: h2c` (see Http2Session). A
+    // connection carries up to http2MaxStreams requests at once; each may have
+    // http2StreamWindow body bytes in transit before the client waits for a WINDOW_UPDATE.
+    bool http2 = true;
+    size_t http2MaxStreams = 256;
+    size_t http2StreamWindow = 1024 * 1024;
+    // Per-request phase timings (see RequestTrace), for HTTP/1.x requests. serverTiming adds a
+    // Server-Timing header to buffered responses; traceLog, if set, gets one JSON line per
+    // request once its response is sent. With both off no trace is kept and no clock is read.
+    bool serverTiming = false;
+    std::function<void(const std::string&)> traceLog;
+
+    /**
+     * @brief The first routeLimits entry matching `path`, or null.
+     */
+    const HttpRouteLimits* limitsFor(const std::string& path) const;
+};
 
 /**
  * @brief Tiny HTTP/1.1 server built on TCP sockets (no external deps).
@@ -13,29 +95,92 @@
  * Design goals:
  * - Modular: the server only parses HTTP and delegates to a handler.
  * - Binary-safe: request/response bodies are raw bytes.
- * - Simple: supports a single request per connection (sufficient for API usage).
+ * - Persistent connections: HTTP/1.1 keep-alive (HTTP/1.0 opt-in) with pipelining; requests
+ *   on one connection are answered strictly in order. Bytes received past the end of one
+ *   request are kept as the start of the next.
+ * - Streaming: Transfer-Encoding: chunked request bodies are decoded; large or chunked
+ *   uploads can go to a StreamHandler, whose output is sent chunked once it outgrows a buffer.
+ * - Executor boundary: connection threads only do I/O and parsing; the Handler runs on a
+ *   core-sized WorkerPool that favours small requests, so a few huge jobs neither starve
+ *   tiny ones nor oversubscribe the CPU. Stream handlers interleave codec work with socket
+ *   reads, so each runs there as one large job for the whole request.
+ * - Early rejection: `Expect: 100-continue` is answered with 100 only once the head passed
+ *   the size limits and the PreflightHandler and the body is actually wanted; otherwise the
+ *   final status goes out before the client sends a single body byte.
+ * - Bounded resources: every read and write has a deadline (408 when it expires), sizes are
+ *   capped per route (413/431), and requests beyond the connection or in-flight byte budget
+ *   are shed with 503 + Retry-After, so overload degrades into retries rather than failure.
+ * - HTTP/2: cleartext h2c, by prior knowledge or `Upgrade: h2c`, multiplexes many requests
+ *   on one connection into the same Handler (see Http2Session).
+ * - Tracing: opt-in per-request phase timings (recv, parse, body, queue, handler phases,
+ *   send) in a Server-Timing header and/or a JSON log line.
  */
 class HttpServer {
 public:
     using Handler = std::function<HttpResponse(const HttpRequest&)>;
 
-    explicit HttpServer(int port);
+    /**
+     * @brief Handler for bodies that should not be buffered (see HttpServerOptions::streamThreshold).
+     *
+     * Receives the request with an empty `body`, reads the body from `in` and produces the
+     * response through `out` (start, write..., finish). Returning false declines the request;
+     * it must then not have read from `in`, and the regular Handler gets the buffered body.
+     * Runs on the compute pool as a large job whatever the body size (see WorkerPool): streams
+     * share the large-job cap with big buffered requests and never take the worker kept for
+     * small ones.
+     */
+    using StreamHandler = std::function<bool(const HttpRequest&, HttpBodyReader& in, HttpResponseWriter& out)>;
+
+    /**
+     * @brief Check run on every request head before any of its body is read.
+     *
+     * Returning false refuses the request with `rejection` (e.g. 404, 405, 400) instead of
+     * receiving a body that would be thrown away; a client waiting on `Expect: 100-continue`
+     * then never sends it. Returning true proceeds as usual (`rejection` is ignored).
+     */
+    using PreflightHandler = std::function<bool(const HttpRequest& head, HttpResponse& rejection)>;
+
+    explicit HttpServer(int port, const SocketOptions& options = SocketOptions(),
+                        const HttpServerOptions& httpOptions = HttpServerOptions());
     ~HttpServer();
 
     void setHandler(Handler handler);
+    void setStreamHandler(StreamHandler handler);
+    void setPreflightHandler(PreflightHandler handler);
 
     void start();
+
+    /**
+     * @brief Stop accepting, shut down open connections and wait for their threads to finish.
+     */
     void stop();
 
 private:
     int port;
-    int serverSocket;
+    SocketOptions options;
+    HttpServerOptions httpOptions;
+    std::vector<int> listeners;
     std::atomic<bool> running;
     std::thread serverThread;
     Handler handler;
+    StreamHandler streamHandler;
+    PreflightHandler preflightHandler;
+    std::shared_ptr<WorkerPool> compute;
+
+    // Open client connections, so stop() can wake and wait for kept-alive ones.
+    std::mutex connectionsMutex;
+    std::condition_variable connectionsDrained;
+    std::unordered_set<int> connections;
+
+    // Request body bytes currently held in memory, across all connections.
+    std::atomic<size_t> bufferedBodyBytes{0};
+    // Head and body bytes of all requests currently in flight (see maxInFlightBytes).
+    std::atomic<size_t> inFlightBytes{0};
 
     void acceptLoop();
     void handleClient(int clientSocket);
+    bool serveOne(int clientSocket, std::string& buffer, std::string& head, size_t served,
+                  std::unique_ptr<ZeroCopySender>& zeroCopy);
 };
 
 #endif
@@ -1,10 +1,88 @@
 #ifndef HTTP_TYPES_H
 #define HTTP_TYPES_H
 
+#include "ByteBuffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+/**
+ * @brief Small flat header list with case-insensitive lookup.
+ *
+ * Names and values live back to back in one arena string; entries are offsets into it, so a
+ * request's headers cost two allocations in total however many there are. Lookups are a
+ * linear scan, which beats hashing for the handful of headers HTTP messages carry.
+ * Insertion order is preserved (and used when serializing responses).
+ */
+class HttpHeaders {
+public:
+    using Field = std::pair<std::string_view, std::string_view>;
+
+    /**
+     * @brief Replace every field named `name` (any case) with a single `name: value`.
+     */
+    void set(std::string_view name, std::string_view value);
+
+    /**
+     * @brief Append a field without looking for an existing one (parsers, repeated fields).
+     */
+    void add(std::string_view name, std::string_view value);
+
+    /**
+     * @brief Value of the first field named `name` (any case), or an empty view.
+     */
+    std::string_view get(std::string_view name) const;
+    bool has(std::string_view name) const;
+
+    /**
+     * @brief Remove every field named `name` (any case).
+     * @return true if something was removed.
+     */
+    bool erase(std::string_view name);
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+    Field at(size_t i) const;
+    void clear();
+    void reserve(size_t fields, size_t bytes);
+
+    class const_iterator {
+    public:
+        const_iterator(const HttpHeaders* owner, size_t index) : owner(owner), index(index) {}
+        Field operator*() const { return owner->at(index); }
+        const_iterator& operator++() {
+            ++index;
+            return *this;
+        }
+        bool operator!=(const const_iterator& o) const { return index != o.index; }
+
+    private:
+        const HttpHeaders* owner;
+        size_t index;
+    };
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, entries.size()); }
+
+    static bool equalsIgnoreCase(std::string_view a, std::string_view b);
+
+private:
+    struct Entry {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t valueOffset;
+        uint32_t valueLength;
+    };
+    std::string arena;
+    std::vector<Entry> entries;
+};
+
+class SpoolFile;
+
 /**
  * @brief Minimal HTTP request/response types for our embedded API server.
  *
@@ -13,17 +91,82 @@
  */
 struct HttpRequest {
     std::string method;   // "POST"
-    std::string path;     // "/compress"
+    std::string path;     // "/compress" (request target up to '?')
+    std::string query;    // "algorithm=rle&level=1" (after '?', still encoded)
     std::string version;  // "HTTP/1.1"
-    std::unordered_map<std::string, std::string> headers;
-    std::vector<char> body;
+    HttpHeaders headers;
+    // Shared, so handlers can slice it or pass it on (e.g. into a response) without copying.
+    ByteBuffer body;
+    // Set for large uploads (see HttpServerOptions::spoolThreshold): `body` is then a view of
+    // this unlinked temp file's mapping rather than heap memory.
+    std::shared_ptr<const SpoolFile> spooledBody;
+
+    std::string_view bodyView() const { return body.view(); }
+
+    /**
+     * @brief Percent- and '+'-decoded value of the first `name=` parameter in `query`.
+     * @return false if the parameter is absent (a bare `name` yields true and "").
+     */
+    bool queryParam(std::string_view name, std::string& value) const;
 };
 
 struct HttpResponse {
     int statusCode = 200;
     std::string statusText = "OK";
-    std::unordered_map<std::string, std::string> headers;
+    HttpHeaders headers;
+    // Preformatted "Name: value\r\n" lines sent verbatim after `headers`, for header sets that
+    // never change (CORS, content types). Not copied: must point at storage that outlives the
+    // response, typically a static constant. Must not contain framing headers.
+    std::string_view presetHeaders;
     std::vector<char> body;
+    // If non-empty, sent instead of `body`: bytes shared with someone else (a cache entry, the
+    // request), so serving them needs no copy.
+    ByteBuffer sharedBody;
+    // If set, the response body is this file's content (sent with sendfile) and the two above
+    // are ignored.
+    std::shared_ptr<const SpoolFile> bodyFile;
+
+    /**
+     * @brief The body bytes, wherever they live (a file body must have been mapped).
+     */
+    std::string_view bodyView() const;
+    size_t bodySize() const;
+};
+
+/**
+ * @brief Pull interface over a request body that is still arriving on the socket.
+ *
+ * Hides the transfer framing: Content-Length and chunked bodies both read as plain bytes.
+ */
+class HttpBodyReader {
+public:
+    virtual ~HttpBodyReader() = default;
+
+    /**
+     * @brief Read up to `max` body bytes into `dst`.
+     * @return bytes read; 0 means the body is complete.
+     * @throws std::runtime_error on connection errors or malformed chunk framing.
+     */
+    virtual size_t read(char* dst, size_t max) = 0;
+};
+
+/**
+ * @brief Push interface for a response whose body is produced incrementally.
+ *
+ * Small bodies (finish() before the writer's buffer fills) are sent with Content-Length;
+ * larger ones switch to Transfer-Encoding: chunked, so the first bytes leave before the
+ * last ones are computed.
+ */
+class HttpResponseWriter {
+public:
+    virtual ~HttpResponseWriter() = default;
+
+    /**
+     * @brief Set status and headers (the `body` of `head` is ignored). Must be called first.
+     */
+    virtual void start(const HttpResponse& head) = 0;
+    virtual void write(const char* data, size_t len) = 0;
+    virtual void finish() = 0;
 };
 
 #endif
@@ -0,0 +1,96 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Opt-in allocation and copy counters for the request hot paths.
+ *
+ * Compiled in only with the CMake option COMPRESSION_INSTRUMENTATION (which defines the
+ * macro of the same name). Then a global operator new hook counts every allocation, and the
+ * places that copy payload bytes in user space (body buffering, codec output assembly, batch
+ * framing, ByteBuffer::copyOf, file I/O) call recordCopy(). Counts go to the process totals
+ * and to the Counters a Scope has installed on the current thread; HttpServer installs one
+ * per request on both the connection thread and the compute thread running the handler.
+ *
+ * Without the option every recording call is an empty inline function.
+ */
+class Instrumentation {
+public:
+    struct Snapshot {
+        uint64_t allocations = 0;
+        uint64_t allocatedBytes = 0;
+        uint64_t copiedBytes = 0;
+    };
+
+    /**
+     * @brief Counts of one unit of work (a request); several threads may add to it at once.
+     */
+    class Counters {
+    public:
+        Snapshot snapshot() const;
+
+    private:
+        friend class Instrumentation;
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> allocatedBytes{0};
+        std::atomic<uint64_t> copiedBytes{0};
+    };
+
+    /**
+     * @brief Attributes this thread's allocations and copies to `counters` until destroyed
+     *        (scopes nest; the previous target is restored).
+     */
+    class Scope {
+    public:
+        explicit Scope(Counters& counters);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Counters* previous = nullptr;
+    };
+
+    static constexpr bool enabled() {
+#ifdef COMPRESSION_INSTRUMENTATION
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static void recordCopy(size_t bytes);
+
+    /**
+     * @brief Called by the operator new hook.
+     */
+    static void recordAllocation(size_t bytes);
+
+    /**
+     * @brief Fold a finished request into the per-request statistics.
+     */
+    static void recordRequest(const Snapshot& request);
+
+    static Snapshot totals();
+
+    /**
+     * @brief Process totals plus per-request mean and max, as JSON (served at
+     *        GET /debug/allocations by CompressionApi); {"enabled":false} when compiled out.
+     */
+    static std::string renderJson();
+};
+
+#ifndef COMPRESSION_INSTRUMENTATION
+inline Instrumentation::Scope::Scope(Counters&) {}
+inline Instrumentation::Scope::~Scope() {}
+inline void Instrumentation::recordCopy(size_t) {}
+inline void Instrumentation::recordAllocation(size_t) {}
+inline void Instrumentation::recordRequest(const Snapshot&) {}
+#endif
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief HDR-style histogram of non-negative integer samples (latencies in nanoseconds).
+ *
+ * Buckets are log-linear: values below 2 * kSubBuckets are counted exactly, and every larger
+ * power-of-two range is split into kSubBuckets equal buckets, so any recorded value is known
+ * to within 1/kSubBuckets (under 1%) of itself across the whole uint64_t range. Counters are
+ * allocated up to the largest value seen (about 27 KiB for 10 s in nanoseconds, 58 KiB at
+ * most). Recording is one index computation and an increment.
+ *
+ * Not thread-safe: give every thread its own histogram and merge() them when done.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBucketBits = 7;
+    static constexpr size_t kSubBuckets = size_t{1} << kSubBucketBits;
+
+    LatencyHistogram();
+
+    void record(uint64_t value);
+    void record(uint64_t value, uint64_t times);
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? lowest : 0; }
+    uint64_t max() const { return highest; }
+    double mean() const;
+
+    /**
+     * @brief Smallest value v such that at least `percent` % of the samples are <= v
+     *        (reported as the top of v's bucket, capped at max()); 0 when empty.
+     */
+    uint64_t percentile(double percent) const;
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t lowest = UINT64_MAX;
+    uint64_t highest = 0;
+    long double sum = 0;
+
+    static size_t indexOf(uint64_t value);
+    static uint64_t highestInBucket(size_t index);
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Process-wide counters and fixed-bucket histograms, rendered in the Prometheus text
+ *        exposition format (served at GET /metrics by CompressionApi).
+ *
+ * Recording is meant for the hot path: every thread writes its own shard with plain relaxed
+ * loads and stores (no locked instructions, no shared cache lines), and a scrape sums all
+ * shards. A thread's shard is handed to a later thread when it exits, so per-connection
+ * threads do not grow the shard list past the peak thread count. Labels are fixed enums,
+ * which keeps the series count bounded whatever paths clients request.
+ */
+class Metrics {
+public:
+    enum class Endpoint { Compress, Decompress, BatchCompress, BatchDecompress, Health, Metrics, Options, Other, Count };
+    enum class Phase { Parse, Codec, Send, Count };
+    enum class Codec { Rle, Identity, Other, Count };
+    enum class Pool { Io, Compute, Count };
+    enum class CacheEvent { Hit, Miss, Eviction, NotModified, Count };
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Endpoint label for a request (Other for paths this service does not serve).
+     */
+    static Endpoint endpointFor(std::string_view method, std::string_view path);
+
+    static void recordRequest(Endpoint endpoint, int statusCode, size_t bytesIn, size_t bytesOut);
+    static void recordPhase(Phase phase, Clock::duration elapsed);
+
+    /**
+     * @brief A compress call: the codec AdaptiveCompression picked and the size change.
+     */
+    static void recordCompression(Codec codec, size_t bytesIn, size_t bytesOut);
+
+    /**
+     * @brief Codec for the tag byte AdaptiveCompression puts in front of its output.
+     */
+    static Codec codecForTag(char tag);
+
+    static void recordCache(CacheEvent event);
+
+    // Gauges (not sharded: they move once per connection or server start, not per request).
+    static void connectionOpened();
+    static void connectionClosed();
+    static void addThreads(Pool pool, long delta);
+    static void addCacheBytes(long long delta);
+
+    /**
+     * @brief All metrics in Prometheus text format (version 0.0.4).
+     */
+    static std::string render();
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define RLE_COMPRESSION_H
 
 #include "CompressionAlgorithm.h"
+#include <cstddef>
 #include <vector>
 
 /**
@@ -13,6 +14,12 @@ class RLECompression : public CompressionAlgorithm {
 public:
     std::vector<char> compress(const std::vector<char>& data) override;
     std::vector<char> decompress(const std::vector<char>& data) override;
+
+    /**
+     * @brief Same as above, over any byte range (no need to copy it into a vector first).
+     */
+    std::vector<char> compress(const char* data, size_t len);
+    std::vector<char> decompress(const char* data, size_t len);
 };
 
 #endif
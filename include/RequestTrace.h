@@ -0,0 +1,114 @@
+#ifndef REQUEST_TRACE_H
+#define REQUEST_TRACE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Where the time of one request went: a steady_clock total per phase.
+ *
+ * HttpServer creates one per request only when tracing is on (HttpServerOptions::serverTiming
+ * or traceLog) and installs it with a Scope on the connection thread and on the compute thread
+ * running the handler. Code along the request path then marks its phases with a Timer or
+ * record(); with no trace installed that is a thread-local load and a branch, and the clock
+ * is never read.
+ *
+ * Phases are exclusive except `decide`, which is the part of `codec` spent on the trial RLE
+ * pass adaptive compression makes to pick a codec (over the first block, or the whole payload
+ * at levels 4-9).
+ */
+class RequestTrace {
+public:
+    enum class Phase { Recv, Parse, Body, Queue, Hash, Decide, Codec, Send, Count };
+
+    using Clock = std::chrono::steady_clock;
+
+    RequestTrace();
+
+    void add(Phase phase, Clock::duration elapsed) {
+        phases[static_cast<size_t>(phase)] += elapsed;
+    }
+
+    Clock::duration get(Phase phase) const {
+        return phases[static_cast<size_t>(phase)];
+    }
+
+    /**
+     * @brief Time since the trace was created.
+     */
+    Clock::duration total() const;
+
+    /**
+     * @brief Value for a Server-Timing response header: every phase recorded so far plus the
+     *        total, in milliseconds (e.g. `recv;dur=0.012, parse;dur=0.004, ..., total;dur=1.9`).
+     */
+    std::string serverTiming() const;
+
+    /**
+     * @brief One JSON object (no trailing newline) describing the finished request, with each
+     *        phase and the total in microseconds.
+     */
+    std::string json(const std::string& method, const std::string& path, int status, size_t bytesIn,
+                     size_t bytesOut) const;
+
+    static const char* name(Phase phase);
+
+    /**
+     * @brief The trace installed on this thread, or null.
+     */
+    static RequestTrace* current() { return installed; }
+
+    /**
+     * @brief Add `elapsed` to the current trace, if any.
+     */
+    static void record(Phase phase, Clock::duration elapsed) {
+        if (RequestTrace* trace = installed) trace->add(phase, elapsed);
+    }
+
+    /**
+     * @brief Makes `trace` (may be null) this thread's current trace until destroyed; the
+     *        previous one is restored.
+     */
+    class Scope {
+    public:
+        explicit Scope(RequestTrace* trace) : previous(installed) { installed = trace; }
+        ~Scope() { installed = previous; }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        RequestTrace* previous;
+    };
+
+    /**
+     * @brief Adds the time until destruction to `phase` of the current trace, if any.
+     */
+    class Timer {
+    public:
+        explicit Timer(Phase phase) : trace(installed), phase(phase) {
+            if (trace) start = Clock::now();
+        }
+        ~Timer() {
+            if (trace) trace->add(phase, Clock::now() - start);
+        }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+    private:
+        RequestTrace* trace;
+        Phase phase;
+        Clock::time_point start;
+    };
+
+private:
+    static thread_local RequestTrace* installed;
+
+    Clock::time_point started;
+    Clock::duration phases[static_cast<size_t>(Phase::Count)] = {};
+};
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "ByteBuffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief In-memory LRU cache of codec results, keyed by a 128-bit hash of the input.
+ *
+ * - Keys are a keyed 128-bit hash (SipHash-2-4) of the request body under a per-"variant" key
+ *   (the variant string names the operation and its parameters, so the same bytes compressed
+ *   two different ways never collide). A hit costs one hash pass over the body instead of a
+ *   codec run. Bodies are not compared on a hit, so the hash is what keeps one client from
+ *   planting a result for another's input: the variant keys derive from a secret drawn at
+ *   random per process, which makes colliding keys infeasible to construct from outside.
+ *   The price is that keys, and the ETags built from them, change on restart and differ
+ *   between processes, and hashing runs at roughly 1-2 GB/s rather than a non-keyed hash's
+ *   several GB/s.
+ * - The byte budget is split evenly over kShards independently locked shards (picked by the
+ *   key), so concurrent requests rarely contend. Each shard evicts least recently used
+ *   entries to stay within its share; results bigger than half a share are not cached.
+ * - Values are immutable ByteBuffers: a hit shares the cached bytes, it never copies them.
+ */
+class ResultCache {
+public:
+    static constexpr size_t kShards = 16;
+
+    struct Key {
+        uint64_t hi = 0;
+        uint64_t lo = 0;
+
+        bool operator==(const Key& o) const { return hi == o.hi && lo == o.lo; }
+
+        /**
+         * @brief 32 lowercase hex digits (used as the HTTP ETag).
+         */
+        std::string hex() const;
+    };
+
+    using Value = std::shared_ptr<const ByteBuffer>;
+
+    explicit ResultCache(size_t maxBytes);
+    ~ResultCache();
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    static Key keyFor(std::string_view variant, const char* data, size_t len);
+
+    /**
+     * @brief SipHash-2-4 with 128-bit output of `data` under `secret` (hi = k0, lo = k1;
+     *        hi/lo of the result are the first/second output word).
+     */
+    static Key keyedHash(const Key& secret, const char* data, size_t len);
+
+    /**
+     * @brief Cached value for `key` (marking it most recently used), or nullptr.
+     */
+    Value get(const Key& key);
+
+    /**
+     * @brief Insert or replace. Evicts LRU entries of the key's shard as needed.
+     *
+     * A value that is a small slice of a larger buffer is stored as a copy (ByteBuffer::compact),
+     * so the cache never pins memory it does not account for.
+     */
+    Value put(const Key& key, ByteBuffer value);
+
+    size_t capacity() const { return shardBudget * kShards; }
+
+    /**
+     * @brief Largest value put() keeps; bigger ones would evict most of their shard.
+     */
+    size_t maxValueBytes() const {
+        const size_t overhead = sizeof(Entry) + 64;
+        return shardBudget / 2 > overhead ? shardBudget / 2 - overhead : 0;
+    }
+    size_t bytes() const;
+    size_t entries() const;
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& k) const { return static_cast<size_t>(k.lo ^ (k.hi >> 7)); }
+    };
+    struct Entry {
+        Key key;
+        Value value;
+    };
+    struct Shard {
+        mutable std::mutex mtx;
+        std::list<Entry> lru; // front = most recently used
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+        size_t bytes = 0;
+    };
+
+    size_t shardBudget;
+    Shard shards[kShards];
+
+    Shard& shardFor(const Key& key) { return shards[key.hi % kShards]; }
+    static size_t costOf(const Value& v) { return v->size() + sizeof(Entry) + 64; }
+};
+
+#endif
@@ -1,8 +1,11 @@
 #ifndef SERVER_H
 #define SERVER_H
 
+#include "SocketOptions.h"
+
 #include <functional>
 #include <thread>
+#include <vector>
 #include <atomic>
 
 /**
@@ -13,7 +16,7 @@
  */
 class Server {
 public:
-    explicit Server(int port);
+    explicit Server(int port, const SocketOptions& options = SocketOptions());
     ~Server();
 
     void start();
@@ -22,9 +25,26 @@ public:
     void handleClient(int clientSocket);
     void setHandler(std::function<void(int)> handler);
 
+    /**
+     * @brief Handler that echoes everything the client sends until it half-closes.
+     *
+     * Bytes are relayed with SocketIo::relay (splice on Linux) and never copied into user space.
+     */
+    static std::function<void(int)> makeRelayHandler();
+
+    /**
+     * @brief Handler that decodes one AdaptiveCompression stream and sends back the original bytes.
+     *
+     * The client sends the tagged stream and half-closes. Identity-tagged ('I') payloads are
+     * relayed straight back without touching user space; RLE payloads are decoded in memory.
+     * Malformed input closes the connection without a response.
+     */
+    static std::function<void(int)> makeDecompressHandler();
+
 private:
     int port;
-    int serverSocket;
+    SocketOptions options;
+    std::vector<int> listeners;
     std::atomic<bool> running;
     std::thread serverThread;
     std::function<void(int)> clientHandler;
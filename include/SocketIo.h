@@ -0,0 +1,95 @@
+#ifndef SOCKET_IO_H
+#define SOCKET_IO_H
+
+#include <cstddef>
+
+/**
+ * @brief Blocking socket I/O helpers shared by Client, Server-side handlers and HttpServer.
+ *
+ * All helpers retry on EINTR and never raise SIGPIPE when the peer has gone away.
+ */
+class SocketIo {
+public:
+    /**
+     * @brief One segment of a scatter/gather operation (mirrors struct iovec).
+     */
+    struct Slice {
+        char* data;
+        size_t size;
+    };
+    struct ConstSlice {
+        const char* data;
+        size_t size;
+    };
+
+    /**
+     * @brief Send exactly `len` bytes.
+     * @return true on success, false if the connection failed.
+     */
+    static bool sendAll(int sock, const char* data, size_t len);
+
+    /**
+     * @brief Receive exactly `len` bytes.
+     * @return true on success, false on error or if the peer closed before `len` bytes arrived.
+     */
+    static bool recvExact(int sock, char* data, size_t len);
+
+    /**
+     * @brief Wait until `sock` is readable (data, EOF or error pending).
+     * @param timeoutMs Negative waits forever.
+     * @return true if readable, false on timeout or poll failure.
+     */
+    static bool waitReadable(int sock, int timeoutMs);
+
+    /**
+     * @brief Gather-send all bytes of `count` slices, in order.
+     *
+     * Uses sendmsg(2) so several buffers (e.g. a header and a body) leave in one syscall
+     * and typically one TCP segment. Partial writes are resumed mid-slice.
+     */
+    static bool sendv(int sock, const ConstSlice* slices, size_t count);
+
+    /**
+     * @brief Scatter-receive exactly the total size of `count` slices, filling them in order.
+     */
+    static bool recvv(int sock, const Slice* slices, size_t count);
+
+    /**
+     * @brief Set SO_RCVBUF / SO_SNDBUF. Values <= 0 leave the kernel default in place.
+     * @return false if the kernel rejected either option.
+     */
+    static bool setBufferSizes(int sock, int receiveBytes, int sendBytes);
+
+    /**
+     * @brief Set SO_RCVTIMEO / SO_SNDTIMEO: a blocking recv/send (also splice and sendfile)
+     *        that waits longer than this fails with EAGAIN. Values <= 0 leave the option alone.
+     * @return false if the kernel rejected either option.
+     */
+    static bool setTimeouts(int sock, int receiveMs, int sendMs);
+
+    /**
+     * @brief True if the last failed call on this thread timed out (see setTimeouts).
+     */
+    static bool lastErrorWasTimeout();
+
+    /**
+     * @brief Send `count` bytes of the open file `fd`, starting at `offset`, to `sock`.
+     *
+     * Uses sendfile(2) where available so file pages go straight from the page cache to the
+     * socket; otherwise falls back to a buffered read/send loop.
+     * @return true if all bytes were sent.
+     */
+    static bool sendFile(int sock, int fd, size_t offset, size_t count);
+
+    /**
+     * @brief Move up to `maxBytes` bytes from `inFd` to `outFd` until EOF on `inFd`.
+     *
+     * On Linux this uses splice(2) through a pipe, so the data never enters user space;
+     * elsewhere (or for fd types splice rejects) a buffered copy is used.
+     * Either descriptor may be a socket or a file, and they may be the same socket (echo).
+     * @return number of bytes moved, or -1 on error.
+     */
+    static long long relay(int inFd, int outFd, size_t maxBytes = static_cast<size_t>(-1));
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef SOCKET_OPTIONS_H
+#define SOCKET_OPTIONS_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Per-deployment socket tuning shared by Server, HttpServer and Client.
+ *
+ * Defaults leave the kernel's settings alone, with two deliberate exceptions to the
+ * servers' earlier behavior: the listen() backlog is 128 (Server used 8 and HttpServer 16,
+ * which dropped connection bursts), and accepted sockets get SOCK_CLOEXEC (they were
+ * inherited by child processes before). Options that the platform does not support (e.g.
+ * TCP_DEFER_ACCEPT outside Linux) are silently skipped.
+ */
+struct SocketOptions {
+    int backlog = 128;              // listen() backlog
+    bool reuseAddress = true;       // SO_REUSEADDR on listeners
+    bool noDelay = false;           // TCP_NODELAY: disable Nagle on connections
+    int deferAcceptSeconds = 0;     // TCP_DEFER_ACCEPT (Linux): wake accept only once data arrived; 0 = off
+    int fastOpenQueue = 0;          // TCP_FASTOPEN pending-SYN queue on listeners; 0 = off
+    bool keepAlive = false;         // SO_KEEPALIVE on connections
+    int keepAliveIdleSeconds = 0;   // idle time before the first probe; 0 = kernel default
+    int receiveBufferBytes = 0;     // SO_RCVBUF; 0 = kernel default
+    int sendBufferBytes = 0;        // SO_SNDBUF; 0 = kernel default
+    bool closeOnExec = true;        // accepted sockets get SOCK_CLOEXEC
+    // Accepted sockets get SOCK_NONBLOCK. Only for handlers that poll() themselves;
+    // the built-in blocking handlers expect blocking sockets.
+    bool nonBlockingAccept = false;
+
+    // Listening addresses (servers only).
+    bool tcpEnabled = true;         // listen on INADDR_ANY:port
+    // Also (or, with tcpEnabled = false, only) listen on this AF_UNIX socket.
+    // A leading '@' selects the Linux abstract namespace (no filesystem entry).
+    std::string unixPath;
+    int unixMode = 0660;            // permissions applied to a filesystem socket path
+};
+
+/**
+ * @brief Applies SocketOptions. The one place that knows about individual socket options.
+ */
+class SocketSetup {
+public:
+    /**
+     * @brief Open every listener requested by `options` (TCP and/or Unix).
+     * @throws std::runtime_error on failure (nothing stays open) or if no listener is enabled.
+     */
+    static std::vector<int> openListeners(int port, const SocketOptions& options, const std::string& who);
+
+    /**
+     * @brief Shut down and close listeners opened by openListeners(), removing a filesystem
+     * Unix socket path. Clears `listeners`.
+     */
+    static void closeListeners(std::vector<int>& listeners, const SocketOptions& options);
+
+    /**
+     * @brief Wait (bounded, so callers can re-check their stop flag) for a connection on any
+     * of `listeners` and accept it.
+     * @return the client socket, or -1 on timeout/error.
+     */
+    static int acceptAny(const std::vector<int>& listeners, const SocketOptions& options);
+
+    /**
+     * @brief Create, tune, bind (INADDR_ANY) and listen on a TCP socket.
+     * @param who Prefix for error messages, e.g. "Server::start".
+     * @throws std::runtime_error on failure.
+     */
+    static int openTcpListener(int port, const SocketOptions& options, const std::string& who);
+
+    /**
+     * @brief accept() a connection (accept4 with SOCK_CLOEXEC/SOCK_NONBLOCK where available)
+     * and apply per-connection options.
+     * @return the client socket, or -1 (errno set) on failure.
+     */
+    static int acceptConnection(int listenSocket, const SocketOptions& options);
+
+    /**
+     * @brief Create, bind and listen on an AF_UNIX socket (see SocketOptions::unixPath).
+     * @throws std::runtime_error on failure or on platforms without Unix sockets.
+     */
+    static int openUnixListener(const std::string& path, const SocketOptions& options, const std::string& who);
+
+    /**
+     * @brief Connect a new AF_UNIX stream socket to `path` ('@' prefix = abstract namespace).
+     * @return the connected socket, or -1 on failure.
+     */
+    static int connectUnix(const std::string& path, const SocketOptions& options);
+
+    /**
+     * @brief Apply per-connection options (nodelay, keepalive, buffer sizes) to a connected
+     * or about-to-connect socket. Best-effort: individual failures are ignored.
+     */
+    static void applyConnectionOptions(int sock, const SocketOptions& options);
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef SPOOL_FILE_H
+#define SPOOL_FILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Anonymous temporary file for payloads too large to keep on the heap.
+ *
+ * The file is unlinked as soon as it is created (O_TMPFILE on Linux), so it disappears with
+ * the last descriptor even if the process dies. Bytes are appended with write()/appendFrom();
+ * map() then exposes the whole file read-only through mmap, so readers see an ordinary byte
+ * range whose pages the kernel can drop and re-read at will instead of anonymous memory that
+ * counts against RSS. Windows has no mmap here: map() reads the file into memory instead.
+ */
+class SpoolFile {
+public:
+    /**
+     * @param directory where to create the file; empty = $TMPDIR, else /tmp.
+     * @throws std::runtime_error if no file can be created.
+     */
+    static std::shared_ptr<SpoolFile> create(const std::string& directory = std::string());
+
+    ~SpoolFile();
+    SpoolFile(const SpoolFile&) = delete;
+    SpoolFile& operator=(const SpoolFile&) = delete;
+
+    /**
+     * @throws std::runtime_error on write errors (e.g. disk full).
+     */
+    void write(const char* data, size_t len);
+
+    /**
+     * @brief Append up to `count` bytes read from `inFd` (spliced on Linux, see SocketIo::relay).
+     * @return bytes appended (less than `count` only at EOF on `inFd`).
+     * @throws std::runtime_error on I/O errors.
+     */
+    size_t appendFrom(int inFd, size_t count);
+
+    /**
+     * @brief Finish writing and map the file. Further writes are not allowed.
+     */
+    std::string_view map();
+
+    /**
+     * @brief The mapped bytes (empty until map() was called).
+     */
+    std::string_view view() const { return std::string_view(mapped, length); }
+
+    int fd() const { return descriptor; }
+    size_t size() const { return length; }
+
+private:
+    explicit SpoolFile(int fd) : descriptor(fd) {}
+
+    int descriptor;
+    size_t length = 0;
+    const char* mapped = nullptr;
+    bool isMapped = false;
+    std::vector<char> copy; // Windows: map() reads the file here
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef STREAM_CODEC_H
+#define STREAM_CODEC_H
+
+#include "RLECompression.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Incremental (push-based) encoder/decoder interface.
+ *
+ * Input arrives in arbitrary-sized pieces via write(); output is handed to `out` as soon as
+ * it is known, so memory use is independent of the total payload size. The byte stream
+ * produced is identical to the one-shot CompressionAlgorithm it mirrors (see each class).
+ */
+class StreamCodec {
+public:
+    using Sink = std::function<void(const char*, size_t)>;
+
+    virtual ~StreamCodec() = default;
+
+    /**
+     * @brief Consume `len` input bytes; may call `out` zero or more times.
+     * @throws std::runtime_error on malformed input (decoders).
+     */
+    virtual void write(const char* data, size_t len, const Sink& out) = 0;
+
+    /**
+     * @brief Signal end of input and flush any pending output.
+     * @throws std::runtime_error if the input ended mid-record (decoders).
+     */
+    virtual void finish(const Sink& out) = 0;
+};
+
+/**
+ * @brief Streaming RLECompression::compress: runs may span write() calls.
+ */
+class RLEStreamEncoder : public StreamCodec {
+public:
+    void write(const char* data, size_t len, const Sink& out) override;
+    void finish(const Sink& out) override;
+
+private:
+    bool hasRun = false;
+    char current = 0;
+    unsigned int run = 0;
+    std::vector<char> scratch;
+};
+
+/**
+ * @brief Streaming RLECompression::decompress: [byte,count] pairs may be split across writes.
+ */
+class RLEStreamDecoder : public StreamCodec {
+public:
+    void write(const char* data, size_t len, const Sink& out) override;
+    void finish(const Sink& out) override;
+
+private:
+    bool haveValue = false;
+    char value = 0;
+    std::vector<char> scratch;
+};
+
+/**
+ * @brief Streaming AdaptiveCompression::compress.
+ *
+ * The first `decisionBytes` of input are buffered. If the input ends before that, the output
+ * is exactly AdaptiveCompression::compress(input). Otherwise RLE vs identity is chosen from
+ * that prefix and the rest is streamed; the result is still a valid 'R'/'I' tagged stream.
+ */
+class AdaptiveStreamCompressor : public StreamCodec {
+public:
+    explicit AdaptiveStreamCompressor(size_t decisionBytes = 64 * 1024);
+
+    void write(const char* data, size_t len, const Sink& out) override;
+    void finish(const Sink& out) override;
+
+private:
+    enum class Mode { Deciding, Rle, Identity };
+
+    size_t decisionBytes;
+    Mode mode;
+    std::vector<char> pending;
+    RLEStreamEncoder encoder;
+
+    void decide(const Sink& out);
+};
+
+/**
+ * @brief Forces one codec but keeps AdaptiveCompression's container: `tag` is written before
+ *        the first output byte, so AdaptiveCompression / AdaptiveStreamDecompressor decode it.
+ *
+ * `inner` encodes the payload; without one the payload is the input itself ('I').
+ * Empty input produces empty output, as in AdaptiveCompression.
+ */
+class TaggedStreamEncoder : public StreamCodec {
+public:
+    explicit TaggedStreamEncoder(char tag, std::unique_ptr<StreamCodec> inner = nullptr);
+    void write(const char* data, size_t len, const Sink& out) override;
+    void finish(const Sink& out) override;
+
+private:
+    char tag;
+    bool tagWritten = false;
+    std::unique_ptr<StreamCodec> inner;
+};
+
+/**
+ * @brief Streaming AdaptiveCompression::decompress.
+ */
+class AdaptiveStreamDecompressor : public StreamCodec {
+public:
+    void write(const char* data, size_t len, const Sink& out) override;
+    void finish(const Sink& out) override;
+
+private:
+    enum class Mode { NeedTag, Rle, Identity };
+
+    Mode mode = Mode::NeedTag;
+    RLEStreamDecoder decoder;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed-size pool for CPU-bound work (codec calls), separate from the I/O threads.
+ *
+ * - Sized to the cores by default, so concurrent compression never oversubscribes the CPU
+ *   however many connections are open.
+ * - Jobs carry a cost (payload bytes). Small jobs are dispatched before large ones, and at
+ *   most `size() - 1` large jobs run at once, so one worker is always left for small
+ *   requests while big ones grind (a single-thread pool cannot reserve one).
+ * - A waiting large job is started anyway once kMaxSmallBypass small jobs have overtaken
+ *   it, so a steady stream of small requests cannot starve it.
+ * - Results and exceptions come back through the returned future.
+ */
+class WorkerPool {
+public:
+    static constexpr size_t kMaxSmallBypass = 32;
+
+    /**
+     * @param threads        worker count; 0 = std::thread::hardware_concurrency()
+     * @param smallJobBytes  jobs with a cost below this are "small"
+     */
+    explicit WorkerPool(size_t threads = 0, size_t smallJobBytes = 64 * 1024);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    template <typename Fn>
+    auto submit(size_t cost, Fn fn) -> std::future<decltype(fn())> {
+        using Result = decltype(fn());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(fn));
+        std::future<Result> fut = task->get_future();
+        enqueue(cost, [task]() { (*task)(); });
+        return fut;
+    }
+
+    /**
+     * @brief Run fn(0) ... fn(count - 1) on the calling thread plus up to size() - 1 workers.
+     *
+     * The caller works through the items itself and only waits for helpers that actually
+     * started, so this is safe to call from inside a pool job (a batch handler, say) even
+     * when every worker is busy: it then simply runs serially. The first exception thrown
+     * by `fn` is rethrown once all started items have finished.
+     *
+     * @param costPerItem  priority class of the helper jobs (see submit()).
+     */
+    void forEach(size_t count, size_t costPerItem, const std::function<void(size_t)>& fn);
+
+    /**
+     * @brief Finish queued jobs, then join the workers. Called by the destructor.
+     */
+    void shutdown();
+
+    size_t size() const { return workers.size(); }
+    size_t queued() const;
+
+private:
+    size_t smallJobBytes;
+    size_t largeLimit;
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> smallJobs;
+    std::deque<std::function<void()>> largeJobs;
+    size_t largeRunning;
+    size_t smallBypass; // small jobs dispatched while the oldest large job waited
+    bool stopping;
+    std::vector<std::thread> workers;
+
+    void enqueue(size_t cost, std::function<void()> job);
+    void workerLoop();
+    bool largeRunnable() const { return !largeJobs.empty() && largeRunning < largeLimit; }
+};
+
+#endif
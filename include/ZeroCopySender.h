@@ -0,0 +1,81 @@
+#ifndef ZERO_COPY_SENDER_H
+#define ZERO_COPY_SENDER_H
+
+#include "ByteBuffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief MSG_ZEROCOPY send path for one TCP connection (Linux 4.14+).
+ *
+ * The kernel transmits straight from the caller's pages instead of copying them into socket
+ * buffers, so those pages must stay untouched until it reports, through the socket's error
+ * queue, that it is done with them. Each send() therefore keeps a reference to its
+ * ByteBuffer until the matching completion notification has been read (reap()).
+ *
+ * Only worth it for large buffers: pinning pages and reading notifications costs more than
+ * copying a few KiB. On loopback, and when the NIC cannot do scatter-gather, the kernel
+ * copies anyway and says so; the sender then switches itself off and send() falls back to
+ * an ordinary copying send. Where MSG_ZEROCOPY does not exist enabled() is always false.
+ */
+class ZeroCopySender {
+public:
+    /**
+     * @brief Enables SO_ZEROCOPY on `sock` (fails quietly, see enabled()).
+     */
+    explicit ZeroCopySender(int sock);
+
+    /**
+     * @brief Waits (bounded) for outstanding completions before releasing their buffers.
+     */
+    ~ZeroCopySender();
+
+    ZeroCopySender(const ZeroCopySender&) = delete;
+    ZeroCopySender& operator=(const ZeroCopySender&) = delete;
+
+    bool enabled() const { return on; }
+
+    /**
+     * @brief Send `head` (copied) followed by `body` (zero-copy when enabled).
+     * @return false if the connection failed.
+     */
+    bool send(std::string_view head, const ByteBuffer& body);
+
+    /**
+     * @brief Read completion notifications, waiting up to `timeoutMs` for all of them.
+     * @return number of sends still awaiting completion.
+     */
+    size_t reap(int timeoutMs);
+
+    size_t pending() const { return inFlight.size(); }
+    size_t pendingBytes() const { return inFlightBytes; }
+
+    /**
+     * @brief True once the kernel reported that it copied a "zero-copy" send.
+     */
+    bool kernelCopied() const { return copied; }
+
+private:
+    struct InFlight {
+        uint32_t firstId;   // notification ids of this send: firstId..lastId
+        uint32_t lastId;
+        uint32_t remaining; // ids in that range not yet completed
+        ByteBuffer head;
+        ByteBuffer body;
+    };
+
+    int sock;
+    bool on = false;
+    bool copied = false;
+    uint32_t nextId = 0; // the kernel numbers successful MSG_ZEROCOPY sendmsg() calls from 0
+    std::vector<InFlight> inFlight;
+    size_t inFlightBytes = 0;
+
+    bool readCompletions();
+    void complete(uint32_t first, uint32_t last);
+};
+
+#endif
@@ -1,15 +1,26 @@
 #include "AdaptiveCompression.h"
+#include "Instrumentation.h"
+#include "RequestTrace.h"
 
 #include <stdexcept>
 
 std::vector<char> AdaptiveCompression::compress(const std::vector<char>& data) {
-    if (data.empty()) {
+    return compress(data.data(), data.size());
+}
+
+std::vector<char> AdaptiveCompression::compress(const char* data, size_t len) {
+    if (len == 0) {
         return {};
     }
 
-    auto rleBytes = rle.compress(data);
+    std::vector<char> rleBytes;
+    {
+        // The trial that decides the codec; kept as the output when RLE wins.
+        RequestTrace::Timer trialTimer(RequestTrace::Phase::Decide);
+        rleBytes = rle.compress(data, len);
+    }
     // Identity payload is just the raw bytes (but we still add a 1-byte header).
-    const size_t identitySize = 1 + data.size();
+    const size_t identitySize = 1 + len;
     const size_t rleSize = 1 + rleBytes.size();
 
     std::vector<char> out;
@@ -17,12 +28,14 @@ std::vector<char> AdaptiveCompression::compress(const std::vector<char>& data) {
         out.reserve(rleSize);
         out.push_back('R');
         out.insert(out.end(), rleBytes.begin(), rleBytes.end());
+        Instrumentation::recordCopy(rleBytes.size());
         return out;
     }
 
     out.reserve(identitySize);
     out.push_back('I');
-    out.insert(out.end(), data.begin(), data.end());
+    out.insert(out.end(), data, data + len);
+    Instrumentation::recordCopy(len);
     return out;
 }
 
@@ -31,16 +44,29 @@ std::vector<char> AdaptiveCompression::decompress(const std::vector<char>& data)
         return {};
     }
 
+    // The payload is decoded in place; it is never copied out of `data` first.
     const char tag = data[0];
-    std::vector<char> payload(data.begin() + 1, data.end());
-
     if (tag == 'R') {
-        return rle.decompress(payload);
+        return rle.decompress(data.data() + 1, data.size() - 1);
     }
     if (tag == 'I') {
-        return identity.decompress(payload);
+        Instrumentation::recordCopy(data.size() - 1);
+        return std::vector<char>(data.begin() + 1, data.end());
     }
     throw std::runtime_error("AdaptiveCompression::decompress: unknown algorithm tag");
 }
 
+ByteBuffer AdaptiveCompression::decompress(const ByteBuffer& data) {
+    if (data.empty()) {
+        return {};
+    }
 
+    const char tag = data[0];
+    if (tag == 'R') {
+        return rle.decompress(data.data() + 1, data.size() - 1);
+    }
+    if (tag == 'I') {
+        return data.slice(1);
+    }
+    throw std::runtime_error("AdaptiveCompression::decompress: unknown algorithm tag");
+}
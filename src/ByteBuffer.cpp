@@ -0,0 +1,39 @@
+#include "ByteBuffer.h"
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+ByteBuffer::ByteBuffer(std::vector<char>&& bytes) {
+    if (bytes.empty()) return;
+    auto chunk = std::make_shared<const std::vector<char>>(std::move(bytes));
+    ptr = chunk->data();
+    length = chunk->size();
+    chunkBytes = length;
+    owner = std::move(chunk);
+}
+
+ByteBuffer::ByteBuffer(std::shared_ptr<const void> owner, const char* data, size_t size)
+    : owner(std::move(owner)), ptr(data), length(size), chunkBytes(size) {}
+
+ByteBuffer ByteBuffer::copyOf(const char* data, size_t size) {
+    Instrumentation::recordCopy(size);
+    return ByteBuffer(std::vector<char>(data, data + size));
+}
+
+ByteBuffer ByteBuffer::slice(size_t offset, size_t len) const {
+    if (offset > length) {
+        throw std::out_of_range("ByteBuffer::slice: offset past the end");
+    }
+    ByteBuffer out(*this);
+    out.ptr = ptr + offset;
+    out.length = std::min(len, length - offset);
+    return out;
+}
+
+ByteBuffer ByteBuffer::compact() const {
+    if (length * 2 >= chunkBytes) {
+        return *this;
+    }
+    return copyOf(ptr, length);
+}
@@ -1,4 +1,7 @@
 #include "Client.h"
+#include "FileHandler.h"
+#include "FrameProtocol.h"
+#include "SocketIo.h"
 #include <iostream>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -7,6 +10,13 @@
 #include <cstring>
 #include <cerrno>
 #include <climits>
+#include <algorithm>
+#include <stdexcept>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#endif
 
 #include "platform/socket_init.h"
 
@@ -14,8 +24,8 @@
  * Client constructor - Initialize member variables
  * This is already implemented for you.
  */
-Client::Client(const std::string& host, int port) 
-    : host(host), port(port), clientSocket(-1), connected(false) {}
+Client::Client(const std::string& host, int port, const SocketOptions& options)
+    : host(host), port(port), clientSocket(-1), connected(false), options(options) {}
 
 /**
  * Client destructor - Clean up resources
@@ -51,11 +61,22 @@ bool Client::connect() {
 
     ensure_socket_init();
 
+    // "unix:/path" (or "unix:@name" for the abstract namespace) selects a Unix domain socket.
+    static const std::string kUnixPrefix = "unix:";
+    if (host.compare(0, kUnixPrefix.size(), kUnixPrefix) == 0) {
+        clientSocket = SocketSetup::connectUnix(host.substr(kUnixPrefix.size()), options);
+        connected = clientSocket >= 0;
+        return connected;
+    }
+
     clientSocket = socket(AF_INET, SOCK_STREAM, 0);
     if (clientSocket < 0) {
         return false;
     }
 
+    // Buffer sizes must be set before connect() to influence the TCP window scale.
+    SocketSetup::applyConnectionOptions(clientSocket, options);
+
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
     addr.sin_port = htons(static_cast<uint16_t>(port));
@@ -145,6 +166,30 @@ bool Client::sendData(const std::vector<char>& data) {
     return true;
 }
 
+bool Client::sendFile(const std::string& path) {
+    if (!connected || clientSocket < 0) {
+        return false;
+    }
+#ifdef _WIN32
+    // No sendfile(2) equivalent wired up for Winsock; fall back to a buffered send.
+    try {
+        return sendData(FileHandler::readFile(path));
+    } catch (const std::exception&) {
+        return false;
+    }
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st {};
+    bool ok = (::fstat(fd, &st) == 0) &&
+              SocketIo::sendFile(clientSocket, fd, 0, static_cast<size_t>(st.st_size));
+    ::close(fd);
+    return ok;
+#endif
+}
+
 /**
  * TODO: Implement receiving data from the socket
  * 
@@ -170,15 +215,19 @@ std::vector<char> Client::receiveData(size_t maxSize) {
     // TCP is a byte stream, not a message protocol:
     // - we may need multiple reads to assemble the full response
     // - we treat peer-close (recv == 0) as "end of message" for our simple echo use-case
-    out.reserve(std::min<size_t>(maxSize, 4096));
-    while (out.size() < maxSize) {
-        char buf[4096];
-        size_t want = std::min(sizeof(buf), maxSize - out.size());
+    // Receive straight into `out`, doubling its size as it fills, so large responses take
+    // O(log n) reallocations and each recv() can return as much as the kernel has buffered.
+    size_t used = 0;
+    out.resize(std::min<size_t>(maxSize, 4096));
+    while (used < maxSize) {
+        if (used == out.size()) {
+            out.resize(std::min(maxSize, out.size() * 2));
+        }
         // Winsock recv() takes an int length; POSIX takes size_t. Cast safely.
-        const int wantInt = static_cast<int>(std::min<size_t>(want, static_cast<size_t>(INT_MAX)));
-        ssize_t n = ::recv(clientSocket, buf, wantInt, 0);
+        const int wantInt = static_cast<int>(std::min<size_t>(out.size() - used, static_cast<size_t>(INT_MAX)));
+        ssize_t n = ::recv(clientSocket, out.data() + used, wantInt, 0);
         if (n > 0) {
-            out.insert(out.end(), buf, buf + n);
+            used += static_cast<size_t>(n);
             continue;
         }
         if (n == 0) {
@@ -190,12 +239,85 @@ std::vector<char> Client::receiveData(size_t maxSize) {
         }
         return {};
     }
+    out.resize(used);
     return out;
 }
 
+bool Client::receiveInto(char* data, size_t len) {
+    if (!connected || clientSocket < 0) {
+        return false;
+    }
+    return SocketIo::recvExact(clientSocket, data, len);
+}
+
+bool Client::receiveInto(std::vector<char>& buffer) {
+    return receiveInto(buffer.data(), buffer.size());
+}
+
+size_t Client::receiveSome(char* data, size_t len) {
+    if (!connected || clientSocket < 0 || len == 0) {
+        return 0;
+    }
+    const int want = static_cast<int>(std::min<size_t>(len, static_cast<size_t>(INT_MAX)));
+    while (true) {
+        const ssize_t n = ::recv(clientSocket, data, want, 0);
+        if (n > 0) return static_cast<size_t>(n);
+        if (n < 0 && errno == EINTR) continue;
+        return 0;
+    }
+}
+
+bool Client::sendBuffers(const std::vector<SocketIo::ConstSlice>& slices) {
+    if (!connected || clientSocket < 0) {
+        return false;
+    }
+    return SocketIo::sendv(clientSocket, slices.data(), slices.size());
+}
+
+bool Client::receiveBuffers(const std::vector<SocketIo::Slice>& slices) {
+    if (!connected || clientSocket < 0) {
+        return false;
+    }
+    return SocketIo::recvv(clientSocket, slices.data(), slices.size());
+}
+
+void Client::setBufferSizes(int receiveBytes, int sendBytes) {
+    options.receiveBufferBytes = receiveBytes;
+    options.sendBufferBytes = sendBytes;
+    if (connected && clientSocket >= 0) {
+        (void)SocketIo::setBufferSizes(clientSocket, receiveBytes, sendBytes);
+    }
+}
+
 bool Client::shutdownWrite() {
     if (!connected || clientSocket < 0) {
         return false;
     }
     return (::shutdown(clientSocket, SHUT_WR) == 0);
 }
+
+bool Client::sendFrame(const std::vector<char>& payload) {
+    if (!connected || clientSocket < 0) {
+        return false;
+    }
+    return FrameProtocol::writeFrame(clientSocket, FrameProtocol::kData, payload);
+}
+
+bool Client::peerClosed() const {
+    if (!connected || clientSocket < 0) {
+        return true;
+    }
+    // An idle connection has nothing to read; readable means EOF, a reset or stray bytes.
+    if (!SocketIo::waitReadable(clientSocket, 0)) {
+        return false;
+    }
+    char probe;
+    return ::recv(clientSocket, &probe, 1, MSG_PEEK) <= 0;
+}
+
+bool Client::receiveFrame(std::vector<char>& payload, char& type) {
+    if (!connected || clientSocket < 0) {
+        return false;
+    }
+    return FrameProtocol::readFrame(clientSocket, type, payload);
+}
@@ -0,0 +1,111 @@
+#include "ClientPool.h"
+#include "FrameProtocol.h"
+
+#include <stdexcept>
+#include <string>
+
+ClientPool::ClientPool(const std::string& host, int port, size_t connections)
+    : host(host), port(port), stopping(false) {
+    if (connections == 0) {
+        connections = 1;
+    }
+    workers.reserve(connections);
+    for (size_t i = 0; i < connections; ++i) {
+        auto conn = std::make_shared<Client>(host, port);
+        // Warm the connection now; failures are retried lazily per request.
+        (void)conn->connect();
+        workers.emplace_back(&ClientPool::workerLoop, this, conn);
+    }
+}
+
+ClientPool::~ClientPool() {
+    shutdown();
+}
+
+std::future<std::vector<char>> ClientPool::submit(std::vector<char> payload) {
+    Job job;
+    job.payload = std::move(payload);
+    auto fut = job.result.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopping) {
+            throw std::runtime_error("ClientPool::submit: pool is shut down");
+        }
+        queue.push_back(std::move(job));
+    }
+    cv.notify_one();
+    return fut;
+}
+
+void ClientPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& t : workers) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+}
+
+// A request is written at most once unless writing it failed. A pooled connection the server
+// closed while idle is replaced before anything is sent; if sending on a reused connection
+// still fails, the server cannot have acted on a partial frame, so it goes out once more on a
+// fresh connection. A receive failure is reported instead: the server may already have
+// processed the request, and repeating it would run non-idempotent requests twice.
+bool ClientPool::roundTrip(Client& conn, const std::vector<char>& payload, std::vector<char>& response, char& type,
+                           std::string& error) {
+    if (conn.isConnected() && conn.peerClosed()) {
+        conn.disconnect();
+    }
+    const bool reused = conn.isConnected();
+    bool sent = conn.connect() && conn.sendFrame(payload);
+    if (!sent && reused) {
+        conn.disconnect();
+        sent = conn.connect() && conn.sendFrame(payload);
+    }
+    if (!sent) {
+        conn.disconnect();
+        error = "request failed (cannot reach server)";
+        return false;
+    }
+    if (!conn.receiveFrame(response, type)) {
+        conn.disconnect();
+        error = "connection lost before the response arrived";
+        return false;
+    }
+    return true;
+}
+
+void ClientPool::workerLoop(std::shared_ptr<Client> conn) {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                break; // stopping and drained
+            }
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        std::vector<char> response;
+        char type = 0;
+        std::string error;
+        if (!roundTrip(*conn, job.payload, response, type, error)) {
+            job.result.set_exception(std::make_exception_ptr(std::runtime_error("ClientPool: " + error)));
+        } else if (type != FrameProtocol::kData) {
+            job.result.set_exception(std::make_exception_ptr(
+                std::runtime_error("ClientPool: server error: " + std::string(response.begin(), response.end()))));
+        } else {
+            job.result.set_value(std::move(response));
+        }
+    }
+    conn->disconnect();
+}
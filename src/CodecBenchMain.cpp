@@ -0,0 +1,393 @@
+// codec_bench: throughput, cost per byte, allocations and ratio of every CompressionAlgorithm
+// over a fixed corpus, written as CSV (default) or JSON with a stable row order and schema.
+
+#include "AdaptiveCompression.h"
+#include "IdentityCompression.h"
+#include "Instrumentation.h"
+#include "RLECompression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Every allocation of the process is counted; the bench is single-threaded, so the counts taken
+// around a call are that call's. An instrumented build already hooks operator new.
+#ifdef COMPRESSION_INSTRUMENTATION
+namespace {
+uint64_t allocationCount() { return Instrumentation::totals().allocations; }
+uint64_t allocatedBytes() { return Instrumentation::totals().allocatedBytes; }
+} // namespace
+#else
+namespace {
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocatedBytes{0};
+
+void* countedAlloc(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+uint64_t allocationCount() { return g_allocations.load(std::memory_order_relaxed); }
+uint64_t allocatedBytes() { return g_allocatedBytes.load(std::memory_order_relaxed); }
+} // namespace
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Codec {
+    const char* name;
+    std::function<std::unique_ptr<CompressionAlgorithm>()> make;
+};
+
+const Codec kCodecs[] = {
+    {"identity", [] { return std::unique_ptr<CompressionAlgorithm>(new IdentityCompression()); }},
+    {"rle", [] { return std::unique_ptr<CompressionAlgorithm>(new RLECompression()); }},
+    {"adaptive", [] { return std::unique_ptr<CompressionAlgorithm>(new AdaptiveCompression()); }},
+};
+
+// xorshift64*: fixed seeds make every corpus byte-for-byte identical across runs and machines.
+struct Rng {
+    uint64_t state;
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+};
+
+std::vector<char> allSame(size_t n) { return std::vector<char>(n, 'A'); }
+
+std::vector<char> randomBytes(size_t n) {
+    Rng rng{0x9E3779B97F4A7C15ULL};
+    std::vector<char> out(n);
+    for (char& c : out) c = static_cast<char>(rng.next() >> 56);
+    return out;
+}
+
+// Runs of 1..8 equal bytes: the case where RLE barely breaks even.
+std::vector<char> shortRuns(size_t n) {
+    Rng rng{0xD1B54A32D192ED03ULL};
+    std::vector<char> out;
+    out.reserve(n);
+    while (out.size() < n) {
+        const uint64_t r = rng.next();
+        const size_t run = std::min<size_t>(1 + (r & 7), n - out.size());
+        out.insert(out.end(), run, static_cast<char>(r >> 56));
+    }
+    return out;
+}
+
+std::vector<char> text(size_t n) {
+    static const char* const kWords[] = {"the", "compressor", "reads", "a", "stream", "of", "bytes", "and",
+                                         "writes", "runs", "to", "its", "output", "buffer", "when", "it",
+                                         "finds", "repeated", "characters", "in", "input", "data", "file", "server"};
+    Rng rng{0x94D049BB133111EBULL};
+    std::vector<char> out;
+    out.reserve(n + 16);
+    size_t words = 0;
+    while (out.size() < n) {
+        const char* word = kWords[rng.next() % (sizeof(kWords) / sizeof(kWords[0]))];
+        out.insert(out.end(), word, word + std::char_traits<char>::length(word));
+        out.push_back(++words % 12 == 0 ? '\n' : ' ');
+    }
+    out.resize(n);
+    return out;
+}
+
+// Mostly zero, with a random byte about every 32 positions (sparse tables, padded records).
+std::vector<char> sparse(size_t n) {
+    Rng rng{0xBF58476D1CE4E5B9ULL};
+    std::vector<char> out(n, '\0');
+    for (char& c : out) {
+        const uint64_t r = rng.next();
+        if ((r & 31) == 0) c = static_cast<char>(r >> 56);
+    }
+    return out;
+}
+
+struct Corpus {
+    const char* name;
+    std::vector<char> (*generate)(size_t);
+};
+
+const Corpus kCorpora[] = {
+    {"all_same", allSame}, {"random", randomBytes}, {"short_runs", shortRuns}, {"text", text}, {"sparse", sparse},
+};
+
+const size_t kSizes[] = {64, 1024, 16 << 10, 256 << 10, 4 << 20, 64 << 20, size_t{1} << 30};
+
+struct Timing {
+    uint64_t iterations = 0;
+    double seconds = 0;
+    double allocationsPerCall = 0;
+    double allocatedBytesPerCall = 0;
+};
+
+// Calls `fn` until `minSeconds` have passed (at least once), after one untimed warm-up call.
+Timing measure(const std::function<void()>& fn, double minSeconds) {
+    fn();
+    Timing t;
+    const uint64_t allocs = allocationCount();
+    const uint64_t bytes = allocatedBytes();
+    const auto start = Clock::now();
+    do {
+        fn();
+        ++t.iterations;
+        t.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (t.seconds < minSeconds);
+    t.allocationsPerCall = static_cast<double>(allocationCount() - allocs) / t.iterations;
+    t.allocatedBytesPerCall = static_cast<double>(allocatedBytes() - bytes) / t.iterations;
+    return t;
+}
+
+struct Row {
+    std::string codec;
+    std::string corpus;
+    size_t size;
+    size_t compressedSize;
+    Timing compress;
+    Timing decompress;
+};
+
+std::string fixed(double v, int decimals) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+    return buf;
+}
+
+// Throughput is counted in uncompressed bytes (1 MB = 10^6 bytes) in both directions.
+double mbPerSecond(const Row& row, const Timing& t) {
+    return static_cast<double>(row.size) * t.iterations / t.seconds / 1e6;
+}
+
+double nsPerByte(const Row& row, const Timing& t) {
+    return t.seconds * 1e9 / (static_cast<double>(row.size) * t.iterations);
+}
+
+const char* const kColumns[] = {"codec",
+                                "corpus",
+                                "size",
+                                "compressed_size",
+                                "ratio",
+                                "compress_iterations",
+                                "compress_mb_s",
+                                "compress_ns_per_byte",
+                                "compress_allocs_per_call",
+                                "compress_alloc_bytes_per_call",
+                                "decompress_iterations",
+                                "decompress_mb_s",
+                                "decompress_ns_per_byte",
+                                "decompress_allocs_per_call",
+                                "decompress_alloc_bytes_per_call"};
+
+std::vector<std::string> fields(const Row& row) {
+    return {row.codec,
+            row.corpus,
+            std::to_string(row.size),
+            std::to_string(row.compressedSize),
+            fixed(static_cast<double>(row.compressedSize) / row.size, 4),
+            std::to_string(row.compress.iterations),
+            fixed(mbPerSecond(row, row.compress), 2),
+            fixed(nsPerByte(row, row.compress), 4),
+            fixed(row.compress.allocationsPerCall, 2),
+            fixed(row.compress.allocatedBytesPerCall, 0),
+            std::to_string(row.decompress.iterations),
+            fixed(mbPerSecond(row, row.decompress), 2),
+            fixed(nsPerByte(row, row.decompress), 4),
+            fixed(row.decompress.allocationsPerCall, 2),
+            fixed(row.decompress.allocatedBytesPerCall, 0)};
+}
+
+void writeCsvHeader(std::ostream& out) {
+    for (size_t i = 0; i < sizeof(kColumns) / sizeof(kColumns[0]); ++i) out << (i ? "," : "") << kColumns[i];
+    out << "\n";
+}
+
+void writeCsvRow(std::ostream& out, const Row& row) {
+    const auto values = fields(row);
+    for (size_t i = 0; i < values.size(); ++i) out << (i ? "," : "") << values[i];
+    out << "\n" << std::flush;
+}
+
+void writeJsonRow(std::ostream& out, const Row& row, bool first) {
+    const auto values = fields(row);
+    out << (first ? "\n    {" : ",\n    {");
+    for (size_t i = 0; i < values.size(); ++i) {
+        out << (i ? ", " : "") << '"' << kColumns[i] << "\": ";
+        if (i < 2) {
+            out << '"' << values[i] << '"'; // codec and corpus names need no escaping
+        } else {
+            out << values[i];
+        }
+    }
+    out << "}" << std::flush;
+}
+
+// Accepts plain byte counts and K/M/G (binary) suffixes.
+size_t parseSize(const std::string& s) {
+    size_t used = 0;
+    const unsigned long long n = std::stoull(s, &used);
+    size_t scale = 1;
+    if (used + 1 == s.size()) {
+        switch (s[used]) {
+        case 'K': case 'k': scale = size_t{1} << 10; break;
+        case 'M': case 'm': scale = size_t{1} << 20; break;
+        case 'G': case 'g': scale = size_t{1} << 30; break;
+        default: throw std::invalid_argument("bad size '" + s + "'");
+        }
+    } else if (used != s.size()) {
+        throw std::invalid_argument("bad size '" + s + "'");
+    }
+    return static_cast<size_t>(n) * scale;
+}
+
+bool selected(const std::string& list, const std::string& name) {
+    if (list.empty()) return true;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item == name) return true;
+    }
+    return false;
+}
+
+void printUsage() {
+    std::cerr << "Usage: codec_bench [options]\n"
+                 "  --format csv|json    output format (default csv)\n"
+                 "  --out PATH           write results to PATH instead of stdout\n"
+                 "  --codec LIST         comma-separated codecs: identity,rle,adaptive (default all)\n"
+                 "  --corpus LIST        comma-separated corpora: all_same,random,short_runs,text,sparse\n"
+                 "                       (default all)\n"
+                 "  --min-size N         smallest input size (default 64; K/M/G suffixes accepted)\n"
+                 "  --max-size N         largest input size (default 64M, up to 1G)\n"
+                 "  --min-time MS        time each measurement for at least MS (default 200)\n"
+                 "Sizes run in powers of 16 from 64 bytes to 1 GiB. Rows come out in a fixed order\n"
+                 "(codec, corpus, size) with a fixed set of columns.\n";
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string format = "csv";
+    std::string outPath;
+    std::string codecs;
+    std::string corpora;
+    size_t minSize = 64;
+    size_t maxSize = 64 << 20;
+    double minSeconds = 0.2;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(arg + " expects a value");
+            }
+            return argv[++i];
+        };
+        try {
+            if (arg == "--format") {
+                format = value();
+                if (format != "csv" && format != "json") {
+                    throw std::invalid_argument("--format expects csv or json");
+                }
+            } else if (arg == "--out") {
+                outPath = value();
+            } else if (arg == "--codec") {
+                codecs = value();
+            } else if (arg == "--corpus") {
+                corpora = value();
+            } else if (arg == "--min-size") {
+                minSize = parseSize(value());
+            } else if (arg == "--max-size") {
+                maxSize = parseSize(value());
+            } else if (arg == "--min-time") {
+                minSeconds = std::stod(value()) / 1000.0;
+            } else if (arg == "-h" || arg == "--help") {
+                printUsage();
+                return 0;
+            } else {
+                throw std::invalid_argument("unknown argument '" + arg + "'");
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "codec_bench: " << e.what() << "\n";
+            printUsage();
+            return 2;
+        }
+    }
+
+    std::ofstream file;
+    if (!outPath.empty()) {
+        file.open(outPath);
+        if (!file) {
+            std::cerr << "codec_bench: cannot open " << outPath << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = outPath.empty() ? std::cout : file;
+
+    if (format == "csv") {
+        writeCsvHeader(out);
+    } else {
+        out << "{\n  \"benchmark\": \"codec_bench\",\n  \"results\": [" << std::flush;
+    }
+
+    bool first = true;
+    for (const Codec& codec : kCodecs) {
+        if (!selected(codecs, codec.name)) continue;
+        for (const Corpus& corpus : kCorpora) {
+            if (!selected(corpora, corpus.name)) continue;
+            for (size_t size : kSizes) {
+                if (size < minSize || size > maxSize) continue;
+                const std::vector<char> input = corpus.generate(size);
+                auto algorithm = codec.make();
+
+                std::vector<char> compressed = algorithm->compress(input);
+                if (algorithm->decompress(compressed) != input) {
+                    std::cerr << "codec_bench: " << codec.name << " does not round-trip " << corpus.name << " at "
+                              << size << " bytes\n";
+                    return 1;
+                }
+
+                Row row{codec.name, corpus.name, size, compressed.size(), {}, {}};
+                std::vector<char> sink;
+                row.compress = measure([&]() { sink = algorithm->compress(input); }, minSeconds);
+                sink = std::vector<char>();
+                row.decompress = measure([&]() { sink = algorithm->decompress(compressed); }, minSeconds);
+
+                if (format == "csv") {
+                    writeCsvRow(out, row);
+                } else {
+                    writeJsonRow(out, row, first);
+                }
+                first = false;
+            }
+        }
+    }
+
+    if (format == "json") {
+        out << (first ? "]\n}\n" : "\n  ]\n}\n");
+    }
+    return 0;
+}
@@ -1,33 +1,277 @@
 #include "CompressionApi.h"
+#include "Instrumentation.h"
+#include "Metrics.h"
+#include "RequestTrace.h"
+#include "SpoolFile.h"
+#include "StreamCodec.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 
 namespace {
+// Every response carries the same few headers; they are serialized once, here, and sent
+// verbatim (see HttpResponse::presetHeaders) instead of being rebuilt per request.
+// Allow-Origin lets browser-based frontends (different origin) call this API; preflight
+// includes both Content-Type and Accept for our frontend fetch(). The CORS lines are spelled
+// once and spliced into every preset by literal concatenation, so the presets cannot drift.
+#define CORS_HEADERS(methods)                                                                        \
+    "Access-Control-Allow-Origin: *\r\n"                                                             \
+    "Access-Control-Allow-Methods: " methods "\r\n"                                                  \
+    "Access-Control-Allow-Headers: Content-Type, Accept, If-None-Match, X-Compression-Algorithm, "  \
+    "X-Compression-Level, X-Compression-Block-Size\r\n"
+#define CORS_EXPOSE_HEADERS "Access-Control-Expose-Headers: ETag, X-Compression-Algorithm\r\n"
+
+constexpr std::string_view kCorsHeaders = CORS_HEADERS("POST, OPTIONS");
+constexpr std::string_view kBinaryHeaders =
+    "Content-Type: application/octet-stream\r\n" CORS_HEADERS("POST, OPTIONS") CORS_EXPOSE_HEADERS;
+constexpr std::string_view kNotModifiedHeaders = CORS_HEADERS("POST, OPTIONS") CORS_EXPOSE_HEADERS;
+constexpr std::string_view kTextHeaders = "Content-Type: text/plain; charset=utf-8\r\n" CORS_HEADERS("POST, OPTIONS");
+constexpr std::string_view kMetricsHeaders =
+    "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n" CORS_HEADERS("POST, OPTIONS, GET");
+constexpr std::string_view kJsonHeaders = "Content-Type: application/json\r\n" CORS_HEADERS("POST, OPTIONS, GET");
+constexpr std::string_view kHealthHeaders =
+    "Content-Type: text/plain; charset=utf-8\r\n" CORS_HEADERS("POST, OPTIONS, GET");
+
+#undef CORS_EXPOSE_HEADERS
+#undef CORS_HEADERS
+
 HttpResponse textError(int code, const std::string& msg) {
     HttpResponse res;
     res.statusCode = code;
     res.statusText = (code == 404) ? "Not Found" : (code == 405) ? "Method Not Allowed" : "Bad Request";
-    res.headers["Content-Type"] = "text/plain; charset=utf-8";
-    // Allow browser-based frontends (different origin) to call this API.
-    res.headers["Access-Control-Allow-Origin"] = "*";
-    res.headers["Access-Control-Allow-Methods"] = "POST, OPTIONS";
-    // Browser preflight includes both Content-Type and Accept for our frontend fetch().
-    res.headers["Access-Control-Allow-Headers"] = "Content-Type, Accept";
+    res.presetHeaders = kTextHeaders;
     res.body.assign(msg.begin(), msg.end());
     return res;
 }
+
+// If-None-Match: "*" or a comma-separated list of (possibly weak, W/"...") entity tags.
+bool matchesIfNoneMatch(std::string_view header, std::string_view etag) {
+    while (!header.empty()) {
+        const size_t comma = header.find(',');
+        std::string_view tag = header.substr(0, comma);
+        header = comma == std::string_view::npos ? std::string_view() : header.substr(comma + 1);
+        while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) tag.remove_prefix(1);
+        while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) tag.remove_suffix(1);
+        if (tag.size() >= 2 && tag[0] == 'W' && tag[1] == '/') tag.remove_prefix(2);
+        if (tag == "*" || tag == etag) return true;
+    }
+    return false;
+}
+
+uint32_t readU32BE(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    return (static_cast<uint32_t>(b[0]) << 24) | (static_cast<uint32_t>(b[1]) << 16) |
+           (static_cast<uint32_t>(b[2]) << 8) | static_cast<uint32_t>(b[3]);
+}
+
+void appendU32BE(std::vector<char>& out, uint32_t v) {
+    out.push_back(static_cast<char>((v >> 24) & 0xFF));
+    out.push_back(static_cast<char>((v >> 16) & 0xFF));
+    out.push_back(static_cast<char>((v >> 8) & 0xFF));
+    out.push_back(static_cast<char>(v & 0xFF));
+}
+
+// Codecs selectable with `algorithm=`. A new codec needs a row here and a case in
+// makeCompressor(); a level or block range of 0..0 means the codec takes no such parameter.
+struct CodecInfo {
+    const char* name;
+    const char* tags; // container tag(s) the output starts with
+    const char* description;
+    int minLevel;
+    int maxLevel;
+    int defaultLevel;
+    size_t minBlock;
+    size_t maxBlock;
+    size_t defaultBlock;
+};
+
+// Adaptive levels 1-3 pick the codec from the first `block` bytes only (one pass); 4-9
+// compress the whole payload with RLE and keep it only if it is smaller.
+constexpr int kAdaptiveSampledMaxLevel = 3;
+
+const CodecInfo kCodecs[] = {
+    {"adaptive", "RI",
+     "RLE if it makes the payload smaller, otherwise stored. Levels 1-3 decide from the first block; "
+     "4-9 compare full outputs (streamed uploads always decide from the first block).",
+     1, 9, 6, 4096, 64 * 1024 * 1024, 64 * 1024},
+    {"rle", "R", "Run-length encoding: [byte][count] pairs. Best for long runs of equal bytes.", 0, 0, 0, 0, 0, 0},
+    {"identity", "I", "Stored unchanged. Cheapest for incompressible data.", 0, 0, 0, 0, 0, 0},
+};
+
+const CodecInfo& codecInfo(const std::string& name) {
+    for (const CodecInfo& c : kCodecs) {
+        if (name == c.name) return c;
+    }
+    throw std::invalid_argument("unknown algorithm '" + name + "' (see GET /algorithms)");
+}
+
+std::unique_ptr<StreamCodec> makeCompressor(const CompressionApi::CodecParams& params) {
+    if (params.algorithm == "adaptive") {
+        return std::unique_ptr<StreamCodec>(new AdaptiveStreamCompressor(params.blockSize));
+    }
+    if (params.algorithm == "rle") {
+        return std::unique_ptr<StreamCodec>(
+            new TaggedStreamEncoder('R', std::unique_ptr<StreamCodec>(new RLEStreamEncoder())));
+    }
+    if (params.algorithm == "identity") {
+        return std::unique_ptr<StreamCodec>(new TaggedStreamEncoder('I'));
+    }
+    throw std::invalid_argument("unknown algorithm '" + params.algorithm + "'");
+}
+
+// Cache key / ETag variant: the same bytes compressed differently must not share entries.
+std::string codecVariant(bool compressing, const CompressionApi::CodecParams& params) {
+    if (!compressing) return "decompress";
+    return "compress:" + params.algorithm + ":" + std::to_string(params.level) + ":" +
+           std::to_string(params.blockSize);
+}
+
+const char* codecNameForTag(char tag) {
+    return tag == 'R' ? "rle" : tag == 'I' ? "identity" : "unknown";
+}
+
+// Whole unsigned decimal in [min, max], or throws.
+unsigned long long parseNumber(const std::string& what, const std::string& text, unsigned long long min,
+                               unsigned long long max) {
+    unsigned long long v = 0;
+    bool ok = !text.empty() && text.size() <= 12;
+    for (char c : text) {
+        if (c < '0' || c > '9') ok = false;
+        else v = v * 10 + static_cast<unsigned long long>(c - '0');
+    }
+    if (!ok || v < min || v > max) {
+        throw std::invalid_argument(what + " must be between " + std::to_string(min) + " and " + std::to_string(max));
+    }
+    return v;
+}
+
+std::string buildAlgorithmsJson() {
+    std::string json = "{\"default\":\"adaptive\",\"algorithms\":[";
+    bool first = true;
+    for (const CodecInfo& c : kCodecs) {
+        if (!first) json += ",";
+        first = false;
+        json += "{\"name\":\"";
+        json += c.name;
+        json += "\",\"tags\":\"";
+        json += c.tags;
+        json += "\",\"description\":\"";
+        json += c.description;
+        json += "\"";
+        if (c.maxLevel > 0) {
+            json += ",\"level\":{\"min\":" + std::to_string(c.minLevel) + ",\"max\":" + std::to_string(c.maxLevel) +
+                    ",\"default\":" + std::to_string(c.defaultLevel) + "}";
+        }
+        if (c.maxBlock > 0) {
+            json += ",\"blockSize\":{\"min\":" + std::to_string(c.minBlock) + ",\"max\":" +
+                    std::to_string(c.maxBlock) + ",\"default\":" + std::to_string(c.defaultBlock) + "}";
+        }
+        json += "}";
+    }
+    json += "],\"parameters\":{"
+            "\"algorithm\":{\"query\":\"algorithm\",\"header\":\"X-Compression-Algorithm\"},"
+            "\"level\":{\"query\":\"level\",\"header\":\"X-Compression-Level\"},"
+            "\"blockSize\":{\"query\":\"block\",\"header\":\"X-Compression-Block-Size\"}},"
+            "\"endpoints\":[\"POST /compress\",\"POST /decompress\",\"POST /batch/compress\","
+            "\"POST /batch/decompress\",\"GET /algorithms\",\"GET /health\",\"GET /metrics\"],"
+            "\"maxBatchItems\":" +
+            std::to_string(CompressionApi::kMaxBatchItems) + "}\n";
+    return json;
+}
 } // namespace
 
+CompressionApi::CodecParams CompressionApi::codecParams(const HttpRequest& req) {
+    // Query parameters win over headers.
+    auto lookup = [&req](const char* query, const char* header, std::string& value) {
+        if (req.queryParam(query, value)) return true;
+        const std::string_view h = req.headers.get(header);
+        if (h.empty()) return false;
+        value.assign(h.data(), h.size());
+        return true;
+    };
+
+    CodecParams params;
+    std::string value;
+    if (lookup("algorithm", "X-Compression-Algorithm", value)) {
+        params.algorithm = value;
+    }
+    const CodecInfo& info = codecInfo(params.algorithm);
+
+    params.level = info.defaultLevel;
+    if (lookup("level", "X-Compression-Level", value)) {
+        if (info.maxLevel == 0) {
+            throw std::invalid_argument(std::string("algorithm '") + info.name + "' takes no level");
+        }
+        params.level = static_cast<int>(parseNumber("level", value, static_cast<unsigned long long>(info.minLevel),
+                                                    static_cast<unsigned long long>(info.maxLevel)));
+    }
+    params.blockSize = info.defaultBlock;
+    if (lookup("block", "X-Compression-Block-Size", value)) {
+        if (info.maxBlock == 0) {
+            throw std::invalid_argument(std::string("algorithm '") + info.name + "' takes no block size");
+        }
+        params.blockSize = static_cast<size_t>(parseNumber("block size", value, info.minBlock, info.maxBlock));
+    }
+    return params;
+}
+
+CompressionApi::CompressionApi(size_t cacheBytes) {
+    if (cacheBytes > 0) {
+        cache.reset(new ResultCache(cacheBytes));
+    }
+}
+
+void CompressionApi::setWorkerPool(std::shared_ptr<WorkerPool> p) {
+    pool = std::move(p);
+}
+
+void CompressionApi::setSpoolDirectory(std::string directory) {
+    spoolDirectory = std::move(directory);
+}
+
 HttpResponse CompressionApi::handle(const HttpRequest& req) const {
+    HttpResponse res = respond(req);
+    Metrics::recordRequest(Metrics::endpointFor(req.method, req.path), res.statusCode, req.bodyView().size(),
+                           res.bodySize());
+    return res;
+}
+
+bool CompressionApi::preflight(const HttpRequest& req, HttpResponse& rejection) const {
+    const bool getEndpoint = req.path == "/health" || req.path == "/algorithms" || req.path == "/metrics" ||
+                             req.path == "/debug/allocations";
+    if (req.method == "OPTIONS" || (req.method == "GET" && getEndpoint)) {
+        return true;
+    }
+    if (req.method != "POST") {
+        rejection = textError(405, "Only POST is supported.\n");
+    } else if (req.path == "/decompress" || req.path == "/batch/decompress") {
+        return true;
+    } else if (req.path != "/compress" && req.path != "/batch/compress") {
+        rejection = textError(404, "Unknown endpoint.\n");
+    } else {
+        try {
+            (void)codecParams(req);
+            return true;
+        } catch (const std::exception& e) {
+            rejection = textError(400, std::string("Error: ") + e.what() + "\n");
+        }
+    }
+    Metrics::recordRequest(Metrics::endpointFor(req.method, req.path), rejection.statusCode, 0, rejection.body.size());
+    return false;
+}
+
+HttpResponse CompressionApi::respond(const HttpRequest& req) const {
     // Handle CORS preflight from browsers.
     if (req.method == "OPTIONS") {
         HttpResponse res;
         res.statusCode = 204;
         res.statusText = "No Content";
-        res.headers["Access-Control-Allow-Origin"] = "*";
-        res.headers["Access-Control-Allow-Methods"] = "POST, OPTIONS";
-        res.headers["Access-Control-Allow-Headers"] = "Content-Type, Accept";
+        res.presetHeaders = kCorsHeaders;
         return res;
     }
 
@@ -36,37 +280,46 @@ HttpResponse CompressionApi::handle(const HttpRequest& req) const {
         HttpResponse res;
         res.statusCode = 200;
         res.statusText = "OK";
-        res.headers["Content-Type"] = "text/plain; charset=utf-8";
-        res.headers["Access-Control-Allow-Origin"] = "*";
-        res.headers["Access-Control-Allow-Methods"] = "POST, OPTIONS, GET";
-        res.headers["Access-Control-Allow-Headers"] = "Content-Type, Accept";
+        res.presetHeaders = kHealthHeaders;
         const std::string body = "ok\n";
         res.body.assign(body.begin(), body.end());
         return res;
     }
 
+    if (req.method == "GET" && req.path == "/algorithms") {
+        static const ByteBuffer body = ByteBuffer::copyOf(buildAlgorithmsJson());
+        HttpResponse res;
+        res.presetHeaders = kJsonHeaders;
+        res.sharedBody = body;
+        return res;
+    }
+
+    if (req.method == "GET" && req.path == "/metrics") {
+        HttpResponse res;
+        res.presetHeaders = kMetricsHeaders;
+        const std::string body = Metrics::render();
+        res.body.assign(body.begin(), body.end());
+        return res;
+    }
+
+    if (req.method == "GET" && req.path == "/debug/allocations") {
+        HttpResponse res;
+        res.presetHeaders = kJsonHeaders;
+        const std::string body = Instrumentation::renderJson();
+        res.body.assign(body.begin(), body.end());
+        return res;
+    }
+
     if (req.method != "POST") {
         return textError(405, "Only POST is supported.\n");
     }
 
     try {
-        if (req.path == "/compress") {
-            HttpResponse res;
-            res.headers["Content-Type"] = "application/octet-stream";
-            res.headers["Access-Control-Allow-Origin"] = "*";
-            res.headers["Access-Control-Allow-Methods"] = "POST, OPTIONS";
-            res.headers["Access-Control-Allow-Headers"] = "Content-Type, Accept";
-            res.body = algo.compress(req.body);
-            return res;
-        }
-        if (req.path == "/decompress") {
-            HttpResponse res;
-            res.headers["Content-Type"] = "application/octet-stream";
-            res.headers["Access-Control-Allow-Origin"] = "*";
-            res.headers["Access-Control-Allow-Methods"] = "POST, OPTIONS";
-            res.headers["Access-Control-Allow-Headers"] = "Content-Type, Accept";
-            res.body = algo.decompress(req.body);
-            return res;
+        if (req.path == "/compress" || req.path == "/decompress") {
+            return runCodec(req, req.path == "/compress");
+        }
+        if (req.path == "/batch/compress" || req.path == "/batch/decompress") {
+            return runBatch(req, req.path == "/batch/compress");
         }
         return textError(404, "Unknown endpoint.\n");
     } catch (const std::exception& e) {
@@ -74,4 +327,255 @@ HttpResponse CompressionApi::handle(const HttpRequest& req) const {
     }
 }
 
+HttpResponse CompressionApi::runCodec(const HttpRequest& req, bool compressing) const {
+    // The key doubles as the ETag: the response is a pure function of the body and the codec.
+    const CodecParams params = compressing ? codecParams(req) : CodecParams();
+    const std::string_view input = req.bodyView();
+    const ResultCache::Key key = [&] {
+        RequestTrace::Timer hashTimer(RequestTrace::Phase::Hash);
+        return ResultCache::keyFor(codecVariant(compressing, params), input.data(), input.size());
+    }();
+    const std::string etag = "\"" + key.hex() + "\"";
+
+    HttpResponse res;
+    if (matchesIfNoneMatch(req.headers.get("if-none-match"), etag)) {
+        Metrics::recordCache(Metrics::CacheEvent::NotModified);
+        res.statusCode = 304;
+        res.statusText = "Not Modified";
+        res.presetHeaders = kNotModifiedHeaders;
+        res.headers.set("ETag", etag);
+        return res;
+    }
+
+    res.presetHeaders = kBinaryHeaders;
+    if (req.spooledBody) {
+        // Too big for the heap, so too big for the cache as well.
+        res.bodyFile = transformToFile(input, compressing, params);
+    } else {
+        res.sharedBody = transform(req.body, compressing, params, key);
+    }
+    res.headers.set("ETag", etag);
+    const std::string_view output = res.bodyView();
+    if (compressing && !output.empty()) {
+        res.headers.set("X-Compression-Algorithm", codecNameForTag(output[0]));
+    }
+    return res;
+}
+
+std::shared_ptr<SpoolFile> CompressionApi::transformToFile(std::string_view input, bool compressing,
+                                                           const CodecParams& params) const {
+    // The stream codecs produce the same bytes as the one-shot ones, except that adaptive
+    // compression always decides from a sample here: a full trial would need the whole
+    // output twice in memory.
+    std::unique_ptr<StreamCodec> codec;
+    if (compressing) {
+        codec = makeCompressor(params);
+    } else {
+        codec.reset(new AdaptiveStreamDecompressor());
+    }
+    const std::shared_ptr<SpoolFile> file = SpoolFile::create(spoolDirectory);
+    std::vector<char> pending;
+    pending.reserve(64 * 1024);
+    const StreamCodec::Sink sink = [&](const char* data, size_t len) {
+        if (pending.size() + len > pending.capacity()) {
+            file->write(pending.data(), pending.size());
+            pending.clear();
+        }
+        if (len >= pending.capacity()) {
+            file->write(data, len);
+        } else {
+            pending.insert(pending.end(), data, data + len);
+            Instrumentation::recordCopy(len);
+        }
+    };
+
+    const auto start = Metrics::Clock::now();
+    constexpr size_t kSlice = 1024 * 1024;
+    for (size_t pos = 0; pos < input.size(); pos += kSlice) {
+        codec->write(input.data() + pos, std::min(kSlice, input.size() - pos), sink);
+    }
+    codec->finish(sink);
+    file->write(pending.data(), pending.size());
+    const std::string_view output = file->map();
+    const auto elapsed = Metrics::Clock::now() - start;
+    Metrics::recordPhase(Metrics::Phase::Codec, elapsed);
+    RequestTrace::record(RequestTrace::Phase::Codec, elapsed);
+    if (compressing && !output.empty()) {
+        Metrics::recordCompression(Metrics::codecForTag(output[0]), input.size(), output.size());
+    }
+    return file;
+}
+
+ByteBuffer CompressionApi::transform(const ByteBuffer& input, bool compressing, const CodecParams& params,
+                                     const ResultCache::Key& key) const {
+    if (const ResultCache::Value hit = cache ? cache->get(key) : nullptr) {
+        return *hit;
+    }
+    const auto start = Metrics::Clock::now();
+    ByteBuffer out;
+    if (!compressing) {
+        out = algo.decompress(input); // identity payloads: a slice of the request, no copy
+    } else if (params.algorithm == "adaptive" && params.level > kAdaptiveSampledMaxLevel) {
+        out = algo.compress(input.data(), input.size()); // full trial
+    } else {
+        const std::unique_ptr<StreamCodec> codec = makeCompressor(params);
+        std::vector<char> bytes;
+        bytes.reserve(input.size() + 1);
+        const StreamCodec::Sink sink = [&bytes](const char* data, size_t len) {
+            bytes.insert(bytes.end(), data, data + len);
+            Instrumentation::recordCopy(len);
+        };
+        codec->write(input.data(), input.size(), sink);
+        codec->finish(sink);
+        out = std::move(bytes);
+    }
+    const auto elapsed = Metrics::Clock::now() - start;
+    Metrics::recordPhase(Metrics::Phase::Codec, elapsed);
+    RequestTrace::record(RequestTrace::Phase::Codec, elapsed);
+    if (compressing && !out.empty()) {
+        Metrics::recordCompression(Metrics::codecForTag(out[0]), input.size(), out.size());
+    }
+    if (cache) {
+        cache->put(key, out);
+    }
+    return out;
+}
+
+HttpResponse CompressionApi::runBatch(const HttpRequest& req, bool compressing) const {
+    struct Item {
+        size_t offset;
+        size_t length;
+    };
+    std::vector<Item> items;
+    const char* body = req.body.data();
+    const size_t size = req.body.size();
+    for (size_t pos = 0; pos < size;) {
+        if (size - pos < 4) {
+            throw std::runtime_error("truncated batch item length");
+        }
+        const size_t length = readU32BE(body + pos);
+        pos += 4;
+        if (length > size - pos) {
+            throw std::runtime_error("batch item " + std::to_string(items.size()) + " is truncated");
+        }
+        if (items.size() == kMaxBatchItems) {
+            throw std::runtime_error("too many batch items");
+        }
+        items.push_back(Item{pos, length});
+        pos += length;
+    }
+
+    const CodecParams params = compressing ? codecParams(req) : CodecParams();
+    const std::string variant = codecVariant(compressing, params);
+
+    // Each item fails on its own; one bad payload does not sink the batch.
+    std::vector<ByteBuffer> outputs(items.size());
+    std::vector<unsigned char> status(items.size(), kBatchOk);
+    const auto work = [&](size_t i) {
+        try {
+            const ByteBuffer input = req.body.slice(items[i].offset, items[i].length);
+            const ResultCache::Key key = ResultCache::keyFor(variant, input.data(), input.size());
+            outputs[i] = transform(input, compressing, params, key);
+        } catch (const std::exception& e) {
+            status[i] = kBatchError;
+            outputs[i] = ByteBuffer::copyOf(e.what());
+        }
+    };
+    if (pool && items.size() > 1) {
+        pool->forEach(items.size(), size / items.size(), work);
+    } else {
+        for (size_t i = 0; i < items.size(); ++i) {
+            work(i);
+        }
+    }
+
+    HttpResponse res;
+    res.presetHeaders = kBinaryHeaders;
+    size_t total = 0;
+    for (const auto& out : outputs) {
+        total += 5 + out.size();
+    }
+    res.body.reserve(total);
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (outputs[i].size() > UINT32_MAX) {
+            throw std::runtime_error("batch result too large");
+        }
+        res.body.push_back(static_cast<char>(status[i]));
+        appendU32BE(res.body, static_cast<uint32_t>(outputs[i].size()));
+        res.body.insert(res.body.end(), outputs[i].begin(), outputs[i].end());
+        Instrumentation::recordCopy(outputs[i].size());
+    }
+    return res;
+}
+
+void CompressionApi::install(HttpServer& server) const {
+    server.setHandler([this](const HttpRequest& req) { return handle(req); });
+    server.setPreflightHandler([this](const HttpRequest& req, HttpResponse& rejection) {
+        return preflight(req, rejection);
+    });
+    server.setStreamHandler([this](const HttpRequest& req, HttpBodyReader& in, HttpResponseWriter& out) {
+        return handleStream(req, in, out);
+    });
+}
+
+bool CompressionApi::handleStream(const HttpRequest& req, HttpBodyReader& in, HttpResponseWriter& out) const {
+    if (req.method != "POST" || (req.path != "/compress" && req.path != "/decompress")) {
+        return false;
+    }
+    // A streamed response goes out before its ETag could be known, so bodies whose result the
+    // cache can hold are left to handle(): cache hits, ETags and 304s apply to them as well.
+    if (cache && !req.headers.has("transfer-encoding")) {
+        const std::string_view length = req.headers.get("content-length");
+        size_t bytes = 0;
+        const auto parsed = std::from_chars(length.data(), length.data() + length.size(), bytes);
+        if (parsed.ec == std::errc() && parsed.ptr == length.data() + length.size() && bytes <= cache->maxValueBytes()) {
+            return false;
+        }
+    }
+
+    const bool compressing = req.path == "/compress";
+    std::unique_ptr<StreamCodec> codec;
+    if (compressing) {
+        codec = makeCompressor(codecParams(req)); // bad parameters: 400 before any output
+    } else {
+        codec.reset(new AdaptiveStreamDecompressor());
+    }
+
+    HttpResponse head;
+    head.presetHeaders = kBinaryHeaders;
+    out.start(head);
+
+    size_t bytesIn = 0;
+    size_t bytesOut = 0;
+    char tag = 0;
+    const StreamCodec::Sink sink = [&](const char* data, size_t len) {
+        if (bytesOut == 0 && len > 0) tag = data[0];
+        bytesOut += len;
+        out.write(data, len);
+    };
 
+    // Codec time here includes handing output to the writer, but not waiting for input.
+    // Codec errors surface as exceptions; HttpServer answers them (400 if nothing was sent
+    // yet) and counts the request.
+    Metrics::Clock::duration codecTime{};
+    std::vector<char> buf(64 * 1024);
+    size_t n;
+    while ((n = in.read(buf.data(), buf.size())) > 0) {
+        bytesIn += n;
+        const auto start = Metrics::Clock::now();
+        codec->write(buf.data(), n, sink);
+        codecTime += Metrics::Clock::now() - start;
+    }
+    const auto start = Metrics::Clock::now();
+    codec->finish(sink);
+    codecTime += Metrics::Clock::now() - start;
+    out.finish();
+
+    Metrics::recordPhase(Metrics::Phase::Codec, codecTime);
+    RequestTrace::record(RequestTrace::Phase::Codec, codecTime);
+    if (compressing && bytesOut > 0) {
+        Metrics::recordCompression(Metrics::codecForTag(tag), bytesIn, bytesOut);
+    }
+    Metrics::recordRequest(Metrics::endpointFor(req.method, req.path), 200, bytesIn, bytesOut);
+    return true;
+}
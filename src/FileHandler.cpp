@@ -1,4 +1,5 @@
 #include "FileHandler.h"
+#include "Instrumentation.h"
 #include <fstream>
 #include <stdexcept>
 
@@ -22,6 +23,7 @@ std::vector<char> FileHandler::readFile(const std::string& filename) {
     std::vector<char> data(static_cast<size_t>(size));
     if (!data.empty()) {
         in.read(data.data(), static_cast<std::streamsize>(data.size()));
+        Instrumentation::recordCopy(data.size());
         if (!in) {
             // If the stream enters a failed state, the read did not complete.
             throw std::runtime_error("FileHandler::readFile: failed to read '" + filename + "'");
@@ -40,6 +42,7 @@ void FileHandler::writeFile(const std::string& filename, const std::vector<char>
     if (!data.empty()) {
         // Write all bytes in a single operation (binary-safe).
         out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        Instrumentation::recordCopy(data.size());
         if (!out) {
             throw std::runtime_error("FileHandler::writeFile: failed to write '" + filename + "'");
         }
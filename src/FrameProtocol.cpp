@@ -0,0 +1,72 @@
+#include "FrameProtocol.h"
+#include "SocketIo.h"
+
+#include <exception>
+#include <string>
+
+#include <unistd.h>
+
+namespace {
+void encodeHeader(char type, uint32_t len, char* out) {
+    out[0] = type;
+    out[1] = static_cast<char>((len >> 24) & 0xFF);
+    out[2] = static_cast<char>((len >> 16) & 0xFF);
+    out[3] = static_cast<char>((len >> 8) & 0xFF);
+    out[4] = static_cast<char>(len & 0xFF);
+}
+
+uint32_t decodeLength(const char* in) {
+    return (static_cast<uint32_t>(static_cast<unsigned char>(in[1])) << 24) |
+           (static_cast<uint32_t>(static_cast<unsigned char>(in[2])) << 16) |
+           (static_cast<uint32_t>(static_cast<unsigned char>(in[3])) << 8) |
+           static_cast<uint32_t>(static_cast<unsigned char>(in[4]));
+}
+} // namespace
+
+bool FrameProtocol::writeFrame(int sock, char type, const std::vector<char>& payload) {
+    if (payload.size() > kMaxPayload) {
+        return false;
+    }
+    char header[kHeaderSize];
+    encodeHeader(type, static_cast<uint32_t>(payload.size()), header);
+    // Header and payload leave in one sendmsg() so small frames are a single TCP segment.
+    const SocketIo::ConstSlice slices[] = {{header, sizeof(header)}, {payload.data(), payload.size()}};
+    return SocketIo::sendv(sock, slices, 2);
+}
+
+bool FrameProtocol::readFrame(int sock, char& type, std::vector<char>& payload) {
+    char header[kHeaderSize];
+    if (!SocketIo::recvExact(sock, header, sizeof(header))) {
+        return false;
+    }
+    const uint32_t len = decodeLength(header);
+    if ((header[0] != kData && header[0] != kError) || len > kMaxPayload) {
+        return false;
+    }
+    type = header[0];
+    payload.resize(len);
+    return len == 0 || SocketIo::recvExact(sock, payload.data(), len);
+}
+
+std::function<void(int)> FrameProtocol::makeHandler(Processor fn) {
+    return [fn](int clientSock) {
+        char type = 0;
+        std::vector<char> request;
+        while (readFrame(clientSock, type, request)) {
+            if (type != kData) {
+                break;
+            }
+            bool ok = false;
+            try {
+                ok = writeFrame(clientSock, kData, fn(request));
+            } catch (const std::exception& e) {
+                const std::string msg = e.what();
+                ok = writeFrame(clientSock, kError, std::vector<char>(msg.begin(), msg.end()));
+            }
+            if (!ok) {
+                break;
+            }
+        }
+        ::close(clientSock);
+    };
+}
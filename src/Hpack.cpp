@@ -0,0 +1,416 @@
+#include "Hpack.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+struct HuffmanCode {
+    uint32_t bits;
+    uint8_t length;
+};
+
+// RFC 7541 Appendix B; entry 256 is EOS.
+constexpr HuffmanCode kHuffmanCodes[257] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+    {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+    {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+    {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+    {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+    {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},
+    {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+    {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},
+    {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},
+    {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+    {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+    {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},
+    {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},
+    {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+    {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+    {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},
+    {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},
+    {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+    {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+    {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},
+    {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+    {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+    {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+    {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+    {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},
+    {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},
+    {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+    {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+    {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},
+    {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+    {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+    {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+    {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+    {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+    {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},
+    {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+    {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+    {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+    {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+    {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},
+    {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+    {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+    {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+    {0x3fffffff, 30},
+};
+
+// RFC 7541 Appendix A.
+constexpr std::pair<std::string_view, std::string_view> kStaticTable[HpackTable::kStaticEntries] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+// Binary decoding tree over kHuffmanCodes; leaves carry the symbol.
+struct HuffmanNode {
+    int16_t child[2] = {-1, -1};
+    int16_t symbol = -1;
+};
+
+const std::vector<HuffmanNode>& huffmanTree() {
+    static const std::vector<HuffmanNode> tree = []() {
+        std::vector<HuffmanNode> nodes(1);
+        nodes.reserve(513);
+        for (int sym = 0; sym < 257; ++sym) {
+            const HuffmanCode code = kHuffmanCodes[sym];
+            size_t node = 0;
+            for (int bit = code.length - 1; bit >= 0; --bit) {
+                const int b = (code.bits >> bit) & 1;
+                if (nodes[node].child[b] < 0) {
+                    nodes[node].child[b] = static_cast<int16_t>(nodes.size());
+                    nodes.emplace_back();
+                }
+                node = static_cast<size_t>(nodes[node].child[b]);
+            }
+            nodes[node].symbol = static_cast<int16_t>(sym);
+        }
+        return nodes;
+    }();
+    return tree;
+}
+
+[[noreturn]] void malformed(const char* what) {
+    throw std::runtime_error(std::string("HpackDecoder::decode: ") + what);
+}
+
+// RFC 7541 5.1: `prefixBits`-bit prefix integer, first byte's high bits set to `flags`.
+void encodeInt(std::string& out, uint8_t flags, int prefixBits, size_t value) {
+    const size_t max = (static_cast<size_t>(1) << prefixBits) - 1;
+    if (value < max) {
+        out.push_back(static_cast<char>(flags | value));
+        return;
+    }
+    out.push_back(static_cast<char>(flags | max));
+    value -= max;
+    while (value >= 128) {
+        out.push_back(static_cast<char>(0x80 | (value & 0x7F)));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+size_t decodeInt(const uint8_t*& p, const uint8_t* end, int prefixBits) {
+    const size_t max = (static_cast<size_t>(1) << prefixBits) - 1;
+    size_t value = *p++ & max;
+    if (value < max) return value;
+    for (int shift = 0;; shift += 7) {
+        if (p == end) malformed("truncated integer");
+        if (shift > 28) malformed("integer too large");
+        const uint8_t b = *p++;
+        value += static_cast<size_t>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) return value;
+    }
+}
+
+void encodeString(std::string& out, std::string_view s) {
+    const size_t huffman = HpackHuffman::encodedSize(s);
+    if (huffman < s.size()) {
+        encodeInt(out, 0x80, 7, huffman);
+        HpackHuffman::encode(s, out);
+    } else {
+        encodeInt(out, 0x00, 7, s.size());
+        out.append(s.data(), s.size());
+    }
+}
+
+std::string decodeString(const uint8_t*& p, const uint8_t* end) {
+    if (p == end) malformed("truncated string");
+    const bool huffman = (*p & 0x80) != 0;
+    const size_t len = decodeInt(p, end, 7);
+    if (len > static_cast<size_t>(end - p)) malformed("truncated string");
+    std::string s;
+    if (huffman) {
+        if (!HpackHuffman::decode(reinterpret_cast<const char*>(p), len, s)) malformed("bad Huffman code");
+    } else {
+        s.assign(reinterpret_cast<const char*>(p), len);
+    }
+    p += len;
+    return s;
+}
+
+// Fields that differ on (nearly) every response would only push useful entries out.
+bool worthIndexing(std::string_view name) {
+    return name != "content-length" && name != "etag" && name != "date" && name != "last-modified" &&
+           name != "set-cookie" && name != "server-timing";
+}
+} // namespace
+
+size_t HpackHuffman::encodedSize(std::string_view s) {
+    size_t bits = 0;
+    for (unsigned char c : s) bits += kHuffmanCodes[c].length;
+    return (bits + 7) / 8;
+}
+
+void HpackHuffman::encode(std::string_view s, std::string& out) {
+    uint64_t acc = 0;
+    int pending = 0;
+    for (unsigned char c : s) {
+        acc = (acc << kHuffmanCodes[c].length) | kHuffmanCodes[c].bits;
+        pending += kHuffmanCodes[c].length;
+        while (pending >= 8) {
+            pending -= 8;
+            out.push_back(static_cast<char>(acc >> pending));
+        }
+    }
+    if (pending > 0) {
+        // Pad with the most significant bits of EOS (all ones).
+        out.push_back(static_cast<char>((acc << (8 - pending)) | (0xFF >> pending)));
+    }
+}
+
+bool HpackHuffman::decode(const char* data, size_t len, std::string& out) {
+    const auto& tree = huffmanTree();
+    size_t node = 0;
+    int depth = 0; // bits since the last complete symbol
+    bool allOnes = true;
+    for (size_t i = 0; i < len; ++i) {
+        const uint8_t byte = static_cast<uint8_t>(data[i]);
+        for (int bit = 7; bit >= 0; --bit) {
+            const int b = (byte >> bit) & 1;
+            const int16_t next = tree[node].child[b];
+            if (next < 0) return false;
+            node = static_cast<size_t>(next);
+            ++depth;
+            allOnes = allOnes && b == 1;
+            if (tree[node].symbol >= 0) {
+                if (tree[node].symbol == 256) return false; // EOS must not be encoded
+                out.push_back(static_cast<char>(tree[node].symbol));
+                node = 0;
+                depth = 0;
+                allOnes = true;
+            }
+        }
+    }
+    // Padding: fewer than 8 bits, all ones (a prefix of EOS).
+    return depth < 8 && allOnes;
+}
+
+void HpackTable::insert(std::string_view name, std::string_view value) {
+    const size_t entryBytes = name.size() + value.size() + 32;
+    if (entryBytes > maxBytes) {
+        // Not an error: the table just ends up empty (RFC 7541 4.4).
+        evictTo(0);
+        return;
+    }
+    evictTo(maxBytes - entryBytes);
+    entries.emplace_front(std::string(name), std::string(value));
+    bytes += entryBytes;
+}
+
+void HpackTable::setMaxSize(size_t newSize) {
+    maxBytes = newSize;
+    evictTo(maxBytes);
+}
+
+void HpackTable::evictTo(size_t limit) {
+    while (bytes > limit && !entries.empty()) {
+        bytes -= entries.back().first.size() + entries.back().second.size() + 32;
+        entries.pop_back();
+    }
+}
+
+std::pair<std::string_view, std::string_view> HpackTable::get(size_t index) const {
+    if (index >= 1 && index <= kStaticEntries) {
+        return kStaticTable[index - 1];
+    }
+    if (index > kStaticEntries && index - kStaticEntries <= entries.size()) {
+        const auto& entry = entries[index - kStaticEntries - 1];
+        return {entry.first, entry.second};
+    }
+    throw std::runtime_error("HpackTable::get: index out of range");
+}
+
+size_t HpackTable::find(std::string_view name, std::string_view value, size_t& nameIndex) const {
+    nameIndex = 0;
+    for (size_t i = 0; i < kStaticEntries; ++i) {
+        if (kStaticTable[i].first != name) continue;
+        if (kStaticTable[i].second == value) return i + 1;
+        if (nameIndex == 0) nameIndex = i + 1;
+    }
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].first != name) continue;
+        if (entries[i].second == value) return kStaticEntries + i + 1;
+        if (nameIndex == 0) nameIndex = kStaticEntries + i + 1;
+    }
+    return 0;
+}
+
+bool HpackDecoder::decode(const char* data, size_t len, HttpHeaders& out, size_t maxListSize) {
+    const auto* p = reinterpret_cast<const uint8_t*>(data);
+    const auto* end = p + len;
+    size_t listSize = 0;
+    bool complete = true;
+    bool sawField = false;
+    const auto emit = [&](std::string_view name, std::string_view value) {
+        sawField = true;
+        listSize += name.size() + value.size() + 32;
+        if (listSize > maxListSize) {
+            complete = false;
+            return;
+        }
+        out.add(name, value);
+    };
+
+    while (p < end) {
+        const uint8_t b = *p;
+        if (b & 0x80) {
+            // Indexed field.
+            const size_t index = decodeInt(p, end, 7);
+            if (index == 0) malformed("index 0");
+            const auto field = table.get(index);
+            emit(field.first, field.second);
+        } else if ((b & 0xE0) == 0x20) {
+            // Dynamic table size update: only before the first field of a block.
+            if (sawField) malformed("table size update after a field");
+            const size_t size = decodeInt(p, end, 5);
+            if (size > settingsMax) malformed("table size above the advertised limit");
+            table.setMaxSize(size);
+        } else {
+            // Literal: with incremental indexing (01), without (0000) or never indexed (0001).
+            const bool index = (b & 0x40) != 0;
+            const size_t nameIndex = decodeInt(p, end, index ? 6 : 4);
+            const std::string name = nameIndex ? std::string(table.get(nameIndex).first) : decodeString(p, end);
+            const std::string value = decodeString(p, end);
+            emit(name, value);
+            if (index) table.insert(name, value);
+        }
+    }
+    return complete;
+}
+
+void HpackEncoder::setMaxTableSize(size_t bytes) {
+    // Never more than the 4 KiB default: larger tables cost memory for little gain here.
+    const size_t size = std::min<size_t>(bytes, 4096);
+    pendingMinSize = std::min(pendingMinSize, size);
+    table.setMaxSize(size);
+    sizeChanged = true;
+}
+
+void HpackEncoder::beginBlock(std::string& out) {
+    if (!sizeChanged) return;
+    // RFC 7541 4.2: signal the smallest size since the last block, then the final one.
+    if (pendingMinSize < table.maxSize()) {
+        encodeInt(out, 0x20, 5, pendingMinSize);
+    }
+    encodeInt(out, 0x20, 5, table.maxSize());
+    pendingMinSize = SIZE_MAX;
+    sizeChanged = false;
+}
+
+void HpackEncoder::add(std::string_view name, std::string_view value, std::string& out) {
+    size_t nameIndex = 0;
+    const size_t index = table.find(name, value, nameIndex);
+    if (index != 0) {
+        encodeInt(out, 0x80, 7, index);
+        return;
+    }
+    const bool indexing = worthIndexing(name) && name.size() + value.size() + 32 <= table.maxSize() / 2;
+    encodeInt(out, indexing ? 0x40 : 0x00, indexing ? 6 : 4, nameIndex);
+    if (nameIndex == 0) encodeString(out, name);
+    encodeString(out, value);
+    if (indexing) table.insert(name, value);
+}
@@ -0,0 +1,840 @@
+#include "Http2Session.h"
+#include "Instrumentation.h"
+#include "SocketIo.h"
+#include "SpoolFile.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "platform/socket_init.h"
+
+namespace {
+constexpr char kPreface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+constexpr size_t kPrefaceBytes = 24;
+constexpr size_t kFrameHeaderBytes = 9;
+constexpr size_t kMaxFrameBytes = 16384; // our SETTINGS_MAX_FRAME_SIZE (the protocol default)
+constexpr int64_t kMaxWindow = INT32_MAX;
+// The writer gathers up to this much into one sendmsg(); DATA payloads up to kInlineBytes
+// are copied into the batch, larger ones are sent from the response buffer itself.
+constexpr size_t kWriteBatchBytes = 256 * 1024;
+constexpr size_t kInlineBytes = 1024;
+
+enum FrameType : uint8_t {
+    kData = 0x0,
+    kHeaders = 0x1,
+    kPriority = 0x2,
+    kRstStream = 0x3,
+    kSettings = 0x4,
+    kPushPromise = 0x5,
+    kPing = 0x6,
+    kGoAway = 0x7,
+    kWindowUpdate = 0x8,
+    kContinuation = 0x9
+};
+
+enum FrameFlag : uint8_t { kEndStream = 0x1, kAck = 0x1, kEndHeaders = 0x4, kPadded = 0x8, kPriorityFlag = 0x20 };
+
+enum SettingId : uint16_t {
+    kHeaderTableSize = 0x1,
+    kEnablePush = 0x2,
+    kMaxConcurrentStreams = 0x3,
+    kInitialWindowSize = 0x4,
+    kMaxFrameSize = 0x5,
+    kMaxHeaderListSize = 0x6
+};
+
+enum ErrorCode : uint32_t {
+    kNoError = 0x0,
+    kProtocolError = 0x1,
+    kInternalError = 0x2,
+    kFlowControlError = 0x3,
+    kFrameSizeError = 0x6,
+    kRefusedStream = 0x7,
+    kCompressionError = 0x9,
+    kEnhanceYourCalm = 0xb
+};
+
+/**
+ * A connection error (RFC 9113 5.4.1): answered with GOAWAY(code), then the connection closes.
+ */
+class ConnectionError : public std::runtime_error {
+public:
+    ConnectionError(uint32_t code, const char* what) : std::runtime_error(what), code(code) {}
+
+    uint32_t code;
+};
+
+uint32_t readU32(const char* p) {
+    const auto* b = reinterpret_cast<const uint8_t*>(p);
+    return (uint32_t{b[0]} << 24) | (uint32_t{b[1]} << 16) | (uint32_t{b[2]} << 8) | b[3];
+}
+
+void appendU32(std::string& out, uint32_t v) {
+    const char bytes[] = {static_cast<char>(v >> 24), static_cast<char>(v >> 16), static_cast<char>(v >> 8),
+                          static_cast<char>(v)};
+    out.append(bytes, 4);
+}
+
+void appendFrameHeader(std::string& out, size_t len, uint8_t type, uint8_t flags, uint32_t id) {
+    const char bytes[] = {static_cast<char>(len >> 16), static_cast<char>(len >> 8), static_cast<char>(len),
+                          static_cast<char>(type), static_cast<char>(flags)};
+    out.append(bytes, 5);
+    appendU32(out, id & 0x7FFFFFFF);
+}
+
+void appendSetting(std::string& out, uint16_t id, uint32_t value) {
+    out.push_back(static_cast<char>(id >> 8));
+    out.push_back(static_cast<char>(id));
+    appendU32(out, value);
+}
+
+// Removes the pad-length byte and padding of a PADDED DATA or HEADERS payload.
+void stripPadding(uint8_t flags, const char*& payload, size_t& len) {
+    if ((flags & kPadded) == 0) return;
+    if (len == 0) throw ConnectionError(kProtocolError, "padded frame without pad length");
+    const size_t pad = static_cast<uint8_t>(payload[0]);
+    if (pad >= len) throw ConnectionError(kProtocolError, "padding exceeds frame payload");
+    ++payload;
+    len -= 1 + pad;
+}
+
+// base64url without padding (RFC 4648 5), as used by the HTTP2-Settings header.
+bool decodeBase64Url(std::string_view in, std::string& out) {
+    uint32_t acc = 0;
+    int bits = 0;
+    for (char c : in) {
+        int v;
+        if (c >= 'A' && c <= 'Z') v = c - 'A';
+        else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') v = c - '0' + 52;
+        else if (c == '-' || c == '+') v = 62;
+        else if (c == '_' || c == '/') v = 63;
+        else if (c == '=') break;
+        else return false;
+        acc = (acc << 6) | static_cast<uint32_t>(v);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>(acc >> bits));
+        }
+    }
+    return true;
+}
+
+// Connection-specific fields have no meaning in HTTP/2 (RFC 9113 8.2.2); content-length is
+// regenerated from the body.
+bool isConnectionSpecific(std::string_view name) {
+    return name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+           name == "transfer-encoding" || name == "upgrade" || name == "http2-settings";
+}
+
+std::string lowercase(std::string_view s) {
+    std::string out(s);
+    for (char& c : out) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+    return out;
+}
+
+HttpResponse statusResponse(int status, const char* reason, const std::string& message, int retryAfterSeconds) {
+    HttpResponse res;
+    res.statusCode = status;
+    res.statusText = reason;
+    res.headers.set("Content-Type", "text/plain; charset=utf-8");
+    if (status == 503 && retryAfterSeconds > 0) {
+        res.headers.set("Retry-After", std::to_string(retryAfterSeconds));
+    }
+    const std::string body = std::string(reason) + ": " + message + "\n";
+    res.body.assign(body.begin(), body.end());
+    return res;
+}
+
+size_t streamWindowOf(const HttpServerOptions& options) {
+    return std::min<size_t>(std::max<size_t>(options.http2StreamWindow, 65535), kMaxWindow);
+}
+
+// Room for many streams' windows at once, so the connection window is rarely the limit.
+size_t connectionWindowOf(const HttpServerOptions& options) {
+    return std::min<size_t>(streamWindowOf(options) * 16, kMaxWindow);
+}
+} // namespace
+
+Http2Session::Http2Session(int sock, const HttpServerOptions& options, WorkerPool& compute,
+                           const HttpServer::Handler& handler, const HttpServer::PreflightHandler& preflight,
+                           const std::atomic<bool>& running, std::atomic<size_t>& inFlightBytes)
+    : sock(sock), options(options), compute(compute), handler(handler), preflight(preflight), running(running),
+      inFlightBytes(inFlightBytes), decoder(4096) {}
+
+Http2Session::~Http2Session() {
+    if (writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closing = true;
+        }
+        writerWake.notify_all();
+        writer.join();
+    }
+}
+
+void Http2Session::run(std::string buffer, HttpRequest* upgraded) {
+    writer = std::thread(&Http2Session::writerLoop, this);
+    uint32_t goAwayCode = kNoError;
+    try {
+        // Server connection preface: our SETTINGS, then the larger connection window.
+        std::string settings;
+        appendSetting(settings, kMaxConcurrentStreams, static_cast<uint32_t>(options.http2MaxStreams));
+        appendSetting(settings, kInitialWindowSize, static_cast<uint32_t>(streamWindowOf(options)));
+        appendSetting(settings, kMaxHeaderListSize, static_cast<uint32_t>(std::min<size_t>(options.maxHeaderBytes, UINT32_MAX)));
+        queueControl(kSettings, 0, 0, settings.data(), settings.size());
+        std::string increment;
+        appendU32(increment, static_cast<uint32_t>(connectionWindowOf(options) - 65535));
+        queueControl(kWindowUpdate, 0, 0, increment.data(), increment.size());
+        connectionWindow = static_cast<int64_t>(connectionWindowOf(options));
+
+        if (upgraded) {
+            // The 101 response acknowledges HTTP2-Settings implicitly (RFC 7540 3.2.1).
+            std::string raw;
+            if (!decodeBase64Url(upgraded->headers.get("http2-settings"), raw) || raw.size() % 6 != 0) {
+                throw ConnectionError(kProtocolError, "invalid HTTP2-Settings");
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (size_t i = 0; i < raw.size(); i += 6) {
+                    applySetting(static_cast<uint16_t>((static_cast<uint8_t>(raw[i]) << 8) | static_cast<uint8_t>(raw[i + 1])),
+                                 readU32(raw.data() + i + 2));
+                }
+                sendWindows[1] = peerInitialWindow;
+            }
+            lastStreamId = 1;
+            Incoming stream;
+            stream.req = std::move(*upgraded);
+            dispatch(1, std::move(stream));
+        }
+
+        const auto receive = [&]() {
+            while (true) {
+                if (!running) return false;
+                bool idle;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (broken) return false;
+                    idle = sendWindows.empty();
+                }
+                if (idle && peerGoingAway) return false;
+                if (SocketIo::waitReadable(sock, idle ? options.idleTimeoutMs : 1000)) break;
+                if (idle) return false; // idle timeout
+            }
+            const size_t used = buffer.size();
+            buffer.resize(used + 64 * 1024);
+            ssize_t n;
+            do {
+                n = ::recv(sock, &buffer[used], 64 * 1024, 0);
+            } while (n < 0 && errno == EINTR);
+            buffer.resize(used + static_cast<size_t>(n > 0 ? n : 0));
+            return n > 0;
+        };
+
+        bool open = true;
+        while (open && buffer.size() < kPrefaceBytes) open = receive();
+        if (open) {
+            if (buffer.compare(0, kPrefaceBytes, kPreface, kPrefaceBytes) != 0) {
+                throw ConnectionError(kProtocolError, "invalid connection preface");
+            }
+            size_t pos = kPrefaceBytes;
+            while (true) {
+                while (parseFrame(buffer, pos)) {
+                }
+                buffer.erase(0, pos);
+                pos = 0;
+                if (!receive()) break;
+            }
+        }
+    } catch (const ConnectionError& e) {
+        goAwayCode = e.code;
+    } catch (const std::exception&) {
+        goAwayCode = kInternalError;
+    }
+
+    for (const auto& entry : incoming) releaseInFlight(entry.second.reserved);
+    incoming.clear();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    // Handler jobs refer to this session: wait for all of them. After a clean end, also give
+    // their responses a write timeout's time to go out (a peer may stop reading).
+    progress.wait(lock, [this]() { return pendingJobs == 0; });
+    if (goAwayCode == kNoError) {
+        const int waitMs = options.writeTimeoutMs > 0 ? options.writeTimeoutMs : 30000;
+        progress.wait_for(lock, std::chrono::milliseconds(waitMs), [this]() { return broken || ready.empty(); });
+    }
+    std::string payload;
+    appendU32(payload, lastStreamId);
+    appendU32(payload, goAwayCode);
+    appendFrameHeader(control, payload.size(), kGoAway, 0, 0);
+    control += payload;
+    ready.clear();
+    closing = true;
+    lock.unlock();
+    writerWake.notify_all();
+    writer.join();
+}
+
+bool Http2Session::parseFrame(const std::string& buffer, size_t& pos) {
+    if (buffer.size() - pos < kFrameHeaderBytes) return false;
+    const char* h = buffer.data() + pos;
+    const size_t len = readU32(h) >> 8; // 24-bit length, then the type byte
+    const uint8_t type = static_cast<uint8_t>(h[3]);
+    const uint8_t flags = static_cast<uint8_t>(h[4]);
+    const uint32_t id = readU32(h + 5) & 0x7FFFFFFF;
+    if (len > kMaxFrameBytes) throw ConnectionError(kFrameSizeError, "frame larger than SETTINGS_MAX_FRAME_SIZE");
+    if (buffer.size() - pos < kFrameHeaderBytes + len) return false;
+    const char* payload = h + kFrameHeaderBytes;
+    pos += kFrameHeaderBytes + len;
+
+    if (headerStream != 0 && type != kContinuation) {
+        throw ConnectionError(kProtocolError, "header block interrupted");
+    }
+    switch (type) {
+    case kData:
+        onData(id, flags, payload, len);
+        break;
+    case kHeaders:
+        onHeaders(id, flags, payload, len);
+        break;
+    case kContinuation:
+        if (headerStream == 0 || id != headerStream) throw ConnectionError(kProtocolError, "unexpected CONTINUATION");
+        headerBlock.append(payload, len);
+        if (headerBlock.size() > options.maxHeaderBytes * 4 + kMaxFrameBytes) {
+            throw ConnectionError(kEnhanceYourCalm, "header block too large");
+        }
+        if (flags & kEndHeaders) onHeaderBlock();
+        break;
+    case kPriority:
+        if (len != 5) throw ConnectionError(kFrameSizeError, "PRIORITY of wrong size");
+        break; // advisory; streams are served round-robin
+    case kRstStream: {
+        if (len != 4) throw ConnectionError(kFrameSizeError, "RST_STREAM of wrong size");
+        if (id == 0) throw ConnectionError(kProtocolError, "RST_STREAM on stream 0");
+        const auto it = incoming.find(id);
+        if (it != incoming.end()) {
+            releaseInFlight(it->second.reserved);
+            incoming.erase(it);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        sendWindows.erase(id);
+        ready.remove_if([id](const Outgoing& o) { return o.id == id; });
+        progress.notify_all();
+        break;
+    }
+    case kSettings:
+        if (id != 0) throw ConnectionError(kProtocolError, "SETTINGS on a stream");
+        onSettings(flags, payload, len);
+        break;
+    case kPushPromise:
+        throw ConnectionError(kProtocolError, "PUSH_PROMISE from a client");
+    case kPing:
+        if (len != 8) throw ConnectionError(kFrameSizeError, "PING of wrong size");
+        if (id != 0) throw ConnectionError(kProtocolError, "PING on a stream");
+        if ((flags & kAck) == 0) queueControl(kPing, kAck, 0, payload, len);
+        break;
+    case kGoAway:
+        if (id != 0) throw ConnectionError(kProtocolError, "GOAWAY on a stream");
+        peerGoingAway = true;
+        break;
+    case kWindowUpdate:
+        onWindowUpdate(id, payload, len);
+        break;
+    default:
+        break; // unknown frame types are ignored (RFC 9113 4.1)
+    }
+    return true;
+}
+
+void Http2Session::onHeaders(uint32_t id, uint8_t flags, const char* payload, size_t len) {
+    if (id == 0 || id % 2 == 0) throw ConnectionError(kProtocolError, "HEADERS on an invalid stream");
+    stripPadding(flags, payload, len);
+    if (flags & kPriorityFlag) {
+        if (len < 5) throw ConnectionError(kFrameSizeError, "HEADERS too short for priority");
+        payload += 5;
+        len -= 5;
+    }
+    headerBlock.assign(payload, len);
+    headerStream = id;
+    headerEndStream = (flags & kEndStream) != 0;
+    if (flags & kEndHeaders) onHeaderBlock();
+}
+
+void Http2Session::onHeaderBlock() {
+    const uint32_t id = headerStream;
+    headerStream = 0;
+    HttpHeaders fields;
+    bool complete;
+    try {
+        complete = decoder.decode(headerBlock.data(), headerBlock.size(), fields, options.maxHeaderBytes);
+    } catch (const std::runtime_error&) {
+        throw ConnectionError(kCompressionError, "header block could not be decoded");
+    }
+    headerBlock.clear();
+
+    const auto it = incoming.find(id);
+    if (it != incoming.end()) {
+        // Trailers: they end the request; their fields are not passed on.
+        if (!headerEndStream) throw ConnectionError(kProtocolError, "trailers without END_STREAM");
+        Incoming stream = std::move(it->second);
+        incoming.erase(it);
+        dispatch(id, std::move(stream));
+        return;
+    }
+    if (id <= lastStreamId) {
+        return; // a stream we already answered or reset
+    }
+    lastStreamId = id;
+
+    bool refuse = peerGoingAway || !running;
+    if (!refuse) {
+        std::lock_guard<std::mutex> lock(mutex);
+        refuse = sendWindows.size() >= options.http2MaxStreams;
+    }
+    if (refuse) {
+        resetStream(id, kRefusedStream);
+        return;
+    }
+
+    HttpRequest req;
+    req.version = "HTTP/2.0";
+    std::string_view target;
+    std::string_view authority;
+    bool valid = true;
+    bool regular = false;
+    size_t listBytes = 0;
+    for (const auto field : fields) {
+        const std::string_view name = field.first;
+        listBytes += name.size() + field.second.size() + 32;
+        if (!name.empty() && name[0] == ':') {
+            if (regular) valid = false; // pseudo-headers come first
+            if (name == ":method") req.method = std::string(field.second);
+            else if (name == ":path") target = field.second;
+            else if (name == ":authority") authority = field.second;
+            else if (name != ":scheme") valid = false;
+            continue;
+        }
+        regular = true;
+        if (lowercase(name) != name || isConnectionSpecific(name)) valid = false;
+        req.headers.add(name, field.second);
+    }
+    if (!valid || req.method.empty() || target.empty()) {
+        resetStream(id, kProtocolError);
+        return;
+    }
+    const size_t query = target.find('?');
+    req.path = std::string(target.substr(0, query));
+    if (query != std::string_view::npos) req.query = std::string(target.substr(query + 1));
+    if (!authority.empty() && !req.headers.has("host")) req.headers.add("host", authority);
+    openStream(id, std::move(req), headerEndStream, complete ? listBytes : SIZE_MAX);
+}
+
+void Http2Session::openStream(uint32_t id, HttpRequest req, bool endStream, size_t headerBytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sendWindows[id] = peerInitialWindow;
+    }
+    const HttpRouteLimits* route = options.limitsFor(req.path);
+    const size_t maxHeaderBytes = route && route->maxHeaderBytes ? route->maxHeaderBytes : options.maxHeaderBytes;
+    const size_t maxBodyBytes = route && route->maxBodyBytes ? route->maxBodyBytes : options.maxBodyBytes;
+    // A rejected request is answered right away; RST_STREAM(NO_ERROR) then stops its body.
+    if (headerBytes > maxHeaderBytes) {
+        respond(id, statusResponse(431, "Request Header Fields Too Large", "request headers too large", 0), !endStream);
+        return;
+    }
+    const std::string_view length = req.headers.get("content-length");
+    if (!length.empty()) {
+        size_t n = 0;
+        for (char c : length) {
+            if (c < '0' || c > '9' || n > (SIZE_MAX - 9) / 10) {
+                resetStream(id, kProtocolError);
+                return;
+            }
+            n = n * 10 + static_cast<size_t>(c - '0');
+        }
+        if ((maxBodyBytes > 0 && n > maxBodyBytes) || n > options.maxInFlightBytes) {
+            respond(id, statusResponse(413, "Payload Too Large", "request body too large", 0), !endStream);
+            return;
+        }
+    }
+    if (preflight) {
+        HttpResponse rejection;
+        if (!preflight(req, rejection)) {
+            respond(id, std::move(rejection), !endStream);
+            return;
+        }
+    }
+
+    Incoming stream;
+    stream.req = std::move(req);
+    stream.maxBody = maxBodyBytes;
+    stream.window = static_cast<int64_t>(streamWindowOf(options));
+    if (endStream) {
+        dispatch(id, std::move(stream));
+    } else {
+        incoming.emplace(id, std::move(stream));
+    }
+}
+
+void Http2Session::onData(uint32_t id, uint8_t flags, const char* payload, size_t len) {
+    if (id == 0) throw ConnectionError(kProtocolError, "DATA on stream 0");
+    // Flow control counts the whole payload, padding included.
+    const size_t frameBytes = len;
+    connectionWindow -= static_cast<int64_t>(frameBytes);
+    if (connectionWindow < 0) throw ConnectionError(kFlowControlError, "connection window exceeded");
+    connectionUnacked += frameBytes;
+    if (connectionUnacked >= connectionWindowOf(options) / 2) {
+        std::string increment;
+        appendU32(increment, static_cast<uint32_t>(connectionUnacked));
+        queueControl(kWindowUpdate, 0, 0, increment.data(), increment.size());
+        connectionWindow += static_cast<int64_t>(connectionUnacked);
+        connectionUnacked = 0;
+    }
+    stripPadding(flags, payload, len);
+
+    const auto it = incoming.find(id);
+    if (it == incoming.end()) {
+        if (id > lastStreamId) throw ConnectionError(kProtocolError, "DATA on an idle stream");
+        return; // body of a request that was already answered or reset
+    }
+    Incoming& stream = it->second;
+    const auto drop = [&]() {
+        releaseInFlight(stream.reserved);
+        incoming.erase(it);
+    };
+    stream.window -= static_cast<int64_t>(frameBytes);
+    if (stream.window < 0) {
+        drop();
+        resetStream(id, kFlowControlError);
+        return;
+    }
+    if (stream.maxBody > 0 && len > stream.maxBody - std::min(stream.body.size(), stream.maxBody)) {
+        drop();
+        respond(id, statusResponse(413, "Payload Too Large", "request body too large", 0), true);
+        return;
+    }
+    // Admission control, as for HTTP/1.x bodies: retry later rather than run out of memory.
+    size_t current = inFlightBytes.load(std::memory_order_relaxed);
+    do {
+        if (len > options.maxInFlightBytes || current > options.maxInFlightBytes - len) {
+            drop();
+            respond(id, statusResponse(503, "Service Unavailable", "server is busy", options.retryAfterSeconds), true);
+            return;
+        }
+    } while (!inFlightBytes.compare_exchange_weak(current, current + len, std::memory_order_relaxed));
+    stream.reserved += len;
+    stream.body.insert(stream.body.end(), payload, payload + len);
+    Instrumentation::recordCopy(len);
+
+    if (flags & kEndStream) {
+        Incoming done = std::move(stream);
+        incoming.erase(it);
+        dispatch(id, std::move(done));
+        return;
+    }
+    stream.unacked += frameBytes;
+    if (stream.unacked >= streamWindowOf(options) / 2) {
+        std::string increment;
+        appendU32(increment, static_cast<uint32_t>(stream.unacked));
+        queueControl(kWindowUpdate, 0, id, increment.data(), increment.size());
+        stream.window += static_cast<int64_t>(stream.unacked);
+        stream.unacked = 0;
+    }
+}
+
+void Http2Session::onSettings(uint8_t flags, const char* payload, size_t len) {
+    if (flags & kAck) {
+        if (len != 0) throw ConnectionError(kFrameSizeError, "SETTINGS ack with payload");
+        return;
+    }
+    if (len % 6 != 0) throw ConnectionError(kFrameSizeError, "SETTINGS of wrong size");
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < len; i += 6) {
+            applySetting(static_cast<uint16_t>((static_cast<uint8_t>(payload[i]) << 8) | static_cast<uint8_t>(payload[i + 1])),
+                         readU32(payload + i + 2));
+        }
+    }
+    queueControl(kSettings, kAck, 0, "", 0);
+}
+
+// Caller holds `mutex`.
+void Http2Session::applySetting(uint16_t id, uint32_t value) {
+    switch (id) {
+    case kHeaderTableSize:
+        encoder.setMaxTableSize(value);
+        break;
+    case kEnablePush:
+        if (value > 1) throw ConnectionError(kProtocolError, "invalid SETTINGS_ENABLE_PUSH");
+        break;
+    case kInitialWindowSize: {
+        if (value > static_cast<uint32_t>(kMaxWindow)) throw ConnectionError(kFlowControlError, "window too large");
+        // Applies retroactively to every open stream (RFC 9113 6.9.2).
+        const int64_t delta = static_cast<int64_t>(value) - peerInitialWindow;
+        for (auto& entry : sendWindows) {
+            entry.second += delta;
+            if (entry.second > kMaxWindow) throw ConnectionError(kFlowControlError, "window too large");
+        }
+        peerInitialWindow = value;
+        break;
+    }
+    case kMaxFrameSize:
+        if (value < 16384 || value > 16777215) throw ConnectionError(kProtocolError, "invalid SETTINGS_MAX_FRAME_SIZE");
+        peerMaxFrame = value;
+        break;
+    default:
+        break; // MAX_CONCURRENT_STREAMS (we never push), MAX_HEADER_LIST_SIZE, unknown
+    }
+    writerWake.notify_one();
+}
+
+void Http2Session::onWindowUpdate(uint32_t id, const char* payload, size_t len) {
+    if (len != 4) throw ConnectionError(kFrameSizeError, "WINDOW_UPDATE of wrong size");
+    const uint32_t increment = readU32(payload) & 0x7FFFFFFF;
+    if (increment == 0) {
+        if (id == 0) throw ConnectionError(kProtocolError, "WINDOW_UPDATE of 0");
+        resetStream(id, kProtocolError);
+        return;
+    }
+    bool overflow = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (id == 0) {
+            connectionSendWindow += increment;
+            if (connectionSendWindow > kMaxWindow) throw ConnectionError(kFlowControlError, "window too large");
+        } else {
+            const auto it = sendWindows.find(id);
+            if (it != sendWindows.end()) {
+                it->second += increment;
+                overflow = it->second > kMaxWindow;
+            }
+        }
+    }
+    if (overflow) {
+        resetStream(id, kFlowControlError);
+        return;
+    }
+    writerWake.notify_one();
+}
+
+void Http2Session::dispatch(uint32_t id, Incoming stream) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++pendingJobs;
+    }
+    auto req = std::make_shared<HttpRequest>(std::move(stream.req));
+    if (!stream.body.empty()) req->body = ByteBuffer(std::move(stream.body));
+    const size_t reserved = stream.reserved;
+    // Same executor boundary as HTTP/1.x: codec work runs on the compute pool.
+    compute.submit(req->body.size(), [this, id, req, reserved]() {
+        HttpResponse res;
+        // Only the handler's share is attributed here: frames of many streams are read and
+        // written on shared threads.
+        Instrumentation::Counters counters;
+        if (!handler) {
+            res = statusResponse(500, "Internal Server Error", "no handler configured", 0);
+        } else {
+            Instrumentation::Scope scope(counters);
+            try {
+                res = handler(*req);
+            } catch (const std::exception& e) {
+                res = statusResponse(400, "Bad Request", e.what(), 0);
+            }
+        }
+        Instrumentation::recordRequest(counters.snapshot());
+        releaseInFlight(reserved);
+        respond(id, std::move(res), false);
+        std::lock_guard<std::mutex> lock(mutex);
+        --pendingJobs;
+        progress.notify_all();
+    });
+}
+
+void Http2Session::respond(uint32_t id, HttpResponse res, bool resetAfter) {
+    Outgoing out{id, HttpResponse(), ByteBuffer()};
+    if (res.bodyFile) {
+        const std::string_view mapped = res.bodyFile->view();
+        out.body = ByteBuffer(res.bodyFile, mapped.data(), mapped.size());
+        res.bodyFile.reset();
+    } else if (!res.sharedBody.empty()) {
+        out.body = std::move(res.sharedBody);
+    } else {
+        out.body = ByteBuffer(std::move(res.body));
+    }
+    res.sharedBody = ByteBuffer();
+    res.body.clear();
+    out.head = std::move(res);
+    out.resetAfter = resetAfter;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (broken || sendWindows.count(id) == 0) return; // reset by the client meanwhile
+    ready.push_back(std::move(out));
+    writerWake.notify_one();
+}
+
+void Http2Session::resetStream(uint32_t id, uint32_t errorCode) {
+    std::string code;
+    appendU32(code, errorCode);
+    std::lock_guard<std::mutex> lock(mutex);
+    appendFrameHeader(control, code.size(), kRstStream, 0, id);
+    control += code;
+    sendWindows.erase(id);
+    ready.remove_if([id](const Outgoing& o) { return o.id == id; });
+    writerWake.notify_one();
+    progress.notify_all();
+}
+
+void Http2Session::releaseInFlight(size_t bytes) {
+    if (bytes > 0) inFlightBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void Http2Session::queueControl(uint8_t type, uint8_t flags, uint32_t id, const char* payload, size_t len) {
+    std::lock_guard<std::mutex> lock(mutex);
+    appendFrameHeader(control, len, type, flags, id);
+    control.append(payload, len);
+    writerWake.notify_one();
+}
+
+// Caller holds `mutex`.
+bool Http2Session::sendable() const {
+    for (const auto& out : ready) {
+        if (!out.headersSent) return true;
+        const auto it = sendWindows.find(out.id);
+        if (out.offset < out.body.size() && connectionSendWindow > 0 && it != sendWindows.end() && it->second > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Caller holds `mutex`. Encodes the response head as HEADERS (+ CONTINUATION) frames.
+void Http2Session::appendHeaders(Outgoing& out, std::string& wire) {
+    std::string block;
+    encoder.beginBlock(block);
+    encoder.add(":status", std::to_string(out.head.statusCode), block);
+    for (const auto field : out.head.headers) {
+        const std::string name = lowercase(field.first);
+        if (isConnectionSpecific(name) || name == "content-length") continue;
+        encoder.add(name, field.second, block);
+    }
+    std::string_view preset = out.head.presetHeaders;
+    while (!preset.empty()) {
+        const size_t eol = preset.find("\r\n");
+        const std::string_view line = preset.substr(0, eol);
+        preset = eol == std::string_view::npos ? std::string_view() : preset.substr(eol + 2);
+        const size_t colon = line.find(':');
+        if (colon == std::string_view::npos) continue;
+        std::string_view value = line.substr(colon + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+        encoder.add(lowercase(line.substr(0, colon)), value, block);
+    }
+    if (out.head.statusCode != 204 && out.head.statusCode != 304) {
+        encoder.add("content-length", std::to_string(out.body.size()), block);
+    }
+
+    const uint8_t endStream = out.body.empty() ? kEndStream : 0;
+    size_t pos = 0;
+    do {
+        const size_t n = std::min(block.size() - pos, peerMaxFrame);
+        const bool last = pos + n == block.size();
+        const uint8_t type = pos == 0 ? kHeaders : kContinuation;
+        const uint8_t flags = static_cast<uint8_t>((last ? kEndHeaders : 0) | (pos == 0 ? endStream : 0));
+        appendFrameHeader(wire, n, type, flags, out.id);
+        wire.append(block, pos, n);
+        pos += n;
+    } while (pos < block.size());
+}
+
+void Http2Session::writerLoop() {
+    std::string wire;
+    // Large DATA payloads, sent from the response buffers: (offset in `wire`, bytes).
+    std::vector<std::pair<size_t, ByteBuffer>> payloads;
+    std::vector<SocketIo::ConstSlice> slices;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        writerWake.wait(lock, [this]() { return broken || closing || !control.empty() || sendable(); });
+        if (broken) break;
+        if (control.empty() && !sendable()) break; // closing, nothing left to send
+
+        wire.swap(control);
+        control.clear();
+        payloads.clear();
+        // Round-robin: each ready stream gets one frame per pass, so a large response does
+        // not hold back the small ones queued behind it.
+        bool moved = true;
+        while (moved && wire.size() < kWriteBatchBytes) {
+            moved = false;
+            for (auto it = ready.begin(); it != ready.end() && wire.size() < kWriteBatchBytes;) {
+                Outgoing& out = *it;
+                bool done = false;
+                if (!out.headersSent) {
+                    appendHeaders(out, wire);
+                    out.headersSent = true;
+                    moved = true;
+                    done = out.body.empty();
+                } else {
+                    int64_t& window = sendWindows[out.id];
+                    const size_t n = std::min({out.body.size() - out.offset, peerMaxFrame,
+                                               static_cast<size_t>(std::max<int64_t>(connectionSendWindow, 0)),
+                                               static_cast<size_t>(std::max<int64_t>(window, 0))});
+                    if (n > 0) {
+                        done = out.offset + n == out.body.size();
+                        appendFrameHeader(wire, n, kData, done ? kEndStream : 0, out.id);
+                        if (n <= kInlineBytes) {
+                            wire.append(out.body.data() + out.offset, n);
+                        } else {
+                            payloads.emplace_back(wire.size(), out.body.slice(out.offset, n));
+                        }
+                        out.offset += n;
+                        connectionSendWindow -= static_cast<int64_t>(n);
+                        window -= static_cast<int64_t>(n);
+                        moved = true;
+                    }
+                }
+                if (done) {
+                    if (out.resetAfter) {
+                        appendFrameHeader(wire, 4, kRstStream, 0, out.id);
+                        appendU32(wire, kNoError);
+                    }
+                    sendWindows.erase(out.id);
+                    it = ready.erase(it);
+                    progress.notify_all();
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        lock.unlock();
+        slices.clear();
+        size_t from = 0;
+        for (const auto& payload : payloads) {
+            slices.push_back({wire.data() + from, payload.first - from});
+            slices.push_back({payload.second.data(), payload.second.size()});
+            from = payload.first;
+        }
+        slices.push_back({wire.data() + from, wire.size() - from});
+        const bool ok = SocketIo::sendv(sock, slices.data(), slices.size());
+        lock.lock();
+        if (!ok) {
+            broken = true;
+            ready.clear();
+            // Wakes the connection thread if it is blocked in recv().
+            (void)::shutdown(sock, SHUT_RDWR);
+            break;
+        }
+    }
+    progress.notify_all();
+}
@@ -0,0 +1,593 @@
+// http_load: drives POST /compress and /decompress on http_server (or an in-process
+// HttpServer) and reports request rate and latency percentiles.
+
+#include "Client.h"
+#include "CompressionApi.h"
+#include "HttpServer.h"
+#include "LatencyHistogram.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+    std::string host = "127.0.0.1";
+    int port = 8081;
+    size_t connections = 16;
+    double durationSeconds = 10;
+    double warmupSeconds = 1;
+    double rate = 0; // requests per second over all connections; 0 = closed loop
+    bool keepAlive = true;
+    bool unique = false;
+    std::string payload = "runs";
+    std::string mix = "compress:4K";
+    std::string format = "text";
+    bool inProcess = false;
+    size_t computeThreads = 0;
+    size_t cacheBytes = CompressionApi::kDefaultCacheBytes;
+};
+
+// One kind of request in the mix.
+struct MixEntry {
+    std::string path;  // "/compress" or "/decompress", with any query string
+    size_t size = 0;   // uncompressed payload bytes
+    unsigned weight = 1;
+    std::string head;  // request line and headers
+    std::vector<char> body;
+};
+
+struct Rng {
+    uint64_t state;
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+};
+
+// Deterministic payloads: "runs" (1..16-byte runs, RLE-friendly), "text" or "random".
+std::vector<char> makePayload(const std::string& kind, size_t size, uint64_t seed) {
+    static const char kText[] = "the quick brown fox jumps over the lazy dog while the server compresses bytes\n";
+    Rng rng{seed * 0x9E3779B97F4A7C15ULL + 1};
+    std::vector<char> out;
+    out.reserve(size);
+    if (kind == "random") {
+        while (out.size() < size) out.push_back(static_cast<char>(rng.next() >> 56));
+    } else if (kind == "text") {
+        size_t pos = rng.next() % (sizeof(kText) - 1);
+        while (out.size() < size) {
+            out.push_back(kText[pos]);
+            pos = (pos + 1) % (sizeof(kText) - 1);
+        }
+    } else if (kind == "runs") {
+        while (out.size() < size) {
+            const uint64_t r = rng.next();
+            out.insert(out.end(), std::min<size_t>(1 + (r & 15), size - out.size()), static_cast<char>('a' + (r >> 59)));
+        }
+    } else {
+        throw std::invalid_argument("unknown payload kind '" + kind + "'");
+    }
+    return out;
+}
+
+size_t parseSize(const std::string& s) {
+    size_t used = 0;
+    const unsigned long long n = std::stoull(s, &used);
+    size_t scale = 1;
+    if (used + 1 == s.size()) {
+        switch (s[used]) {
+        case 'K': case 'k': scale = size_t{1} << 10; break;
+        case 'M': case 'm': scale = size_t{1} << 20; break;
+        case 'G': case 'g': scale = size_t{1} << 30; break;
+        default: throw std::invalid_argument("bad size '" + s + "'");
+        }
+    } else if (used != s.size()) {
+        throw std::invalid_argument("bad size '" + s + "'");
+    }
+    return static_cast<size_t>(n) * scale;
+}
+
+// "compress:4K:8,decompress?x=y:64K:1" -> entries (weight defaults to 1).
+std::vector<MixEntry> parseMix(const std::string& spec) {
+    std::vector<MixEntry> mix;
+    std::stringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        std::vector<std::string> parts;
+        std::stringstream fields(item);
+        std::string field;
+        while (std::getline(fields, field, ':')) parts.push_back(field);
+        if (parts.size() < 2 || parts.size() > 3) {
+            throw std::invalid_argument("bad mix entry '" + item + "' (expected ENDPOINT:SIZE[:WEIGHT])");
+        }
+        const std::string endpoint = parts[0].substr(0, parts[0].find('?'));
+        if (endpoint != "compress" && endpoint != "decompress") {
+            throw std::invalid_argument("mix endpoint must be compress or decompress, got '" + endpoint + "'");
+        }
+        MixEntry entry;
+        entry.path = "/" + parts[0];
+        entry.size = parseSize(parts[1]);
+        if (parts.size() == 3) entry.weight = static_cast<unsigned>(std::stoul(parts[2]));
+        if (entry.weight == 0) continue;
+        mix.push_back(std::move(entry));
+    }
+    if (mix.empty()) throw std::invalid_argument("empty --mix");
+    return mix;
+}
+
+struct Response {
+    int status = 0;
+    bool close = false;
+    size_t bytes = 0; // head and body as received
+};
+
+// Reads HTTP/1.x responses off one connection. Bytes past the current response stay buffered
+// for the next one; bodies are counted and, unless the caller wants them, dropped as they arrive.
+class ResponseReader {
+public:
+    explicit ResponseReader(Client& client) : client(client), buf(64 * 1024) {}
+
+    void clear() { start = end = 0; }
+
+    bool read(Response& out, std::vector<char>* body) {
+        out = Response();
+        size_t headEnd = 0;
+        while ((headEnd = find("\r\n\r\n")) == std::string::npos) {
+            if (end - start > kMaxHead || !fill()) return false;
+        }
+        const std::string head(&buf[start], headEnd - start);
+        out.bytes = headEnd + 4 - start;
+        start = headEnd + 4;
+
+        if (head.compare(0, 5, "HTTP/") != 0 || head.size() < 12) return false;
+        out.status = std::atoi(head.c_str() + 9);
+        out.close = head.compare(5, 3, "1.0") == 0;
+        long long length = -1;
+        bool chunked = false;
+        std::stringstream lines(head);
+        std::string line;
+        std::getline(lines, line); // status line
+        while (std::getline(lines, line)) {
+            const size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            std::string name = line.substr(0, colon);
+            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+            std::string value = line.substr(colon + 1);
+            std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return std::tolower(c); });
+            if (name == "content-length") {
+                length = std::atoll(value.c_str());
+            } else if (name == "transfer-encoding") {
+                chunked = value.find("chunked") != std::string::npos;
+            } else if (name == "connection") {
+                if (value.find("close") != std::string::npos) out.close = true;
+                if (value.find("keep-alive") != std::string::npos) out.close = false;
+            }
+        }
+
+        if (out.status == 204 || out.status == 304 || (out.status >= 100 && out.status < 200)) return true;
+        if (chunked) {
+            while (true) {
+                size_t lineEnd;
+                while ((lineEnd = find("\r\n")) == std::string::npos) {
+                    if (!fill()) return false;
+                }
+                const size_t chunk = std::strtoull(std::string(&buf[start], lineEnd - start).c_str(), nullptr, 16);
+                out.bytes += lineEnd + 2 - start;
+                start = lineEnd + 2;
+                if (chunk == 0) break;
+                if (!consume(chunk, body) || !consume(2, nullptr)) return false;
+                out.bytes += chunk + 2;
+            }
+            // Trailer section: lines up to an empty one.
+            while (true) {
+                size_t lineEnd;
+                while ((lineEnd = find("\r\n")) == std::string::npos) {
+                    if (!fill()) return false;
+                }
+                const bool last = lineEnd == start;
+                out.bytes += lineEnd + 2 - start;
+                start = lineEnd + 2;
+                if (last) return true;
+            }
+        }
+        if (length >= 0) {
+            out.bytes += static_cast<size_t>(length);
+            return consume(static_cast<size_t>(length), body);
+        }
+        // No framing: the body runs to the end of the connection.
+        out.close = true;
+        while (true) {
+            out.bytes += end - start;
+            if (body) body->insert(body->end(), buf.begin() + start, buf.begin() + end);
+            clear();
+            if (!fill()) return true;
+        }
+    }
+
+private:
+    static constexpr size_t kMaxHead = 64 * 1024;
+
+    Client& client;
+    std::vector<char> buf;
+    size_t start = 0;
+    size_t end = 0;
+
+    size_t find(const char* token) const {
+        const size_t len = std::strlen(token);
+        const auto it = std::search(buf.begin() + start, buf.begin() + end, token, token + len);
+        return it == buf.begin() + end ? std::string::npos : static_cast<size_t>(it - buf.begin());
+    }
+
+    bool fill() {
+        if (start == end) {
+            clear();
+        } else if (end == buf.size()) {
+            if (start > 0) {
+                std::memmove(buf.data(), buf.data() + start, end - start);
+                end -= start;
+                start = 0;
+            } else {
+                buf.resize(buf.size() * 2);
+            }
+        }
+        const size_t n = client.receiveSome(buf.data() + end, buf.size() - end);
+        end += n;
+        return n > 0;
+    }
+
+    bool consume(size_t n, std::vector<char>* body) {
+        while (n > 0) {
+            if (start == end && !fill()) return false;
+            const size_t take = std::min(n, end - start);
+            if (body) body->insert(body->end(), buf.begin() + start, buf.begin() + start + take);
+            start += take;
+            n -= take;
+        }
+        return true;
+    }
+};
+
+std::string requestHead(const Config& cfg, const std::string& path, size_t bodySize, bool keepAlive) {
+    std::string head = "POST " + path + " HTTP/1.1\r\nHost: " + cfg.host + "\r\n" +
+                       "Content-Type: application/octet-stream\r\nContent-Length: " + std::to_string(bodySize) + "\r\n";
+    if (!keepAlive) head += "Connection: close\r\n";
+    return head + "\r\n";
+}
+
+// /decompress bodies are whatever the server's /compress (same query) returns for the payload.
+void prepareMix(const Config& cfg, std::vector<MixEntry>& mix) {
+    Client client(cfg.host, cfg.port);
+    ResponseReader reader(client);
+    for (size_t i = 0; i < mix.size(); ++i) {
+        MixEntry& entry = mix[i];
+        entry.body = makePayload(cfg.payload, entry.size, i + 1);
+        if (entry.path.compare(0, 11, "/decompress") == 0) {
+            const std::string compressPath = "/compress" + entry.path.substr(11);
+            const std::string head = requestHead(cfg, compressPath, entry.body.size(), true);
+            Response res;
+            std::vector<char> compressed;
+            if (!client.connect() ||
+                !client.sendBuffers({{head.data(), head.size()}, {entry.body.data(), entry.body.size()}}) ||
+                !reader.read(res, &compressed) || res.status != 200) {
+                throw std::runtime_error("could not prepare a /decompress body via " + compressPath + " (status " +
+                                         std::to_string(res.status) + ")");
+            }
+            if (res.close) {
+                client.disconnect();
+                reader.clear();
+            }
+            entry.body = std::move(compressed);
+        }
+        entry.head = requestHead(cfg, entry.path, entry.body.size(), cfg.keepAlive);
+    }
+}
+
+struct WorkerResult {
+    LatencyHistogram latency;
+    uint64_t requests = 0;
+    uint64_t failures = 0; // connect, send or receive errors
+    uint64_t connects = 0;
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+    std::map<int, uint64_t> statuses;
+};
+
+// One connection's request loop. Closed loop: the next request goes out when the previous
+// response is in. Open loop: requests are due on a fixed schedule and latency is measured
+// from when each was due, so a stalled server shows up as queueing delay instead of
+// silently lowering the offered rate (coordinated omission).
+void runConnection(const Config& cfg, const std::vector<MixEntry>& sharedMix, size_t index,
+                   Clock::time_point measureFrom, Clock::time_point end, WorkerResult& result) {
+    std::vector<MixEntry> ownMix;
+    if (cfg.unique) ownMix = sharedMix; // compress bodies are stamped per request below
+    const std::vector<MixEntry>& mix = cfg.unique ? ownMix : sharedMix;
+
+    unsigned totalWeight = 0;
+    for (const MixEntry& entry : mix) totalWeight += entry.weight;
+    Rng rng{index * 0xBF58476D1CE4E5B9ULL + 7};
+
+    Client client(cfg.host, cfg.port);
+    ResponseReader reader(client);
+    const auto interval = cfg.rate > 0 ? std::chrono::duration_cast<Clock::duration>(
+                                             std::chrono::duration<double>(cfg.connections / cfg.rate))
+                                       : Clock::duration::zero();
+    Clock::time_point due = Clock::now();
+    if (cfg.rate > 0) {
+        due += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(index / cfg.rate));
+    }
+    uint64_t sequence = index << 40;
+
+    while (true) {
+        Clock::time_point started;
+        if (cfg.rate > 0) {
+            if (due >= end) break;
+            std::this_thread::sleep_until(due);
+            started = due;
+            due += interval;
+        } else {
+            started = Clock::now();
+            if (started >= end) break;
+        }
+        const bool measured = started >= measureFrom;
+
+        unsigned pick = static_cast<unsigned>(rng.next() % totalWeight);
+        size_t which = 0;
+        while (pick >= mix[which].weight) pick -= mix[which++].weight;
+        const MixEntry& entry = mix[which];
+        if (cfg.unique && entry.path.compare(0, 9, "/compress") == 0 && entry.body.size() >= sizeof(sequence)) {
+            std::memcpy(ownMix[which].body.data(), &sequence, sizeof(sequence));
+            ++sequence;
+        }
+
+        if (!client.isConnected()) {
+            reader.clear();
+            if (!client.connect()) {
+                if (measured) ++result.failures;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                continue;
+            }
+            if (measured) ++result.connects;
+        }
+
+        Response res;
+        const bool ok = client.sendBuffers({{entry.head.data(), entry.head.size()}, {entry.body.data(), entry.body.size()}}) &&
+                        reader.read(res, nullptr);
+        if (measured) {
+            if (ok) {
+                result.latency.record(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started).count()));
+                ++result.requests;
+                ++result.statuses[res.status];
+                result.bytesSent += entry.head.size() + entry.body.size();
+                result.bytesReceived += res.bytes;
+            } else {
+                ++result.failures;
+            }
+        }
+        if (!ok || !cfg.keepAlive || res.close) client.disconnect();
+    }
+    client.disconnect();
+}
+
+double micros(uint64_t ns) {
+    return static_cast<double>(ns) / 1000.0;
+}
+
+void report(const Config& cfg, const WorkerResult& total, double seconds) {
+    const LatencyHistogram& h = total.latency;
+    uint64_t ok = 0;
+    for (const auto& status : total.statuses) {
+        if (status.first >= 200 && status.first < 300) ok += status.second;
+    }
+    const double rps = total.requests / seconds;
+    char buf[512];
+    if (cfg.format == "json") {
+        std::string statuses;
+        for (const auto& status : total.statuses) {
+            statuses += (statuses.empty() ? "" : ", ") + std::string("\"") + std::to_string(status.first) +
+                        "\": " + std::to_string(status.second);
+        }
+        std::snprintf(buf, sizeof(buf),
+                      "{\"mode\": \"%s\", \"connections\": %zu, \"target_rps\": %.1f, \"seconds\": %.3f, "
+                      "\"requests\": %llu, \"ok\": %llu, \"failures\": %llu, \"connects\": %llu, \"rps\": %.1f, "
+                      "\"sent_mb_s\": %.2f, \"received_mb_s\": %.2f, ",
+                      cfg.rate > 0 ? "open" : "closed", cfg.connections, cfg.rate, seconds,
+                      static_cast<unsigned long long>(total.requests), static_cast<unsigned long long>(ok),
+                      static_cast<unsigned long long>(total.failures), static_cast<unsigned long long>(total.connects),
+                      rps, total.bytesSent / seconds / 1e6, total.bytesReceived / seconds / 1e6);
+        std::cout << buf << "\"statuses\": {" << statuses << "}, ";
+        std::snprintf(buf, sizeof(buf),
+                      "\"latency_us\": {\"min\": %.1f, \"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, "
+                      "\"p99_9\": %.1f, \"max\": %.1f}}\n",
+                      micros(h.min()), h.mean() / 1000.0, micros(h.percentile(50)), micros(h.percentile(90)),
+                      micros(h.percentile(99)), micros(h.percentile(99.9)), micros(h.max()));
+        std::cout << buf;
+        return;
+    }
+    std::snprintf(buf, sizeof(buf),
+                  "mode %s, %zu connections%s, %.1f s measured\n"
+                  "requests %llu (%llu 2xx), failures %llu, connects %llu\n"
+                  "throughput %.1f req/s, sent %.2f MB/s, received %.2f MB/s\n",
+                  cfg.rate > 0 ? "open loop" : "closed loop", cfg.connections, cfg.keepAlive ? "" : " (no keep-alive)",
+                  seconds, static_cast<unsigned long long>(total.requests), static_cast<unsigned long long>(ok),
+                  static_cast<unsigned long long>(total.failures), static_cast<unsigned long long>(total.connects), rps,
+                  total.bytesSent / seconds / 1e6, total.bytesReceived / seconds / 1e6);
+    std::cout << buf;
+    if (cfg.rate > 0) {
+        std::snprintf(buf, sizeof(buf), "target %.1f req/s\n", cfg.rate);
+        std::cout << buf;
+    }
+    for (const auto& status : total.statuses) {
+        if (status.first < 200 || status.first >= 300) {
+            std::cout << "status " << status.first << ": " << status.second << "\n";
+        }
+    }
+    std::snprintf(buf, sizeof(buf),
+                  "latency (us)  min %.1f  mean %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+                  micros(h.min()), h.mean() / 1000.0, micros(h.percentile(50)), micros(h.percentile(90)),
+                  micros(h.percentile(99)), micros(h.percentile(99.9)), micros(h.max()));
+    std::cout << buf;
+}
+
+void printUsage() {
+    std::cerr << "Usage: http_load [options]\n"
+                 "Target:\n"
+                 "  --host HOST          server address, or unix:PATH (default 127.0.0.1)\n"
+                 "  --port N             server port (default 8081)\n"
+                 "  --in-process         start an HttpServer with the compression API on --port first\n"
+                 "  --compute-threads N  (in-process) codec worker threads (default: one per core)\n"
+                 "  --cache-bytes N      (in-process) result cache budget, 0 = off (default 67108864)\n"
+                 "Load:\n"
+                 "  --connections N      concurrent connections (default 16)\n"
+                 "  --duration SECS      measured time (default 10)\n"
+                 "  --warmup SECS        unmeasured time before that (default 1)\n"
+                 "  --rate RPS           open loop: offer RPS requests/s in total on a fixed schedule;\n"
+                 "                       latency counts from when a request was due (default: closed loop)\n"
+                 "  --no-keepalive       one request per connection\n"
+                 "Payloads:\n"
+                 "  --mix SPEC           weighted requests, ENDPOINT[?QUERY]:SIZE[:WEIGHT],... where ENDPOINT\n"
+                 "                       is compress or decompress and SIZE the uncompressed bytes (K/M/G);\n"
+                 "                       e.g. compress:4K:8,compress:1M:1,decompress:64K:2 (default compress:4K)\n"
+                 "  --payload KIND       runs, text or random (default runs)\n"
+                 "  --unique             stamp a sequence number into every /compress body so the server's\n"
+                 "                       result cache cannot answer it\n"
+                 "Output:\n"
+                 "  --format text|json   (default text)\n";
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    Config cfg;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(arg + " expects a value");
+            }
+            return argv[++i];
+        };
+        try {
+            if (arg == "--host") {
+                cfg.host = value();
+            } else if (arg == "--port") {
+                cfg.port = std::stoi(value());
+            } else if (arg == "--in-process") {
+                cfg.inProcess = true;
+            } else if (arg == "--compute-threads") {
+                cfg.computeThreads = parseSize(value());
+            } else if (arg == "--cache-bytes") {
+                cfg.cacheBytes = parseSize(value());
+            } else if (arg == "--connections") {
+                cfg.connections = parseSize(value());
+            } else if (arg == "--duration") {
+                cfg.durationSeconds = std::stod(value());
+            } else if (arg == "--warmup") {
+                cfg.warmupSeconds = std::stod(value());
+            } else if (arg == "--rate") {
+                cfg.rate = std::stod(value());
+            } else if (arg == "--no-keepalive") {
+                cfg.keepAlive = false;
+            } else if (arg == "--mix") {
+                cfg.mix = value();
+            } else if (arg == "--payload") {
+                cfg.payload = value();
+            } else if (arg == "--unique") {
+                cfg.unique = true;
+            } else if (arg == "--format") {
+                cfg.format = value();
+                if (cfg.format != "text" && cfg.format != "json") {
+                    throw std::invalid_argument("--format expects text or json");
+                }
+            } else if (arg == "-h" || arg == "--help") {
+                printUsage();
+                return 0;
+            } else {
+                throw std::invalid_argument("unknown argument '" + arg + "'");
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "http_load: " << e.what() << "\n";
+            printUsage();
+            return 2;
+        }
+    }
+
+    if (cfg.connections == 0) {
+        std::cerr << "http_load: --connections must be at least 1\n";
+        return 2;
+    }
+
+    // Hermetic runs: the same wiring as http_server, in this process.
+    std::unique_ptr<CompressionApi> api;
+    std::unique_ptr<HttpServer> server;
+    try {
+        if (cfg.inProcess) {
+            HttpServerOptions httpOptions;
+            httpOptions.computeThreads = cfg.computeThreads;
+            httpOptions.computePool =
+                std::make_shared<WorkerPool>(httpOptions.computeThreads, httpOptions.computeSmallJobBytes);
+            api.reset(new CompressionApi(cfg.cacheBytes));
+            api->setWorkerPool(httpOptions.computePool);
+            server.reset(new HttpServer(cfg.port, SocketOptions(), httpOptions));
+            CompressionApi& a = *api;
+            server->setHandler([&a](const HttpRequest& req) { return a.handle(req); });
+            server->setPreflightHandler(
+                [&a](const HttpRequest& req, HttpResponse& rejection) { return a.preflight(req, rejection); });
+            server->setStreamHandler([&a](const HttpRequest& req, HttpBodyReader& in, HttpResponseWriter& out) {
+                return a.handleStream(req, in, out);
+            });
+            server->start();
+        }
+        std::vector<MixEntry> mix = parseMix(cfg.mix);
+        prepareMix(cfg, mix);
+
+        const auto begin = Clock::now();
+        const auto measureFrom =
+            begin + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.warmupSeconds));
+        const auto end =
+            measureFrom + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.durationSeconds));
+
+        std::vector<WorkerResult> results(cfg.connections);
+        std::vector<std::thread> threads;
+        threads.reserve(cfg.connections);
+        for (size_t i = 0; i < cfg.connections; ++i) {
+            threads.emplace_back(runConnection, std::cref(cfg), std::cref(mix), i, measureFrom, end,
+                                 std::ref(results[i]));
+        }
+        for (std::thread& t : threads) t.join();
+        const double seconds = std::chrono::duration<double>(Clock::now() - measureFrom).count();
+
+        WorkerResult total;
+        for (const WorkerResult& r : results) {
+            total.latency.merge(r.latency);
+            total.requests += r.requests;
+            total.failures += r.failures;
+            total.connects += r.connects;
+            total.bytesSent += r.bytesSent;
+            total.bytesReceived += r.bytesReceived;
+            for (const auto& status : r.statuses) total.statuses[status.first] += status.second;
+        }
+        report(cfg, total, seconds);
+    } catch (const std::exception& e) {
+        std::cerr << "http_load: " << e.what() << "\n";
+        if (server) server->stop();
+        return 1;
+    }
+    if (server) server->stop();
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include "HttpParser.h"
+
+#include <algorithm>
+
+namespace {
+// RFC 9110 tchar: characters allowed in methods and field names.
+bool isTokenChar(unsigned char c) {
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) return true;
+    switch (c) {
+    case '!': case '#': case '$': case '%': case '&': case '\'': case '*': case '+':
+    case '-': case '.': case '^': case '_': case '`': case '|': case '~':
+        return true;
+    default:
+        return false;
+    }
+}
+} // namespace
+
+HttpRequestParser::Result HttpRequestParser::fail(const char* why) {
+    state = State::Failed;
+    errorText = why;
+    return Result::Error;
+}
+
+void HttpRequestParser::reset() {
+    base = nullptr;
+    position = 0;
+    state = State::Method;
+    count = 0;
+    tokenStart = 0;
+    valueEnd = 0;
+    errorText = "";
+}
+
+HttpRequestParser::Result HttpRequestParser::parse(const char* buf, size_t len) {
+    base = buf;
+    if (state == State::Done) return Result::Complete;
+    if (state == State::Failed) return Result::Error;
+    if (len > UINT32_MAX) return fail("request head too large");
+
+    for (; position < len; ++position) {
+        const unsigned char c = static_cast<unsigned char>(buf[position]);
+        switch (state) {
+        case State::Method:
+            if (c == ' ') {
+                if (position == tokenStart) return fail("malformed request line");
+                methodSpan = span(tokenStart, position);
+                tokenStart = position + 1;
+                state = State::Target;
+            } else if (!isTokenChar(c)) {
+                return fail("malformed request line");
+            }
+            break;
+        case State::Target:
+            if (c == ' ') {
+                if (position == tokenStart) return fail("malformed request line");
+                targetSpan = span(tokenStart, position);
+                tokenStart = position + 1;
+                state = State::Version;
+            } else if (c <= 0x20 || c == 0x7F) {
+                return fail("malformed request line");
+            }
+            break;
+        case State::Version:
+            if (c == '\r') {
+                versionSpan = span(tokenStart, position);
+                if (versionSpan.length == 0) return fail("malformed request line");
+                state = State::RequestLineLf;
+            } else if (c <= 0x20 || c == 0x7F) {
+                return fail("malformed request line");
+            }
+            break;
+        case State::RequestLineLf:
+        case State::FieldLf:
+            if (c != '\n') return fail("expected CRLF");
+            state = State::LineStart;
+            break;
+        case State::LineStart:
+            if (c == '\r') {
+                state = State::FinalLf;
+            } else if (isTokenChar(c)) {
+                if (count == kMaxHeaders) return fail("too many header fields");
+                tokenStart = position;
+                state = State::Name;
+            } else {
+                return fail("malformed header field");
+            }
+            break;
+        case State::Name:
+            if (c == ':') {
+                fields[count].name = span(tokenStart, position);
+                state = State::ValueStart;
+            } else if (!isTokenChar(c)) {
+                return fail("malformed header field");
+            }
+            break;
+        case State::ValueStart:
+            if (c == ' ' || c == '\t') break;
+            tokenStart = position;
+            valueEnd = position;
+            state = State::Value;
+            // fall through: this byte belongs to the value (or ends an empty one)
+            [[fallthrough]];
+        case State::Value:
+            if (c == '\r') {
+                fields[count].value = span(tokenStart, valueEnd);
+                ++count;
+                state = State::FieldLf;
+            } else if (c == ' ' || c == '\t') {
+                // optional trailing whitespace is not part of the value
+            } else if (c < 0x20 || c == 0x7F) {
+                return fail("malformed header value");
+            } else {
+                valueEnd = position + 1;
+            }
+            break;
+        case State::FinalLf:
+            if (c != '\n') return fail("expected CRLF");
+            ++position;
+            state = State::Done;
+            return Result::Complete;
+        case State::Done:
+        case State::Failed:
+            break;
+        }
+    }
+    return Result::Incomplete;
+}
+
+std::string_view HttpRequestParser::find(std::string_view name) const {
+    for (size_t i = 0; i < count; ++i) {
+        if (HttpHeaders::equalsIgnoreCase(view(fields[i].name), name)) {
+            return view(fields[i].value);
+        }
+    }
+    return std::string_view();
+}
+
+void HttpRequestParser::fill(HttpRequest& req) const {
+    req.method.assign(method().data(), method().size());
+    const std::string_view t = target();
+    const size_t question = t.find('?');
+    req.path.assign(t.data(), std::min(question, t.size()));
+    if (question != std::string_view::npos) {
+        req.query.assign(t.data() + question + 1, t.size() - question - 1);
+    } else {
+        req.query.clear();
+    }
+    req.version.assign(version().data(), version().size());
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        bytes += fields[i].name.length + fields[i].value.length;
+    }
+    req.headers.clear();
+    req.headers.reserve(count, bytes);
+    for (size_t i = 0; i < count; ++i) {
+        const auto f = header(i);
+        req.headers.add(f.first, f.second);
+    }
+}
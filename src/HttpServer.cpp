@@ -1,9 +1,20 @@
 #include "HttpServer.h"
+#include "Http2Session.h"
+#include "HttpParser.h"
+#include "Instrumentation.h"
+#include "Metrics.h"
+#include "RequestTrace.h"
+#include "SocketIo.h"
+#include "SpoolFile.h"
+#include "ZeroCopySender.h"
 
 #include <algorithm>
 #include <cerrno>
-#include <cctype>
+#include <charconv>
+#include <chrono>
 #include <climits>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <stdexcept>
 
@@ -14,254 +25,970 @@
 #include "platform/socket_init.h"
 
 namespace {
-std::string toLower(std::string s) {
-    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-    return s;
+/**
+ * A request the server refuses with a specific status; any other exception becomes a 400.
+ */
+class HttpStatusError : public std::runtime_error {
+public:
+    HttpStatusError(int status, const char* reason, const std::string& what)
+        : std::runtime_error(what), status(status), reason(reason) {}
+
+    int status;
+    const char* reason;
+};
+
+HttpStatusError timedOut(const char* what) {
+    return HttpStatusError(408, "Request Timeout", what);
 }
 
-// Reads until delimiter "\r\n\r\n" is found or limit is exceeded.
-std::string readHeaders(int sock, size_t maxBytes) {
-    std::string buf;
-    buf.reserve(2048);
-    while (buf.size() < maxBytes) {
-        char tmp[1024];
-        ssize_t n = ::recv(sock, tmp, sizeof(tmp), 0);
-        if (n == 0) break;
-        if (n < 0) {
-            if (errno == EINTR) continue;
-            throw std::runtime_error(std::string("recv() failed: ") + std::strerror(errno));
+// Turns a failed recv() into the matching exception (408 if SO_RCVTIMEO expired).
+[[noreturn]] void throwRecvError(const char* timeoutWhat) {
+    if (SocketIo::lastErrorWasTimeout()) throw timedOut(timeoutWhat);
+    throw std::runtime_error(std::string("recv() failed: ") + std::strerror(errno));
+}
+
+// Feeds `buf` (which may already hold pipelined bytes) to `parser`, receiving more straight
+// into `buf` until a complete request head has arrived. Each byte is parsed exactly once.
+// The whole head must arrive within `timeoutMs` (0 = no limit), which stops clients that
+// trickle headers a byte at a time. Returns false if the peer closed (or never sent
+// anything before the deadline) between requests. Time spent in the parser, and only that
+// (not waiting for bytes), is added to `parseTime`.
+bool readHead(int sock, std::string& buf, HttpRequestParser& parser, size_t maxBytes, int timeoutMs,
+              Metrics::Clock::duration& parseTime) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (true) {
+        const auto parseStart = Metrics::Clock::now();
+        const HttpRequestParser::Result result = parser.parse(buf.data(), buf.size());
+        const auto parsed = Metrics::Clock::now() - parseStart;
+        parseTime += parsed;
+        RequestTrace::record(RequestTrace::Phase::Parse, parsed);
+        if (result == HttpRequestParser::Result::Complete) return true;
+        if (result == HttpRequestParser::Result::Error) throw std::runtime_error(parser.error());
+        if (buf.size() >= maxBytes) {
+            throw HttpStatusError(431, "Request Header Fields Too Large", "request headers too large");
         }
-        buf.append(tmp, tmp + n);
-        if (buf.find("\r\n\r\n") != std::string::npos) {
-            return buf;
+
+        const size_t used = buf.size();
+        RequestTrace::Timer recvTimer(RequestTrace::Phase::Recv);
+        if (timeoutMs > 0) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0 || !SocketIo::waitReadable(sock, static_cast<int>(left.count()))) {
+                if (used == 0) return false;
+                throw timedOut("request headers not received in time");
+            }
+        }
+        buf.resize(used + 4096);
+        ssize_t n;
+        do {
+            n = ::recv(sock, &buf[used], 4096, 0);
+        } while (n < 0 && errno == EINTR);
+        buf.resize(used + static_cast<size_t>(n > 0 ? n : 0));
+        if (n == 0) {
+            if (used == 0) return false; // clean close between requests
+            throw std::runtime_error("request headers incomplete");
+        }
+        if (n < 0) {
+            throwRecvError("request headers not received in time");
         }
     }
-    throw std::runtime_error("request headers too large or incomplete");
 }
 
-HttpRequest parseRequest(const std::string& raw, std::vector<char>& leftoverBody) {
-    HttpRequest req;
-    const size_t headerEnd = raw.find("\r\n\r\n");
-    if (headerEnd == std::string::npos) {
-        throw std::runtime_error("malformed HTTP request");
-    }
-
-    std::string headerPart = raw.substr(0, headerEnd);
-    std::string after = raw.substr(headerEnd + 4);
-    leftoverBody.assign(after.begin(), after.end());
-
-    // Parse request line
-    const size_t firstLineEnd = headerPart.find("\r\n");
-    const std::string requestLine = (firstLineEnd == std::string::npos) ? headerPart : headerPart.substr(0, firstLineEnd);
-    {
-        // "METHOD PATH VERSION"
-        size_t a = requestLine.find(' ');
-        size_t b = (a == std::string::npos) ? std::string::npos : requestLine.find(' ', a + 1);
-        if (a == std::string::npos || b == std::string::npos) {
-            throw std::runtime_error("malformed request line");
-        }
-        req.method = requestLine.substr(0, a);
-        req.path = requestLine.substr(a + 1, b - (a + 1));
-        req.version = requestLine.substr(b + 1);
-    }
-
-    // Parse headers
-    size_t pos = (firstLineEnd == std::string::npos) ? headerPart.size() : (firstLineEnd + 2);
-    while (pos < headerPart.size()) {
-        size_t lineEnd = headerPart.find("\r\n", pos);
-        if (lineEnd == std::string::npos) lineEnd = headerPart.size();
-        std::string line = headerPart.substr(pos, lineEnd - pos);
-        pos = lineEnd + 2;
-
-        if (line.empty()) continue;
-        size_t colon = line.find(':');
-        if (colon == std::string::npos) continue;
-        std::string key = toLower(line.substr(0, colon));
-        std::string value = line.substr(colon + 1);
-        // trim leading spaces
-        while (!value.empty() && (value[0] == ' ' || value[0] == '\t')) value.erase(value.begin());
-        req.headers[key] = value;
-    }
-
-    return req;
+// Complete response for requests refused before (or instead of) reaching a handler.
+std::string errorResponse(int status, const char* reason, const std::string& message, int retryAfterSeconds) {
+    const std::string body = std::string(reason) + ": " + message + "\n";
+    std::string resp = "HTTP/1.1 " + std::to_string(status) + " " + reason + "\r\n";
+    resp += "Content-Type: text/plain; charset=utf-8\r\n";
+    if (status == 503 && retryAfterSeconds > 0) {
+        resp += "Retry-After: " + std::to_string(retryAfterSeconds) + "\r\n";
+    }
+    resp += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    resp += "Connection: close\r\n\r\n";
+    return resp + body;
+}
+
+// Before closing a connection whose request was not fully read, stop sending and swallow
+// what the client still sends for a moment: closing with unread data makes the kernel send
+// a RST, which can destroy the error response before the client has read it.
+void discardInputBeforeClose(int sock) {
+    (void)::shutdown(sock, SHUT_WR);
+    constexpr size_t kMaxDiscard = 256 * 1024;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    char sink[4096];
+    size_t discarded = 0;
+    while (discarded < kMaxDiscard) {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0 || !SocketIo::waitReadable(sock, static_cast<int>(left.count()))) return;
+        const ssize_t n = ::recv(sock, sink, sizeof(sink), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        discarded += static_cast<size_t>(n);
+    }
 }
 
 size_t parseContentLength(const HttpRequest& req) {
-    auto it = req.headers.find("content-length");
-    if (it == req.headers.end()) return 0;
-    try {
-        return static_cast<size_t>(std::stoul(it->second));
-    } catch (...) {
-        throw std::runtime_error("invalid Content-Length");
+    const std::string_view value = req.headers.get("content-length");
+    if (value.empty()) return 0;
+    size_t n = 0;
+    for (char c : value) {
+        if (c < '0' || c > '9' || n > (SIZE_MAX - 9) / 10) {
+            throw std::runtime_error("invalid Content-Length");
+        }
+        n = n * 10 + static_cast<size_t>(c - '0');
     }
+    return n;
 }
 
 void sendAll(int sock, const char* data, size_t len) {
-    size_t off = 0;
-    while (off < len) {
-        const size_t chunk = std::min(len - off, static_cast<size_t>(INT_MAX));
-        const int chunkInt = static_cast<int>(chunk);
-        ssize_t n = ::send(sock, data + off, chunkInt, 0);
-        if (n < 0 && errno == EINTR) continue;
-        if (n <= 0) throw std::runtime_error("send() failed");
-        off += static_cast<size_t>(n);
+    if (!SocketIo::sendAll(sock, data, len)) {
+        throw std::runtime_error("send() failed");
     }
 }
-} // namespace
 
-HttpServer::HttpServer(int port)
-    : port(port), serverSocket(-1), running(false) {}
+// HTTP/1.1 defaults to persistent connections; HTTP/1.0 must ask for them.
+bool clientWantsKeepAlive(const HttpRequest& req) {
+    const std::string_view conn = req.headers.get("connection");
+    if (HttpHeaders::equalsIgnoreCase(conn, "close")) return false;
+    if (HttpHeaders::equalsIgnoreCase(conn, "keep-alive")) return true;
+    return req.version == "HTTP/1.1";
+}
 
-HttpServer::~HttpServer() {
-    stop();
+bool isChunked(const HttpRequest& req) {
+    // "chunked" must be the final coding; we support no other codings underneath it.
+    const std::string_view value = req.headers.get("transfer-encoding");
+    return value.size() >= 7 && HttpHeaders::equalsIgnoreCase(value.substr(value.size() - 7), "chunked");
 }
 
-void HttpServer::setHandler(Handler h) {
-    handler = std::move(h);
+constexpr char kSwitchingToH2c[] = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+
+// `Upgrade: h2c` with HTTP2-Settings (RFC 7540 3.2). Clients list other protocols too, and
+// the server may ignore the header, so anything else just gets an HTTP/1.1 answer.
+bool wantsH2cUpgrade(const HttpRequest& req) {
+    if (req.version != "HTTP/1.1" || !req.headers.has("http2-settings")) return false;
+    std::string_view upgrade = req.headers.get("upgrade");
+    while (!upgrade.empty()) {
+        const size_t comma = upgrade.find(',');
+        std::string_view token = upgrade.substr(0, comma);
+        upgrade = comma == std::string_view::npos ? std::string_view() : upgrade.substr(comma + 1);
+        while (!token.empty() && (token.front() == ' ' || token.front() == '\t')) token.remove_prefix(1);
+        while (!token.empty() && (token.back() == ' ' || token.back() == '\t')) token.remove_suffix(1);
+        if (HttpHeaders::equalsIgnoreCase(token, "h2c")) return true;
+    }
+    return false;
 }
 
-void HttpServer::start() {
-    if (running) return;
+bool isFramingHeader(std::string_view name) {
+    return HttpHeaders::equalsIgnoreCase(name, "Connection") ||
+           HttpHeaders::equalsIgnoreCase(name, "Content-Length") ||
+           HttpHeaders::equalsIgnoreCase(name, "Transfer-Encoding");
+}
 
-    ensure_socket_init();
+void appendNumber(std::string& out, unsigned long long value) {
+    char digits[24];
+    const auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    out.append(digits, end);
+}
 
-    serverSocket = ::socket(AF_INET, SOCK_STREAM, 0);
-    if (serverSocket < 0) {
-        throw std::runtime_error(std::string("HttpServer::start: socket() failed: ") + std::strerror(errno));
+// Serializes the status line and headers into `out`, replacing its contents but keeping its
+// capacity, so a connection reuses one buffer for all its responses. Framing headers set by
+// the handler are dropped and regenerated; `Connection: close` from the handler is honoured.
+// `bodyLength` < 0 means the body is chunked (or close-delimited when `chunked` is false).
+void writeHead(std::string& out, const HttpResponse& res, bool& keepAlive, long long bodyLength, bool chunked) {
+    if (HttpHeaders::equalsIgnoreCase(res.headers.get("Connection"), "close")) keepAlive = false;
+    if (bodyLength < 0 && !chunked) keepAlive = false; // body ends at connection close
+
+    out.clear();
+    out += "HTTP/1.1 ";
+    appendNumber(out, static_cast<unsigned>(res.statusCode));
+    out += ' ';
+    out += res.statusText;
+    out += "\r\n";
+    for (const auto kv : res.headers) {
+        if (isFramingHeader(kv.first)) continue;
+        out.append(kv.first.data(), kv.first.size());
+        out += ": ";
+        out.append(kv.second.data(), kv.second.size());
+        out += "\r\n";
+    }
+    out.append(res.presetHeaders.data(), res.presetHeaders.size());
+    if (res.statusCode == 204 || res.statusCode == 304) {
+        // No body by definition; a Content-Length here would describe the 200 representation.
+    } else if (bodyLength >= 0) {
+        // Ensure Content-Length is correct for binary payloads.
+        out += "Content-Length: ";
+        appendNumber(out, static_cast<unsigned long long>(bodyLength));
+        out += "\r\n";
+    } else if (chunked) {
+        out += "Transfer-Encoding: chunked\r\n";
+    }
+    if (keepAlive) {
+        out += "Connection: keep-alive\r\n\r\n";
+    } else {
+        out += "Connection: close\r\n\r\n";
     }
+}
 
-    int opt = 1;
-#ifdef _WIN32
-    const char* optPtr = reinterpret_cast<const char*>(&opt);
-    const int optLen = static_cast<int>(sizeof(opt));
-#else
-    const void* optPtr = &opt;
-    const socklen_t optLen = static_cast<socklen_t>(sizeof(opt));
-#endif
-    (void)::setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, optPtr, optLen);
+// Head and body leave in one sendmsg(), so small responses fit one segment and never wait
+// on Nagle between the two.
+void sendResponse(int sock, const std::string& head, const char* body, size_t len) {
+    const SocketIo::ConstSlice slices[] = {{head.data(), head.size()}, {body, len}};
+    if (!SocketIo::sendv(sock, slices, len > 0 ? 2 : 1)) {
+        throw std::runtime_error("send() failed");
+    }
+}
 
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(static_cast<uint16_t>(port));
+/**
+ * Share of HttpServer::bufferedBodyBytes held by one request; returned on destruction.
+ */
+class BodyBudget {
+public:
+    BodyBudget(std::atomic<size_t>& total, size_t limit) : total(total), limit(limit) {}
+    ~BodyBudget() { release(); }
+
+    bool reserve(size_t bytes) {
+        size_t current = total.load(std::memory_order_relaxed);
+        do {
+            if (bytes > limit || current > limit - bytes) return false;
+        } while (!total.compare_exchange_weak(current, current + bytes, std::memory_order_relaxed));
+        held += bytes;
+        return true;
+    }
 
-    if (::bind(serverSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
-        ::close(serverSocket);
-        serverSocket = -1;
-        throw std::runtime_error(std::string("HttpServer::start: bind() failed: ") + std::strerror(errno));
+    void release() {
+        total.fetch_sub(held, std::memory_order_relaxed);
+        held = 0;
     }
 
-    if (::listen(serverSocket, 16) < 0) {
-        ::close(serverSocket);
-        serverSocket = -1;
-        throw std::runtime_error(std::string("HttpServer::start: listen() failed: ") + std::strerror(errno));
+private:
+    std::atomic<size_t>& total;
+    size_t limit;
+    size_t held = 0;
+};
+
+/**
+ * Request body reader over the connection buffer + socket. Handles Content-Length and
+ * chunked framing; bytes past the end of the body stay in `buffer` for the next request.
+ */
+class SocketBodyReader : public HttpBodyReader {
+public:
+    // `maxBytes` only matters for chunked bodies; Content-Length ones are checked up front.
+    SocketBodyReader(int sock, std::string& buffer, bool chunked, size_t contentLength, size_t maxBytes)
+        : sock(sock), buffer(buffer), chunked(chunked), remaining(chunked ? 0 : contentLength),
+          done(!chunked && contentLength == 0), maxBytes(maxBytes) {}
+
+    /**
+     * From now on, reserve each announced chunk in `budget` (for bodies being buffered).
+     */
+    void reserveChunksIn(BodyBudget& budget) { inFlight = &budget; }
+
+    /**
+     * The client asked for `Expect: 100-continue`: send the interim 100 response right
+     * before the body is first needed, and only then.
+     */
+    void expectContinue() { continuePending = true; }
+
+    size_t read(char* dst, size_t max) override {
+        touched = true;
+        if (done || max == 0) return 0;
+        sendContinue();
+        if (chunked && remaining == 0) {
+            nextChunk();
+            if (done) return 0;
+        }
+
+        size_t n = std::min(max, remaining);
+        if (!buffer.empty()) {
+            n = std::min(n, buffer.size());
+            std::memcpy(dst, buffer.data(), n);
+            Instrumentation::recordCopy(n);
+            buffer.erase(0, n);
+        } else {
+            // Nothing buffered: receive straight into the caller's memory.
+            const int want = static_cast<int>(std::min<size_t>(n, static_cast<size_t>(INT_MAX)));
+            ssize_t got = ::recv(sock, dst, want, 0);
+            while (got < 0 && errno == EINTR) got = ::recv(sock, dst, want, 0);
+            if (got == 0) throw std::runtime_error("incomplete body");
+            if (got < 0) throwRecvError("request body stalled");
+            n = static_cast<size_t>(got);
+        }
+        remaining -= n;
+        if (!chunked && remaining == 0) done = true;
+        return n;
     }
 
+    /**
+     * Moves the rest of the body into `file`. Content-Length bodies are spliced from the
+     * socket (SocketIo::relay) and never pass through user space.
+     */
+    void drainTo(SpoolFile& file) {
+        touched = true;
+        if (done) return;
+        sendContinue();
+        if (!chunked) {
+            const size_t fromBuffer = std::min(remaining, buffer.size());
+            file.write(buffer.data(), fromBuffer);
+            buffer.erase(0, fromBuffer);
+            remaining -= fromBuffer;
+            while (remaining > 0) {
+                size_t n;
+                try {
+                    n = file.appendFrom(sock, remaining);
+                } catch (const std::runtime_error&) {
+                    if (SocketIo::lastErrorWasTimeout()) throw timedOut("request body stalled");
+                    throw;
+                }
+                if (n == 0) throw std::runtime_error("incomplete body");
+                remaining -= n;
+            }
+            done = true;
+            return;
+        }
+        std::vector<char> chunk(64 * 1024);
+        size_t n;
+        while ((n = read(chunk.data(), chunk.size())) > 0) {
+            file.write(chunk.data(), n);
+        }
+    }
+
+    bool complete() const { return done; }
+    bool started() const { return touched; }
+
+private:
+    int sock;
+    std::string& buffer;
+    bool chunked;
+    size_t remaining;      // bytes left in the body (Content-Length) or current chunk
+    bool done;
+    bool touched = false;
+    bool inChunk = false;  // a chunk's data was consumed and its CRLF is still pending
+    size_t maxBytes;
+    BodyBudget* inFlight = nullptr;
+    size_t total = 0;      // chunk data announced so far
+    bool continuePending = false;
+
+    void sendContinue() {
+        if (!continuePending) return;
+        continuePending = false;
+        // A client that did not wait for us may already have sent (part of) the body.
+        if (buffer.empty()) sendAll(sock, "HTTP/1.1 100 Continue\r\n\r\n", 25);
+    }
+
+    void fill() {
+        char tmp[4096];
+        while (true) {
+            ssize_t n = ::recv(sock, tmp, sizeof(tmp), 0);
+            if (n > 0) {
+                buffer.append(tmp, tmp + n);
+                Instrumentation::recordCopy(static_cast<size_t>(n));
+                return;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) throwRecvError("request body stalled");
+            throw std::runtime_error("incomplete chunked body");
+        }
+    }
+
+    std::string readLine() {
+        size_t eol;
+        while ((eol = buffer.find("\r\n")) == std::string::npos) {
+            if (buffer.size() > 4096) throw std::runtime_error("chunk header too long");
+            fill();
+        }
+        std::string line = buffer.substr(0, eol);
+        buffer.erase(0, eol + 2);
+        return line;
+    }
+
+    void nextChunk() {
+        if (inChunk && !readLine().empty()) {
+            throw std::runtime_error("malformed chunk terminator");
+        }
+        const std::string line = readLine();
+        size_t size = 0;
+        size_t digits = 0;
+        for (char c : line) {
+            int v;
+            if (c >= '0' && c <= '9') v = c - '0';
+            else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+            else break; // chunk extensions (";...") and trailing whitespace are ignored
+            if (++digits > 15) throw std::runtime_error("chunk size too large");
+            size = size * 16 + static_cast<size_t>(v);
+        }
+        if (digits == 0) throw std::runtime_error("malformed chunk size");
+        if (size == 0) {
+            // Last chunk: skip trailer fields up to the terminating empty line.
+            while (!readLine().empty()) {
+            }
+            done = true;
+            return;
+        }
+        // Limits apply as each chunk is announced, before its data is read.
+        if (maxBytes > 0 && size > maxBytes - std::min(total, maxBytes)) {
+            throw HttpStatusError(413, "Payload Too Large", "request body too large");
+        }
+        if (inFlight && !inFlight->reserve(size)) {
+            throw HttpStatusError(503, "Service Unavailable", "server is busy");
+        }
+        total += size;
+        remaining = size;
+        inChunk = true;
+    }
+};
+
+/**
+ * Response writer for stream handlers: buffers up to kStreamBufferBytes, then switches to
+ * chunked encoding (or a close-delimited body for HTTP/1.0 clients). With a zeroCopyThreshold
+ * (see HttpServerOptions), output is gathered into chunks of at least that size, which are
+ * handed to the connection's ZeroCopySender instead of being copied into the socket.
+ */
+class StreamingResponseWriter : public HttpResponseWriter {
+public:
+    static constexpr size_t kStreamBufferBytes = 64 * 1024;
+
+    StreamingResponseWriter(int sock, std::string& headBuffer, bool chunkedAllowed, bool keepAlive,
+                            size_t zeroCopyThreshold, std::unique_ptr<ZeroCopySender>& zeroCopy)
+        : sock(sock), headBuffer(headBuffer), chunkedAllowed(chunkedAllowed), keepAlive(keepAlive),
+          zeroCopyThreshold(zeroCopyThreshold), zeroCopy(zeroCopy) {}
+
+    void start(const HttpResponse& h) override {
+        head = h;
+        head.body.clear();
+        head.sharedBody = ByteBuffer();
+        started = true;
+    }
+
+    void write(const char* data, size_t len) override {
+        if (!started) throw std::logic_error("HttpResponseWriter::write before start");
+        if (len == 0) return;
+        written += len;
+        if (headersSent && !zeroCopyOn()) {
+            if (!buffered.empty()) flush(nullptr); // gathered before the sender switched itself off
+            sendBody(data, len);
+            return;
+        }
+        const size_t flushAt = zeroCopyOn() ? std::max(kStreamBufferBytes, zeroCopyThreshold) : kStreamBufferBytes;
+        if (buffered.empty()) buffered.reserve(flushAt);
+        buffered.insert(buffered.end(), data, data + len);
+        Instrumentation::recordCopy(len);
+        if (buffered.size() >= flushAt) {
+            const bool withHead = !headersSent;
+            if (withHead) writeHead(headBuffer, head, keepAlive, -1, chunkedAllowed);
+            headersSent = true;
+            flush(withHead ? &headBuffer : nullptr);
+        }
+    }
+
+    void finish() override {
+        if (!started) throw std::logic_error("HttpResponseWriter::finish before start");
+        if (finished) return;
+        if (!headersSent) {
+            writeHead(headBuffer, head, keepAlive, static_cast<long long>(buffered.size()), chunkedAllowed);
+            headersSent = true;
+            if (zeroCopyOn() && buffered.size() >= zeroCopyThreshold) {
+                sendZeroCopy(headBuffer);
+            } else {
+                sendResponse(sock, headBuffer, buffered.data(), buffered.size());
+            }
+        } else {
+            if (!buffered.empty()) flush(nullptr);
+            if (chunkedAllowed) {
+                // Closes the last zero-copy chunk, whose CRLF is still owed.
+                if (chunkOpen) sendAll(sock, "\r\n0\r\n\r\n", 7);
+                else sendAll(sock, "0\r\n\r\n", 5);
+            }
+        }
+        finished = true;
+    }
+
+    bool isFinished() const { return finished; }
+    bool headersWereSent() const { return headersSent; }
+    bool connectionReusable() const { return keepAlive; }
+    int statusCode() const { return head.statusCode; }
+    size_t bodyBytesWritten() const { return written; }
+
+private:
+    int sock;
+    std::string& headBuffer;
+    bool chunkedAllowed;
+    bool keepAlive;
+    size_t zeroCopyThreshold;
+    std::unique_ptr<ZeroCopySender>& zeroCopy;
+    HttpResponse head;
+    std::vector<char> buffered;
+    bool started = false;
+    bool headersSent = false;
+    bool finished = false;
+    bool chunkOpen = false; // a zero-copy chunk went out without its trailing CRLF
+    size_t written = 0;
+
+    // As for buffered responses: until the kernel turns out to copy anyway (see ZeroCopySender).
+    bool zeroCopyOn() const { return zeroCopyThreshold > 0 && (zeroCopy == nullptr || zeroCopy->enabled()); }
+
+    // Chunk size line for `len` bytes, preceded by the CRLF an open chunk still owes.
+    std::string sizeLine(size_t len) {
+        char line[24];
+        const int n = std::snprintf(line, sizeof(line), "%s%zx\r\n", chunkOpen ? "\r\n" : "", len);
+        chunkOpen = false;
+        return std::string(line, static_cast<size_t>(n));
+    }
+
+    // Sends `buffered` as one chunk (raw when close-delimited), preceded by `headBytes` if given.
+    void flush(const std::string* headBytes) {
+        if (zeroCopyOn() && buffered.size() >= zeroCopyThreshold) {
+            std::string prefix = headBytes ? *headBytes : std::string();
+            if (chunkedAllowed) prefix += sizeLine(buffered.size());
+            sendZeroCopy(prefix);
+            chunkOpen = chunkedAllowed; // the CRLF goes out with the next chunk or the last one
+            return;
+        }
+        sendBody(buffered.data(), buffered.size(), headBytes);
+        buffered.clear();
+    }
+
+    // `prefix` then `buffered`, whose bytes the sender keeps until the kernel is done with them.
+    void sendZeroCopy(const std::string& prefix) {
+        if (!zeroCopy) {
+            zeroCopy = std::make_unique<ZeroCopySender>(sock);
+        }
+        const ByteBuffer body(std::move(buffered));
+        buffered.clear();
+        if (!zeroCopy->send(prefix, body)) throw std::runtime_error("send() failed");
+    }
+
+    // Sends `data` as one chunk (or raw when close-delimited), preceded by `head` if given.
+    void sendBody(const char* data, size_t len, const std::string* headBytes = nullptr) {
+        if (!chunkedAllowed) {
+            if (headBytes) {
+                sendResponse(sock, *headBytes, data, len);
+            } else {
+                sendAll(sock, data, len);
+            }
+            return;
+        }
+        const std::string line = sizeLine(len);
+        const SocketIo::ConstSlice slices[] = {{headBytes ? headBytes->data() : "", headBytes ? headBytes->size() : 0},
+                                               {line.data(), line.size()},
+                                               {data, len},
+                                               {"\r\n", 2}};
+        if (!SocketIo::sendv(sock, slices, 4)) throw std::runtime_error("send() failed");
+    }
+};
+} // namespace
+
+const HttpRouteLimits* HttpServerOptions::limitsFor(const std::string& path) const {
+    for (const auto& route : routeLimits) {
+        const bool prefix = !route.path.empty() && route.path.back() == '/';
+        if (path == route.path || (prefix && path.compare(0, route.path.size(), route.path) == 0)) {
+            return &route;
+        }
+    }
+    return nullptr;
+}
+
+HttpServer::HttpServer(int port, const SocketOptions& options, const HttpServerOptions& httpOptions)
+    : port(port), options(options), httpOptions(httpOptions), running(false) {}
+
+HttpServer::~HttpServer() {
+    stop();
+}
+
+void HttpServer::setHandler(Handler h) {
+    handler = std::move(h);
+}
+
+void HttpServer::setStreamHandler(StreamHandler h) {
+    streamHandler = std::move(h);
+}
+
+void HttpServer::setPreflightHandler(PreflightHandler h) {
+    preflightHandler = std::move(h);
+}
+
+void HttpServer::start() {
+    if (running) return;
+
+    listeners = SocketSetup::openListeners(port, options, "HttpServer::start");
+    compute = httpOptions.computePool;
+    if (!compute) {
+        compute = std::make_shared<WorkerPool>(httpOptions.computeThreads, httpOptions.computeSmallJobBytes);
+    }
+    Metrics::addThreads(Metrics::Pool::Compute, static_cast<long>(compute->size()));
+
     running = true;
     serverThread = std::thread(&HttpServer::acceptLoop, this);
+    Metrics::addThreads(Metrics::Pool::Io, 1);
 }
 
 void HttpServer::stop() {
     if (!running) return;
     running = false;
 
-    if (serverSocket >= 0) {
-        (void)::shutdown(serverSocket, SHUT_RDWR);
-        ::close(serverSocket);
-        serverSocket = -1;
-    }
     if (serverThread.joinable()) {
         serverThread.join();
+        Metrics::addThreads(Metrics::Pool::Io, -1);
     }
+    SocketSetup::closeListeners(listeners, options);
+
+    // Wake connection threads blocked in recv() (e.g. idle keep-alive) and wait for them,
+    // since they still use this object.
+    std::unique_lock<std::mutex> lock(connectionsMutex);
+    for (int sock : connections) {
+        (void)::shutdown(sock, SHUT_RDWR);
+    }
+    connectionsDrained.wait(lock, [this]() { return connections.empty(); });
+    lock.unlock();
+    Metrics::addThreads(Metrics::Pool::Compute, -static_cast<long>(compute->size()));
+    compute.reset(); // no connection is left to submit work (a shared pool lives on)
 }
 
 void HttpServer::acceptLoop() {
     while (running) {
-        int clientSock = ::accept(serverSocket, nullptr, nullptr);
+        int clientSock = SocketSetup::acceptAny(listeners, options);
         if (clientSock < 0) {
             if (!running) break;
             if (errno == EINTR) continue;
             continue;
         }
 
-        auto handlerCopy = handler;
-        std::thread([this, clientSock, handlerCopy]() mutable {
-            // We keep parsing + response generation here; handler is pure function.
-            (void)handlerCopy; // silence unused warning in some builds if handler is empty
+        bool full;
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            full = httpOptions.maxConnections > 0 && connections.size() >= httpOptions.maxConnections;
+            if (!full) connections.insert(clientSock);
+        }
+        if (full) {
+            // Answer instead of leaving the client hanging in the backlog. The refusal runs
+            // on a short-lived thread, bounded by a send timeout and the discard window, so
+            // a client that does not read cannot stall the accept loop.
+            Metrics::recordRequest(Metrics::Endpoint::Other, 503, 0, 0);
+            std::string resp =
+                errorResponse(503, "Service Unavailable", "too many connections", httpOptions.retryAfterSeconds);
+            std::thread([clientSock, resp = std::move(resp)]() {
+                (void)SocketIo::setTimeouts(clientSock, 0, 1000);
+                if (SocketIo::sendAll(clientSock, resp.data(), resp.size())) {
+                    discardInputBeforeClose(clientSock);
+                }
+                ::close(clientSock);
+            }).detach();
+            continue;
+        }
+        std::thread([this, clientSock]() {
+            Metrics::connectionOpened();
+            Metrics::addThreads(Metrics::Pool::Io, 1);
             handleClient(clientSock);
+            Metrics::addThreads(Metrics::Pool::Io, -1);
+            Metrics::connectionClosed();
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            connections.erase(clientSock);
+            ::close(clientSock);
+            connectionsDrained.notify_all();
         }).detach();
     }
 }
 
 void HttpServer::handleClient(int clientSock) {
+    // Bytes received but not yet consumed; may hold the start of pipelined requests.
+    std::string buffer;
+    // Serialized response head, reused (capacity and all) for every response on this connection.
+    std::string head;
+    size_t served = 0;
+    // Created by the first response above zeroCopyThreshold; waits for its completions on exit.
+    std::unique_ptr<ZeroCopySender> zeroCopy;
+    // Bounds every blocking body read and response write (readHead has its own deadline).
+    (void)SocketIo::setTimeouts(clientSock, httpOptions.bodyTimeoutMs, httpOptions.writeTimeoutMs);
+    while (running) {
+        if (served > 0 && buffer.empty() && !SocketIo::waitReadable(clientSock, httpOptions.idleTimeoutMs)) {
+            break; // idle keep-alive connection timed out
+        }
+        if (!serveOne(clientSock, buffer, head, served, zeroCopy)) {
+            break;
+        }
+        ++served;
+    }
+}
+
+bool HttpServer::serveOne(int clientSock, std::string& buffer, std::string& head, size_t served,
+                          std::unique_ptr<ZeroCopySender>& zeroCopy) {
+    bool responseStarted = false;
+    // Allocations and copies made for this request, here and on the compute thread.
+    Instrumentation::Counters counters;
+    Instrumentation::Scope countScope(counters);
+    // Phase timings, kept only when someone will see them.
+    std::unique_ptr<RequestTrace> trace;
+    if (httpOptions.serverTiming || httpOptions.traceLog) {
+        trace = std::make_unique<RequestTrace>();
+    }
+    RequestTrace::Scope traceScope(trace.get());
+    // Handlers count the requests they answer; what the server refuses or a handler throws
+    // out of is counted below, under the endpoint once the head is known.
+    Metrics::Endpoint endpoint = Metrics::Endpoint::Other;
+    bool counted = false;
     try {
         // 1) read & parse headers
-        std::string raw = readHeaders(clientSock, 64 * 1024);
-        std::vector<char> leftover;
-        HttpRequest req = parseRequest(raw, leftover);
-
-        // 2) read body according to Content-Length
-        const size_t contentLength = parseContentLength(req);
-        req.body = std::move(leftover);
-        while (req.body.size() < contentLength) {
-            char buf[4096];
-            size_t want = std::min(sizeof(buf), contentLength - req.body.size());
-            const int wantInt = static_cast<int>(std::min<size_t>(want, static_cast<size_t>(INT_MAX)));
-            ssize_t n = ::recv(clientSock, buf, wantInt, 0);
-            if (n == 0) break;
-            if (n < 0) {
-                if (errno == EINTR) continue;
-                throw std::runtime_error(std::string("recv() failed: ") + std::strerror(errno));
+        Metrics::Clock::duration parseTime{};
+        // Declared before the request so the body's memory is freed before the budgets return.
+        BodyBudget budget(bufferedBodyBytes, httpOptions.maxBufferedBodyBytes);
+        BodyBudget inFlight(inFlightBytes, httpOptions.maxInFlightBytes);
+        HttpRequestParser parser;
+        if (!readHead(clientSock, buffer, parser, httpOptions.maxHeaderBytes, httpOptions.headerTimeoutMs, parseTime)) {
+            return false; // peer closed between requests
+        }
+        HttpRequest req;
+        const auto fillStart = Metrics::Clock::now();
+        parser.fill(req);
+        buffer.erase(0, parser.headerBytes());
+        const auto filled = Metrics::Clock::now() - fillStart;
+        RequestTrace::record(RequestTrace::Phase::Parse, filled);
+        Metrics::recordPhase(Metrics::Phase::Parse, parseTime + filled);
+        endpoint = Metrics::endpointFor(req.method, req.path);
+
+        // h2c with prior knowledge: that "request" was the first half of the HTTP/2 preface.
+        if (httpOptions.http2 && served == 0 && req.method == "PRI" && req.path == "*" && req.version == "HTTP/2.0") {
+            buffer.insert(0, "PRI * HTTP/2.0\r\n\r\n");
+            Http2Session session(clientSock, httpOptions, *compute, handler, preflightHandler, running, inFlightBytes);
+            session.run(std::move(buffer), nullptr);
+            return false;
+        }
+
+        const HttpRouteLimits* route = httpOptions.limitsFor(req.path);
+        const size_t maxHeaderBytes = route && route->maxHeaderBytes ? route->maxHeaderBytes : httpOptions.maxHeaderBytes;
+        const size_t maxBodyBytes = route && route->maxBodyBytes ? route->maxBodyBytes : httpOptions.maxBodyBytes;
+        if (parser.headerBytes() > maxHeaderBytes) {
+            throw HttpStatusError(431, "Request Header Fields Too Large", "request headers too large");
+        }
+
+        // Keep the connection only if both sides agree and we are under the per-connection cap.
+        bool keepAlive = httpOptions.keepAlive && running && clientWantsKeepAlive(req) &&
+                         (httpOptions.maxRequestsPerConnection == 0 ||
+                          served + 1 < httpOptions.maxRequestsPerConnection);
+
+        // 2) body: Transfer-Encoding: chunked takes precedence over Content-Length
+        const bool chunked = isChunked(req);
+        const size_t contentLength = chunked ? 0 : parseContentLength(req);
+        if (maxBodyBytes > 0 && contentLength > maxBodyBytes) {
+            throw HttpStatusError(413, "Payload Too Large", "request body too large");
+        }
+        // Admission control: a request that does not fit the in-flight budget now may well
+        // fit in a moment, so it is told to retry rather than queued or refused for good.
+        if (!inFlight.reserve(parser.headerBytes())) {
+            throw HttpStatusError(503, "Service Unavailable", "server is busy");
+        }
+        SocketBodyReader body(clientSock, buffer, chunked, contentLength, maxBodyBytes);
+        const bool hasBody = chunked || contentLength > 0;
+
+        // HTTP/1.0 clients cannot use Expect (RFC 9110 10.1.1); 100-continue is the only
+        // expectation defined.
+        const std::string_view expect = req.headers.get("expect");
+        if (!expect.empty() && req.version != "HTTP/1.0") {
+            if (!HttpHeaders::equalsIgnoreCase(expect, "100-continue")) {
+                throw HttpStatusError(417, "Expectation Failed", "unsupported expectation");
+            }
+            if (hasBody) body.expectContinue();
+        }
+
+        if (preflightHandler) {
+            HttpResponse rejection;
+            if (!preflightHandler(req, rejection)) {
+                counted = true;
+                // The body was not read, so the connection can only be kept if there is none.
+                keepAlive = keepAlive && !hasBody;
+                const std::string_view rejectionBody = rejection.bodyView();
+                writeHead(head, rejection, keepAlive, static_cast<long long>(rejectionBody.size()), false);
+                sendResponse(clientSock, head, rejectionBody.data(), rejectionBody.size());
+                if (!keepAlive && hasBody) discardInputBeforeClose(clientSock);
+                Instrumentation::recordRequest(counters.snapshot());
+                if (trace && httpOptions.traceLog) {
+                    httpOptions.traceLog(trace->json(req.method, req.path, rejection.statusCode, 0, rejectionBody.size()));
+                }
+                return keepAlive;
+            }
+        }
+
+        // 2a) large or chunked uploads may be streamed straight through a stream handler. It
+        //     pulls the body and pushes the response from a compute thread, so streamed codec
+        //     work counts against the same cap as buffered requests. It is a large job whatever
+        //     the body size, since it holds its worker for as long as the body takes to arrive.
+        if (streamHandler && (chunked || contentLength >= httpOptions.streamThreshold)) {
+            StreamingResponseWriter writer(clientSock, head, req.version != "HTTP/1.0", keepAlive,
+                                           httpOptions.zeroCopyThreshold, zeroCopy);
+            bool handled = false;
+            try {
+                const auto queuedAt = trace ? RequestTrace::Clock::now() : RequestTrace::Clock::time_point();
+                handled = compute->submit(SIZE_MAX, [this, &req, &body, &writer, &counters, &trace, queuedAt]() {
+                    Instrumentation::Scope scope(counters);
+                    RequestTrace::Scope traceScope(trace.get());
+                    if (trace) trace->add(RequestTrace::Phase::Queue, RequestTrace::Clock::now() - queuedAt);
+                    return streamHandler(req, body, writer);
+                }).get();
+            } catch (...) {
+                responseStarted = writer.headersWereSent();
+                throw;
+            }
+            if (handled) {
+                counted = true;
+                responseStarted = writer.headersWereSent();
+                if (!writer.isFinished()) {
+                    throw std::logic_error("stream handler returned without finishing the response");
+                }
+                Instrumentation::recordRequest(counters.snapshot());
+                if (trace && httpOptions.traceLog) {
+                    httpOptions.traceLog(trace->json(req.method, req.path, writer.statusCode(), contentLength,
+                                                     writer.bodyBytesWritten()));
+                }
+                // An unread body would be parsed as the next request; close instead.
+                return writer.connectionReusable() && body.complete();
+            }
+            if (body.started()) {
+                throw std::logic_error("stream handler declined after reading the body");
+            }
+        }
+
+        // 2b) buffer the whole body for the regular handler: on the heap while it is small and
+        //     within the global budget, otherwise in an unlinked temp file that is then mapped.
+        //     Either way it counts against the in-flight budget (streamed bodies above do not).
+        if (contentLength > httpOptions.maxInFlightBytes) {
+            throw HttpStatusError(413, "Payload Too Large", "request body too large");
+        }
+        if (!inFlight.reserve(contentLength)) {
+            throw HttpStatusError(503, "Service Unavailable", "server is busy");
+        }
+        body.reserveChunksIn(inFlight);
+        const auto bodyStart = trace ? RequestTrace::Clock::now() : RequestTrace::Clock::time_point();
+        std::vector<char> bytes;
+        const auto spoolRest = [&](const char* prefix, size_t prefixLength) {
+            const std::shared_ptr<SpoolFile> file = SpoolFile::create(httpOptions.spoolDirectory);
+            file->write(prefix, prefixLength);
+            body.drainTo(*file);
+            const std::string_view mapped = file->map();
+            req.body = ByteBuffer(file, mapped.data(), mapped.size());
+            req.spooledBody = file;
+        };
+        if (chunked) {
+            size_t used = 0;
+            bool spooled = false;
+            while (true) {
+                if (used == bytes.size()) {
+                    const size_t grown = std::min(std::max<size_t>(used * 2, 4096), httpOptions.spoolThreshold);
+                    if (grown == used || !budget.reserve(grown - used)) {
+                        spoolRest(bytes.data(), used);
+                        spooled = true;
+                        break;
+                    }
+                    bytes.resize(grown);
+                }
+                const size_t n = body.read(bytes.data() + used, bytes.size() - used);
+                if (n == 0) break;
+                used += n;
             }
-            req.body.insert(req.body.end(), buf, buf + n);
+            if (spooled) {
+                std::vector<char>().swap(bytes);
+                budget.release();
+            } else {
+                bytes.resize(used);
+                req.body = ByteBuffer(std::move(bytes));
+            }
+        } else if (contentLength <= httpOptions.spoolThreshold && budget.reserve(contentLength)) {
+            bytes.resize(contentLength);
+            size_t used = 0;
+            while (used < contentLength) {
+                used += body.read(bytes.data() + used, contentLength - used);
+            }
+            req.body = ByteBuffer(std::move(bytes));
+        } else {
+            spoolRest(nullptr, 0);
         }
-        if (req.body.size() != contentLength) {
-            throw std::runtime_error("incomplete body");
+        if (trace) trace->add(RequestTrace::Phase::Body, RequestTrace::Clock::now() - bodyStart);
+
+        // h2c upgrade (RFC 7540 3.2): the request, body and all, becomes stream 1.
+        if (httpOptions.http2 && wantsH2cUpgrade(req)) {
+            sendAll(clientSock, kSwitchingToH2c, sizeof(kSwitchingToH2c) - 1);
+            budget.release();
+            inFlight.release();
+            Http2Session session(clientSock, httpOptions, *compute, handler, preflightHandler, running, inFlightBytes);
+            session.run(std::move(buffer), &req);
+            return false;
         }
 
         // 3) produce response
         HttpResponse res;
         if (handler) {
-            res = handler(req);
+            // Codec work goes to the compute pool; this thread only waits for the result.
+            const auto queuedAt = trace ? RequestTrace::Clock::now() : RequestTrace::Clock::time_point();
+            res = compute->submit(req.bodyView().size(), [this, &req, &counters, &trace, queuedAt]() {
+                Instrumentation::Scope scope(counters);
+                RequestTrace::Scope traceScope(trace.get());
+                if (trace) trace->add(RequestTrace::Phase::Queue, RequestTrace::Clock::now() - queuedAt);
+                return handler(req);
+            }).get();
+            counted = true;
         } else {
             res.statusCode = 500;
             res.statusText = "Internal Server Error";
-            res.headers["Content-Type"] = "text/plain; charset=utf-8";
+            res.headers.set("Content-Type", "text/plain; charset=utf-8");
             const std::string msg = "No handler configured.\n";
             res.body.assign(msg.begin(), msg.end());
-        }
-
-        // Ensure Content-Length is correct for binary payloads.
-        res.headers["Content-Length"] = std::to_string(res.body.size());
-        if (res.headers.find("Connection") == res.headers.end() &&
-            res.headers.find("connection") == res.headers.end()) {
-            res.headers["Connection"] = "close";
+            Metrics::recordRequest(endpoint, 500, req.bodyView().size(), res.body.size());
+            counted = true;
         }
 
         // 4) write response
-        std::string header = "HTTP/1.1 " + std::to_string(res.statusCode) + " " + res.statusText + "\r\n";
-        for (const auto& kv : res.headers) {
-            header += kv.first + ": " + kv.second + "\r\n";
+        if (trace && httpOptions.serverTiming) {
+            res.headers.set("Server-Timing", trace->serverTiming());
         }
-        header += "\r\n";
-
-        sendAll(clientSock, header.data(), header.size());
-        if (!res.body.empty()) {
-            sendAll(clientSock, res.body.data(), res.body.size());
+        const size_t responseBytes = res.bodySize(); // the zero-copy path hands the body off
+        const auto sendStart = Metrics::Clock::now();
+        writeHead(head, res, keepAlive, static_cast<long long>(res.bodySize()), false);
+        if (res.bodyFile) {
+            sendResponse(clientSock, head, nullptr, 0);
+            responseStarted = true;
+            if (!SocketIo::sendFile(clientSock, res.bodyFile->fd(), 0, res.bodyFile->size())) {
+                throw std::runtime_error("sendfile() failed");
+            }
+        } else if (httpOptions.zeroCopyThreshold > 0 && res.bodySize() >= httpOptions.zeroCopyThreshold &&
+                   (zeroCopy == nullptr || zeroCopy->enabled())) {
+            if (!zeroCopy) {
+                zeroCopy = std::make_unique<ZeroCopySender>(clientSock);
+            }
+            // The sender holds the body until the kernel is done with it; adopting the vector
+            // is free, and a shared body is only a reference.
+            const ByteBuffer body = res.sharedBody.empty() ? ByteBuffer(std::move(res.body)) : res.sharedBody;
+            if (!zeroCopy->send(head, body)) {
+                throw std::runtime_error("send() failed");
+            }
+        } else {
+            const std::string_view bodyBytes = res.bodyView();
+            sendResponse(clientSock, head, bodyBytes.data(), bodyBytes.size());
+        }
+        const auto sent = Metrics::Clock::now() - sendStart;
+        Metrics::recordPhase(Metrics::Phase::Send, sent);
+        Instrumentation::recordRequest(counters.snapshot());
+        if (trace) {
+            trace->add(RequestTrace::Phase::Send, sent);
+            if (httpOptions.traceLog) {
+                httpOptions.traceLog(trace->json(req.method, req.path, res.statusCode, req.bodyView().size(), responseBytes));
+            }
+        }
+        return keepAlive;
+    } catch (const HttpStatusError& e) {
+        if (!counted) Metrics::recordRequest(endpoint, e.status, 0, 0);
+        if (!responseStarted) {
+            const std::string resp = errorResponse(e.status, e.reason, e.what(), httpOptions.retryAfterSeconds);
+            if (SocketIo::sendAll(clientSock, resp.data(), resp.size())) {
+                discardInputBeforeClose(clientSock);
+            }
         }
+        return false;
     } catch (const std::exception& e) {
-        // Best-effort 400 response if parsing fails.
-        const std::string body = std::string("Bad Request: ") + e.what() + "\n";
-        const std::string resp =
-            "HTTP/1.1 400 Bad Request\r\n"
-            "Content-Type: text/plain; charset=utf-8\r\n"
-            "Content-Length: " + std::to_string(body.size()) + "\r\n"
-            "Connection: close\r\n"
-            "\r\n" + body;
-        (void)::send(clientSock, resp.data(), resp.size(), 0);
-    }
-
-    ::close(clientSock);
+        if (!counted) Metrics::recordRequest(endpoint, 400, 0, 0);
+        if (responseStarted) {
+            return false; // mid-response failure: closing is the only way to signal it
+        }
+        // Best-effort 400 response if parsing fails; the stream position is unknown, so close
+        // (after draining, so unread input does not turn the close into a RST that eats the 400).
+        const std::string resp = errorResponse(400, "Bad Request", e.what(), 0);
+        if (SocketIo::sendAll(clientSock, resp.data(), resp.size())) {
+            discardInputBeforeClose(clientSock);
+        }
+        return false;
+    }
 }
-
-
@@ -6,6 +6,9 @@
 #include <csignal>
 #include <chrono>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string> 
 #include <thread>
 
@@ -15,18 +18,178 @@ std::atomic<bool> g_stop{false};
 void handleSignal(int) {
     g_stop = true;
 }
+
+void printUsage() {
+    std::cerr << "Usage: http_server [port] [options]\n"
+                 "Socket options:\n"
+                 "  --backlog N          listen() backlog (default 128)\n"
+                 "  --nodelay            set TCP_NODELAY on connections\n"
+                 "  --defer-accept SECS  TCP_DEFER_ACCEPT (Linux)\n"
+                 "  --fastopen QLEN      TCP_FASTOPEN queue length\n"
+                 "  --keepalive [SECS]   SO_KEEPALIVE, optionally with the idle time before probes\n"
+                 "  --rcvbuf BYTES       SO_RCVBUF\n"
+                 "  --sndbuf BYTES       SO_SNDBUF\n"
+                 "Listeners:\n"
+                 "  --unix PATH          also listen on a Unix domain socket ('@name' = abstract namespace)\n"
+                 "  --unix-mode MODE     octal permissions for the socket file (default 0660)\n"
+                 "  --no-tcp             do not listen on TCP (requires --unix)\n"
+                 "HTTP options:\n"
+                 "  --idle-timeout MS    close idle keep-alive connections after MS (default 5000)\n"
+                 "  --max-requests N     requests per connection before closing (0 = unlimited)\n"
+                 "  --no-keepalive       one request per connection\n"
+                 "  --stream-threshold N stream request bodies of at least N bytes, and chunked ones\n"
+                 "                       (default 67108864; below it, bodies are buffered or spooled)\n"
+                 "  --compute-threads N  codec worker threads (default: one per core)\n"
+                 "  --cache-bytes N      result cache budget in bytes, 0 = off (default 67108864)\n"
+                 "  --spool-threshold N  keep request bodies up to N bytes in memory, spool larger ones\n"
+                 "                       to a temp file (default 8388608)\n"
+                 "  --max-buffered-bytes N\n"
+                 "                       in-memory request bodies of all connections together (default 268435456)\n"
+                 "  --spool-dir PATH     directory for spooled bodies (default $TMPDIR or /tmp)\n"
+                 "Limits:\n"
+                 "  --header-timeout MS  time allowed to send a request head (default 10000, 0 = none)\n"
+                 "  --body-timeout MS    longest stall while receiving a body (default 30000, 0 = none)\n"
+                 "  --write-timeout MS   longest stall while sending a response (default 30000, 0 = none)\n"
+                 "  --max-body-bytes N   reject larger request bodies with 413 (default 0 = unlimited)\n"
+                 "  --max-inflight-bytes N\n"
+                 "                       bytes of all requests in flight before 503 (default 1073741824)\n"
+                 "  --max-connections N  connections served at once before 503 (default 4096, 0 = unlimited)\n"
+                 "  --zerocopy-threshold N\n"
+                 "                       send response bodies of N bytes or more with MSG_ZEROCOPY (default 0 = off)\n"
+                 "HTTP/2:\n"
+                 "  --no-http2           answer only HTTP/1.x (no h2c prior knowledge or Upgrade)\n"
+                 "  --http2-max-streams N\n"
+                 "                       concurrent requests per HTTP/2 connection (default 256)\n"
+                 "Tracing:\n"
+                 "  --server-timing      add a Server-Timing header with per-phase timings to responses\n"
+                 "  --trace-log          print one JSON line of per-phase timings per request to stderr\n";
+}
+
+bool isNumber(const char* s) {
+    if (s == nullptr || *s == '\0') return false;
+    for (; *s; ++s) {
+        if (*s < '0' || *s > '9') return false;
+    }
+    return true;
+}
 } // namespace
 
 int main(int argc, char** argv) {
     int port = 8081;
-    if (argc >= 2) {
+    bool portGiven = false;
+    SocketOptions socketOptions;
+    HttpServerOptions httpOptions;
+    size_t cacheBytes = CompressionApi::kDefaultCacheBytes;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        // Options taking an integer value consume the next argument.
+        auto intValue = [&](int& out) {
+            if (i + 1 >= argc || !isNumber(argv[i + 1])) {
+                throw std::invalid_argument(arg + " expects a non-negative integer");
+            }
+            out = std::stoi(argv[++i]);
+        };
+        auto sizeValue = [&](size_t& out) {
+            if (i + 1 >= argc || !isNumber(argv[i + 1])) {
+                throw std::invalid_argument(arg + " expects a non-negative integer");
+            }
+            out = static_cast<size_t>(std::stoull(argv[++i]));
+        };
         try {
-            port = std::stoi(argv[1]);
-        } catch (...) {
-            std::cerr << "Usage: http_server [port]\n";
+            if (arg == "--backlog") {
+                intValue(socketOptions.backlog);
+            } else if (arg == "--nodelay") {
+                socketOptions.noDelay = true;
+            } else if (arg == "--defer-accept") {
+                intValue(socketOptions.deferAcceptSeconds);
+            } else if (arg == "--fastopen") {
+                intValue(socketOptions.fastOpenQueue);
+            } else if (arg == "--keepalive") {
+                socketOptions.keepAlive = true;
+                if (i + 1 < argc && isNumber(argv[i + 1])) {
+                    socketOptions.keepAliveIdleSeconds = std::stoi(argv[++i]);
+                }
+            } else if (arg == "--rcvbuf") {
+                intValue(socketOptions.receiveBufferBytes);
+            } else if (arg == "--sndbuf") {
+                intValue(socketOptions.sendBufferBytes);
+            } else if (arg == "--unix") {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument("--unix expects a path");
+                }
+                socketOptions.unixPath = argv[++i];
+            } else if (arg == "--unix-mode") {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument("--unix-mode expects an octal mode");
+                }
+                socketOptions.unixMode = std::stoi(argv[++i], nullptr, 8);
+            } else if (arg == "--no-tcp") {
+                socketOptions.tcpEnabled = false;
+            } else if (arg == "--idle-timeout") {
+                intValue(httpOptions.idleTimeoutMs);
+            } else if (arg == "--max-requests") {
+                sizeValue(httpOptions.maxRequestsPerConnection);
+            } else if (arg == "--stream-threshold") {
+                sizeValue(httpOptions.streamThreshold);
+            } else if (arg == "--cache-bytes") {
+                sizeValue(cacheBytes);
+            } else if (arg == "--compute-threads") {
+                sizeValue(httpOptions.computeThreads);
+            } else if (arg == "--spool-threshold") {
+                sizeValue(httpOptions.spoolThreshold);
+            } else if (arg == "--max-buffered-bytes") {
+                sizeValue(httpOptions.maxBufferedBodyBytes);
+            } else if (arg == "--spool-dir") {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument("--spool-dir expects a path");
+                }
+                httpOptions.spoolDirectory = argv[++i];
+            } else if (arg == "--header-timeout") {
+                intValue(httpOptions.headerTimeoutMs);
+            } else if (arg == "--body-timeout") {
+                intValue(httpOptions.bodyTimeoutMs);
+            } else if (arg == "--write-timeout") {
+                intValue(httpOptions.writeTimeoutMs);
+            } else if (arg == "--max-body-bytes") {
+                sizeValue(httpOptions.maxBodyBytes);
+            } else if (arg == "--max-inflight-bytes") {
+                sizeValue(httpOptions.maxInFlightBytes);
+            } else if (arg == "--max-connections") {
+                sizeValue(httpOptions.maxConnections);
+            } else if (arg == "--zerocopy-threshold") {
+                sizeValue(httpOptions.zeroCopyThreshold);
+            } else if (arg == "--no-http2") {
+                httpOptions.http2 = false;
+            } else if (arg == "--http2-max-streams") {
+                sizeValue(httpOptions.http2MaxStreams);
+            } else if (arg == "--server-timing") {
+                httpOptions.serverTiming = true;
+            } else if (arg == "--trace-log") {
+                httpOptions.traceLog = [](const std::string& line) {
+                    static std::mutex logMutex;
+                    std::lock_guard<std::mutex> lock(logMutex);
+                    std::cerr << line << "\n";
+                };
+            } else if (arg == "--no-keepalive") {
+                httpOptions.keepAlive = false;
+            } else if (arg == "-h" || arg == "--help") {
+                printUsage();
+                return 0;
+            } else if (!portGiven && isNumber(argv[i])) {
+                port = std::stoi(arg);
+                portGiven = true;
+            } else {
+                throw std::invalid_argument("unknown argument '" + arg + "'");
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "http_server: " << e.what() << "\n";
+            printUsage();
             return 2;
         }
-    } else {
+    }
+
+    if (!portGiven) {
         // Railway (and many other PaaS) provides the listen port via PORT.
         if (const char* envPort = std::getenv("PORT")) {
             try {
@@ -38,9 +201,13 @@ int main(int argc, char** argv) {
         }
     }
 
-    CompressionApi api;
-    HttpServer server(port);
-    server.setHandler([&api](const HttpRequest& req) { return api.handle(req); });
+    // One compute pool for request handlers and the batch items they fan out.
+    httpOptions.computePool = std::make_shared<WorkerPool>(httpOptions.computeThreads, httpOptions.computeSmallJobBytes);
+    CompressionApi api(cacheBytes);
+    api.setWorkerPool(httpOptions.computePool);
+    api.setSpoolDirectory(httpOptions.spoolDirectory);
+    HttpServer server(port, socketOptions, httpOptions);
+    api.install(server);
 
     // Container-friendly lifecycle: don't depend on stdin being attached.
     std::signal(SIGINT, handleSignal);
@@ -49,12 +216,17 @@ int main(int argc, char** argv) {
     try {
         server.start();
     } catch (const std::exception& e) {
-        std::cerr << "Failed to start HTTP server on port " << port << ": " << e.what() << "\n";
+        std::cerr << "Failed to start HTTP server (port " << port << "): " << e.what() << "\n";
         std::cerr << "Tip: if you already have the docker api running, stop it or pick another port.\n";
         return 1;
     }
 
-    std::cout << "HTTP API listening on port " << port << "\n";
+    if (socketOptions.tcpEnabled) {
+        std::cout << "HTTP API listening on port " << port << "\n";
+    }
+    if (!socketOptions.unixPath.empty()) {
+        std::cout << "HTTP API listening on unix:" << socketOptions.unixPath << "\n";
+    }
     std::cout << "Endpoints:\n";
     std::cout << "  POST /compress   (binary body)\n";
     std::cout << "  POST /decompress (binary body)\n";
@@ -0,0 +1,138 @@
+#include "HttpTypes.h"
+#include "SpoolFile.h"
+
+#include <algorithm>
+
+namespace {
+char lowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+} // namespace
+
+bool HttpHeaders::equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (lowerAscii(a[i]) != lowerAscii(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void HttpHeaders::set(std::string_view name, std::string_view value) {
+    erase(name);
+    add(name, value);
+}
+
+void HttpHeaders::add(std::string_view name, std::string_view value) {
+    Entry e{};
+    e.nameOffset = static_cast<uint32_t>(arena.size());
+    e.nameLength = static_cast<uint32_t>(name.size());
+    arena.append(name.data(), name.size());
+    e.valueOffset = static_cast<uint32_t>(arena.size());
+    e.valueLength = static_cast<uint32_t>(value.size());
+    arena.append(value.data(), value.size());
+    entries.push_back(e);
+}
+
+std::string_view HttpHeaders::get(std::string_view name) const {
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Field f = at(i);
+        if (equalsIgnoreCase(f.first, name)) {
+            return f.second;
+        }
+    }
+    return std::string_view();
+}
+
+bool HttpHeaders::has(std::string_view name) const {
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (equalsIgnoreCase(at(i).first, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HttpHeaders::erase(std::string_view name) {
+    const size_t before = entries.size();
+    // Arena bytes of erased fields are simply abandoned; headers are short-lived.
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [&](const Entry& e) {
+                                     return equalsIgnoreCase(std::string_view(arena.data() + e.nameOffset, e.nameLength), name);
+                                 }),
+                  entries.end());
+    return entries.size() != before;
+}
+
+HttpHeaders::Field HttpHeaders::at(size_t i) const {
+    const Entry& e = entries[i];
+    return Field(std::string_view(arena.data() + e.nameOffset, e.nameLength),
+                 std::string_view(arena.data() + e.valueOffset, e.valueLength));
+}
+
+void HttpHeaders::clear() {
+    arena.clear();
+    entries.clear();
+}
+
+void HttpHeaders::reserve(size_t fields, size_t bytes) {
+    entries.reserve(fields);
+    arena.reserve(bytes);
+}
+
+namespace {
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void percentDecode(std::string_view in, std::string& out) {
+    out.clear();
+    out.reserve(in.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+        if (in[i] == '+') {
+            out += ' ';
+        } else if (in[i] == '%' && i + 2 < in.size() && hexValue(in[i + 1]) >= 0 && hexValue(in[i + 2]) >= 0) {
+            out += static_cast<char>(hexValue(in[i + 1]) * 16 + hexValue(in[i + 2]));
+            i += 2;
+        } else {
+            out += in[i]; // malformed escapes are kept literally
+        }
+    }
+}
+} // namespace
+
+bool HttpRequest::queryParam(std::string_view name, std::string& value) const {
+    std::string_view rest(query);
+    std::string key;
+    while (!rest.empty()) {
+        const size_t amp = rest.find('&');
+        const std::string_view pair = rest.substr(0, amp);
+        rest = amp == std::string_view::npos ? std::string_view() : rest.substr(amp + 1);
+        const size_t eq = pair.find('=');
+        percentDecode(pair.substr(0, eq), key);
+        if (key != name) continue;
+        percentDecode(eq == std::string_view::npos ? std::string_view() : pair.substr(eq + 1), value);
+        return true;
+    }
+    return false;
+}
+
+std::string_view HttpResponse::bodyView() const {
+    if (bodyFile) {
+        return bodyFile->view();
+    }
+    if (!sharedBody.empty()) {
+        return sharedBody.view();
+    }
+    return std::string_view(body.data(), body.size());
+}
+
+size_t HttpResponse::bodySize() const {
+    return bodyFile ? bodyFile->size() : bodyView().size();
+}
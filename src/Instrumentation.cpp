@@ -0,0 +1,120 @@
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+Instrumentation::Snapshot Instrumentation::Counters::snapshot() const {
+    Snapshot s;
+    s.allocations = allocations.load(std::memory_order_relaxed);
+    s.allocatedBytes = allocatedBytes.load(std::memory_order_relaxed);
+    s.copiedBytes = copiedBytes.load(std::memory_order_relaxed);
+    return s;
+}
+
+#ifdef COMPRESSION_INSTRUMENTATION
+namespace {
+// Plain pointer: constant-initialized, so it is safe to touch from operator new at any point
+// of a thread's life.
+thread_local Instrumentation::Counters* t_current = nullptr;
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocatedBytes{0};
+std::atomic<uint64_t> g_copiedBytes{0};
+
+std::atomic<uint64_t> g_requests{0};
+std::atomic<uint64_t> g_requestAllocations{0};
+std::atomic<uint64_t> g_requestAllocatedBytes{0};
+std::atomic<uint64_t> g_requestCopiedBytes{0};
+std::atomic<uint64_t> g_maxAllocations{0};
+std::atomic<uint64_t> g_maxAllocatedBytes{0};
+std::atomic<uint64_t> g_maxCopiedBytes{0};
+
+void raiseTo(std::atomic<uint64_t>& max, uint64_t value) {
+    uint64_t current = max.load(std::memory_order_relaxed);
+    while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void* countedAlloc(std::size_t size) {
+    Instrumentation::recordAllocation(size);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+} // namespace
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+Instrumentation::Scope::Scope(Counters& counters) : previous(t_current) {
+    t_current = &counters;
+}
+
+Instrumentation::Scope::~Scope() {
+    t_current = previous;
+}
+
+void Instrumentation::recordCopy(size_t bytes) {
+    g_copiedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (Counters* c = t_current) c->copiedBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Instrumentation::recordAllocation(size_t bytes) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (Counters* c = t_current) {
+        c->allocations.fetch_add(1, std::memory_order_relaxed);
+        c->allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+void Instrumentation::recordRequest(const Snapshot& request) {
+    g_requests.fetch_add(1, std::memory_order_relaxed);
+    g_requestAllocations.fetch_add(request.allocations, std::memory_order_relaxed);
+    g_requestAllocatedBytes.fetch_add(request.allocatedBytes, std::memory_order_relaxed);
+    g_requestCopiedBytes.fetch_add(request.copiedBytes, std::memory_order_relaxed);
+    raiseTo(g_maxAllocations, request.allocations);
+    raiseTo(g_maxAllocatedBytes, request.allocatedBytes);
+    raiseTo(g_maxCopiedBytes, request.copiedBytes);
+}
+
+Instrumentation::Snapshot Instrumentation::totals() {
+    Snapshot s;
+    s.allocations = g_allocations.load(std::memory_order_relaxed);
+    s.allocatedBytes = g_allocatedBytes.load(std::memory_order_relaxed);
+    s.copiedBytes = g_copiedBytes.load(std::memory_order_relaxed);
+    return s;
+}
+
+std::string Instrumentation::renderJson() {
+    const Snapshot t = totals();
+    const uint64_t requests = g_requests.load(std::memory_order_relaxed);
+    auto mean = [requests](const std::atomic<uint64_t>& sum) {
+        return std::to_string(requests ? sum.load(std::memory_order_relaxed) / requests : 0);
+    };
+    auto triple = [](const std::string& a, const std::string& b, const std::string& c) {
+        return "{\"allocations\":" + a + ",\"allocated_bytes\":" + b + ",\"copied_bytes\":" + c + "}";
+    };
+    return "{\"enabled\":true,\"totals\":" +
+           triple(std::to_string(t.allocations), std::to_string(t.allocatedBytes), std::to_string(t.copiedBytes)) +
+           ",\"requests\":" + std::to_string(requests) + ",\"per_request_mean\":" +
+           triple(mean(g_requestAllocations), mean(g_requestAllocatedBytes), mean(g_requestCopiedBytes)) +
+           ",\"per_request_max\":" +
+           triple(std::to_string(g_maxAllocations.load(std::memory_order_relaxed)),
+                  std::to_string(g_maxAllocatedBytes.load(std::memory_order_relaxed)),
+                  std::to_string(g_maxCopiedBytes.load(std::memory_order_relaxed))) +
+           "}\n";
+}
+#else
+Instrumentation::Snapshot Instrumentation::totals() {
+    return Snapshot();
+}
+
+std::string Instrumentation::renderJson() {
+    return "{\"enabled\":false}\n";
+}
+#endif
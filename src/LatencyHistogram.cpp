@@ -0,0 +1,78 @@
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+unsigned highestBit(uint64_t v) {
+    unsigned bit = 0;
+    while (v >>= 1) ++bit;
+    return bit;
+}
+} // namespace
+
+// Values 0 .. 2*kSubBuckets-1 map to themselves. Above that, a value whose highest set bit is
+// m keeps its top kSubBucketBits+1 bits: shift = m - kSubBucketBits, and the bucket is
+// (shift + 1) * kSubBuckets + (value >> shift) - kSubBuckets.
+LatencyHistogram::LatencyHistogram() = default;
+
+size_t LatencyHistogram::indexOf(uint64_t value) {
+    if (value < 2 * kSubBuckets) return static_cast<size_t>(value);
+    const unsigned shift = highestBit(value) - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + static_cast<size_t>(value >> shift) - kSubBuckets;
+}
+
+uint64_t LatencyHistogram::highestInBucket(size_t index) {
+    if (index < 2 * kSubBuckets) return index;
+    const unsigned shift = static_cast<unsigned>(index / kSubBuckets - 1);
+    const uint64_t sub = kSubBuckets + index % kSubBuckets;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    record(value, 1);
+}
+
+void LatencyHistogram::record(uint64_t value, uint64_t times) {
+    if (times == 0) return;
+    const size_t index = indexOf(value);
+    if (index >= counts.size()) counts.resize(index + 1, 0);
+    counts[index] += times;
+    total += times;
+    sum += static_cast<long double>(value) * times;
+    lowest = std::min(lowest, value);
+    highest = std::max(highest, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.counts.size() > counts.size()) counts.resize(other.counts.size(), 0);
+    for (size_t i = 0; i < other.counts.size(); ++i) counts[i] += other.counts[i];
+    total += other.total;
+    sum += other.sum;
+    lowest = std::min(lowest, other.lowest);
+    highest = std::max(highest, other.highest);
+}
+
+void LatencyHistogram::reset() {
+    counts.clear();
+    total = 0;
+    sum = 0;
+    lowest = UINT64_MAX;
+    highest = 0;
+}
+
+double LatencyHistogram::mean() const {
+    return total ? static_cast<double>(sum / total) : 0.0;
+}
+
+uint64_t LatencyHistogram::percentile(double percent) const {
+    if (total == 0) return 0;
+    const double clamped = std::min(100.0, std::max(0.0, percent));
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * total)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) return std::min(highestInBucket(i), highest);
+    }
+    return highest;
+}
@@ -0,0 +1,341 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+constexpr size_t kEndpoints = static_cast<size_t>(Metrics::Endpoint::Count);
+constexpr size_t kPhases = static_cast<size_t>(Metrics::Phase::Count);
+constexpr size_t kCodecs = static_cast<size_t>(Metrics::Codec::Count);
+constexpr size_t kPools = static_cast<size_t>(Metrics::Pool::Count);
+constexpr size_t kCacheEvents = static_cast<size_t>(Metrics::CacheEvent::Count);
+
+const char* const kEndpointNames[kEndpoints] = {"compress", "decompress", "batch_compress", "batch_decompress",
+                                                "health",   "metrics",    "options",        "other"};
+const char* const kPhaseNames[kPhases] = {"parse", "codec", "send"};
+const char* const kCodecNames[kCodecs] = {"rle", "identity", "other"};
+const char* const kPoolNames[kPools] = {"io", "compute"};
+const char* const kCacheEventNames[kCacheEvents] = {"hit", "miss", "eviction", "not_modified"};
+
+// Status codes get their own series; anything else is counted as code="other".
+constexpr int kStatusCodes[] = {200, 204, 304, 400, 404, 405, 408, 413, 417, 431, 500, 503};
+constexpr size_t kStatusSlots = sizeof(kStatusCodes) / sizeof(kStatusCodes[0]) + 1;
+
+// Histogram upper bounds; the implicit last bucket is +Inf.
+constexpr double kLatencyBounds[] = {0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+                                     0.025,   0.05,   0.1,     0.25,   0.5,   1,      2.5,    5};
+constexpr size_t kLatencyBuckets = sizeof(kLatencyBounds) / sizeof(kLatencyBounds[0]) + 1;
+constexpr double kRatioBounds[] = {0.5, 0.9, 1, 1.1, 1.5, 2, 4, 8, 16, 64, 256};
+constexpr size_t kRatioBuckets = sizeof(kRatioBounds) / sizeof(kRatioBounds[0]) + 1;
+
+using Counter = std::atomic<uint64_t>;
+
+// Written only by the owning thread, read by scrapes. Value-initialised (all zero).
+struct Shard {
+    Counter requests[kEndpoints][kStatusSlots];
+    Counter bytesIn[kEndpoints];
+    Counter bytesOut[kEndpoints];
+    Counter phaseBuckets[kPhases][kLatencyBuckets];
+    Counter phaseSumNs[kPhases];
+    Counter ratioBuckets[kRatioBuckets];
+    Counter ratioSumMicros; // compression ratio * 1e6
+    Counter codecs[kCodecs];
+    Counter cacheEvents[kCacheEvents];
+};
+
+struct Registry {
+    std::mutex mtx;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<Shard*> idle; // shards of exited threads, reused by new ones
+    std::atomic<int64_t> connections{0};
+    std::atomic<int64_t> threads[kPools] = {};
+    std::atomic<int64_t> cacheBytes{0};
+};
+
+Registry& registry() {
+    // Leaked on purpose: thread_local leases may be released after static destruction starts.
+    static Registry* r = new Registry();
+    return *r;
+}
+
+struct ShardLease {
+    Shard* shard;
+
+    ShardLease() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        if (!r.idle.empty()) {
+            shard = r.idle.back();
+            r.idle.pop_back();
+        } else {
+            r.shards.emplace_back(new Shard());
+            shard = r.shards.back().get();
+        }
+    }
+
+    ~ShardLease() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        r.idle.push_back(shard);
+    }
+};
+
+Shard& localShard() {
+    thread_local ShardLease lease;
+    return *lease.shard;
+}
+
+// Single writer per shard, so a plain load/store pair is enough (and avoids a locked add).
+inline void bump(Counter& c, uint64_t v = 1) {
+    c.store(c.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+size_t statusSlot(int code) {
+    for (size_t i = 0; i + 1 < kStatusSlots; ++i) {
+        if (kStatusCodes[i] == code) return i;
+    }
+    return kStatusSlots - 1;
+}
+
+template <size_t N>
+size_t bucketFor(const double (&bounds)[N], double value) {
+    size_t i = 0;
+    while (i < N && value > bounds[i]) ++i;
+    return i;
+}
+
+// Bucket bounds print short ("0.0025"); sums keep full precision.
+void appendDouble(std::string& out, double v, bool exact = true) {
+    char buf[32];
+    const int n = std::snprintf(buf, sizeof(buf), exact ? "%.9g" : "%g", v);
+    out.append(buf, static_cast<size_t>(n));
+}
+
+void appendHeader(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void appendSample(std::string& out, const char* name, const std::string& labels, uint64_t value) {
+    out += name;
+    if (!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    out += std::to_string(value);
+    out += '\n';
+}
+
+// Cumulative buckets plus _sum and _count, as Prometheus expects.
+template <size_t N>
+void appendHistogram(std::string& out, const char* name, const std::string& labels, const double (&bounds)[N],
+                     const uint64_t (&buckets)[N + 1], double sum) {
+    const std::string prefix = labels.empty() ? std::string() : labels + ",";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i <= N; ++i) {
+        cumulative += buckets[i];
+        out += name;
+        out += "_bucket{";
+        out += prefix;
+        out += "le=\"";
+        if (i < N) {
+            appendDouble(out, bounds[i], false);
+        } else {
+            out += "+Inf";
+        }
+        out += "\"} ";
+        out += std::to_string(cumulative);
+        out += '\n';
+    }
+    out += name;
+    out += "_sum";
+    if (!labels.empty()) out += "{" + labels + "}";
+    out += ' ';
+    appendDouble(out, sum);
+    out += '\n';
+    out += name;
+    out += "_count";
+    if (!labels.empty()) out += "{" + labels + "}";
+    out += ' ';
+    out += std::to_string(cumulative);
+    out += '\n';
+}
+
+// Plain (non-atomic) sum of every shard, taken at scrape time.
+struct Totals {
+    uint64_t requests[kEndpoints][kStatusSlots] = {};
+    uint64_t bytesIn[kEndpoints] = {};
+    uint64_t bytesOut[kEndpoints] = {};
+    uint64_t phaseBuckets[kPhases][kLatencyBuckets] = {};
+    uint64_t phaseSumNs[kPhases] = {};
+    uint64_t ratioBuckets[kRatioBuckets] = {};
+    uint64_t ratioSumMicros = 0;
+    uint64_t codecs[kCodecs] = {};
+    uint64_t cacheEvents[kCacheEvents] = {};
+
+    void add(const Shard& s) {
+        auto get = [](const Counter& c) { return c.load(std::memory_order_relaxed); };
+        for (size_t e = 0; e < kEndpoints; ++e) {
+            for (size_t i = 0; i < kStatusSlots; ++i) requests[e][i] += get(s.requests[e][i]);
+            bytesIn[e] += get(s.bytesIn[e]);
+            bytesOut[e] += get(s.bytesOut[e]);
+        }
+        for (size_t p = 0; p < kPhases; ++p) {
+            for (size_t i = 0; i < kLatencyBuckets; ++i) phaseBuckets[p][i] += get(s.phaseBuckets[p][i]);
+            phaseSumNs[p] += get(s.phaseSumNs[p]);
+        }
+        for (size_t i = 0; i < kRatioBuckets; ++i) ratioBuckets[i] += get(s.ratioBuckets[i]);
+        ratioSumMicros += get(s.ratioSumMicros);
+        for (size_t c = 0; c < kCodecs; ++c) codecs[c] += get(s.codecs[c]);
+        for (size_t c = 0; c < kCacheEvents; ++c) cacheEvents[c] += get(s.cacheEvents[c]);
+    }
+};
+} // namespace
+
+Metrics::Endpoint Metrics::endpointFor(std::string_view method, std::string_view path) {
+    if (method == "OPTIONS") return Endpoint::Options;
+    if (path == "/compress") return Endpoint::Compress;
+    if (path == "/decompress") return Endpoint::Decompress;
+    if (path == "/batch/compress") return Endpoint::BatchCompress;
+    if (path == "/batch/decompress") return Endpoint::BatchDecompress;
+    if (path == "/health") return Endpoint::Health;
+    if (path == "/metrics") return Endpoint::Metrics;
+    return Endpoint::Other;
+}
+
+void Metrics::recordRequest(Endpoint endpoint, int statusCode, size_t bytesIn, size_t bytesOut) {
+    Shard& s = localShard();
+    const size_t e = static_cast<size_t>(endpoint);
+    bump(s.requests[e][statusSlot(statusCode)]);
+    bump(s.bytesIn[e], bytesIn);
+    bump(s.bytesOut[e], bytesOut);
+}
+
+void Metrics::recordPhase(Phase phase, Clock::duration elapsed) {
+    Shard& s = localShard();
+    const size_t p = static_cast<size_t>(phase);
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    const uint64_t clamped = ns > 0 ? static_cast<uint64_t>(ns) : 0;
+    bump(s.phaseBuckets[p][bucketFor(kLatencyBounds, static_cast<double>(clamped) / 1e9)]);
+    bump(s.phaseSumNs[p], clamped);
+}
+
+void Metrics::recordCompression(Codec codec, size_t bytesIn, size_t bytesOut) {
+    Shard& s = localShard();
+    bump(s.codecs[static_cast<size_t>(codec)]);
+    if (bytesOut == 0) return; // empty input: no meaningful ratio
+    const double ratio = static_cast<double>(bytesIn) / static_cast<double>(bytesOut);
+    bump(s.ratioBuckets[bucketFor(kRatioBounds, ratio)]);
+    bump(s.ratioSumMicros, static_cast<uint64_t>(ratio * 1e6));
+}
+
+Metrics::Codec Metrics::codecForTag(char tag) {
+    if (tag == 'R') return Codec::Rle;
+    if (tag == 'I') return Codec::Identity;
+    return Codec::Other;
+}
+
+void Metrics::recordCache(CacheEvent event) {
+    bump(localShard().cacheEvents[static_cast<size_t>(event)]);
+}
+
+void Metrics::connectionOpened() {
+    registry().connections.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::connectionClosed() {
+    registry().connections.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void Metrics::addThreads(Pool pool, long delta) {
+    registry().threads[static_cast<size_t>(pool)].fetch_add(delta, std::memory_order_relaxed);
+}
+
+void Metrics::addCacheBytes(long long delta) {
+    registry().cacheBytes.fetch_add(delta, std::memory_order_relaxed);
+}
+
+std::string Metrics::render() {
+    Registry& r = registry();
+    Totals t;
+    {
+        std::lock_guard<std::mutex> lock(r.mtx);
+        for (const auto& shard : r.shards) {
+            t.add(*shard);
+        }
+    }
+
+    std::string out;
+    out.reserve(8192);
+
+    appendHeader(out, "compressor_http_requests_total", "counter", "HTTP requests by endpoint and status code.");
+    for (size_t e = 0; e < kEndpoints; ++e) {
+        for (size_t i = 0; i < kStatusSlots; ++i) {
+            if (t.requests[e][i] == 0) continue;
+            const std::string code = i + 1 < kStatusSlots ? std::to_string(kStatusCodes[i]) : "other";
+            appendSample(out, "compressor_http_requests_total",
+                         std::string("endpoint=\"") + kEndpointNames[e] + "\",code=\"" + code + "\"",
+                         t.requests[e][i]);
+        }
+    }
+
+    appendHeader(out, "compressor_http_request_bytes_total", "counter", "Request body bytes received.");
+    for (size_t e = 0; e < kEndpoints; ++e) {
+        appendSample(out, "compressor_http_request_bytes_total", std::string("endpoint=\"") + kEndpointNames[e] + "\"",
+                     t.bytesIn[e]);
+    }
+    appendHeader(out, "compressor_http_response_bytes_total", "counter", "Response body bytes sent.");
+    for (size_t e = 0; e < kEndpoints; ++e) {
+        appendSample(out, "compressor_http_response_bytes_total", std::string("endpoint=\"") + kEndpointNames[e] + "\"",
+                     t.bytesOut[e]);
+    }
+
+    appendHeader(out, "compressor_phase_seconds", "histogram", "Time spent parsing request heads (excluding waits for their bytes), in codecs, and sending responses.");
+    for (size_t p = 0; p < kPhases; ++p) {
+        appendHistogram(out, "compressor_phase_seconds", std::string("phase=\"") + kPhaseNames[p] + "\"",
+                        kLatencyBounds, t.phaseBuckets[p], static_cast<double>(t.phaseSumNs[p]) / 1e9);
+    }
+
+    appendHeader(out, "compressor_compression_ratio", "histogram", "Input bytes / output bytes per compress call.");
+    appendHistogram(out, "compressor_compression_ratio", std::string(), kRatioBounds, t.ratioBuckets,
+                    static_cast<double>(t.ratioSumMicros) / 1e6);
+
+    appendHeader(out, "compressor_codec_selected_total", "counter", "Codec chosen by adaptive compression.");
+    for (size_t c = 0; c < kCodecs; ++c) {
+        appendSample(out, "compressor_codec_selected_total", std::string("codec=\"") + kCodecNames[c] + "\"",
+                     t.codecs[c]);
+    }
+
+    appendHeader(out, "compressor_cache_events_total", "counter", "Result cache lookups, evictions and 304 replies.");
+    for (size_t c = 0; c < kCacheEvents; ++c) {
+        appendSample(out, "compressor_cache_events_total", std::string("event=\"") + kCacheEventNames[c] + "\"",
+                     t.cacheEvents[c]);
+    }
+    appendHeader(out, "compressor_cache_bytes", "gauge", "Bytes held by the result cache.");
+    appendSample(out, "compressor_cache_bytes", std::string(),
+                 static_cast<uint64_t>(std::max<int64_t>(0, r.cacheBytes.load(std::memory_order_relaxed))));
+
+    appendHeader(out, "compressor_active_connections", "gauge", "Open HTTP connections.");
+    appendSample(out, "compressor_active_connections", std::string(),
+                 static_cast<uint64_t>(std::max<int64_t>(0, r.connections.load(std::memory_order_relaxed))));
+
+    appendHeader(out, "compressor_threads", "gauge", "Threads by role.");
+    for (size_t p = 0; p < kPools; ++p) {
+        appendSample(out, "compressor_threads", std::string("pool=\"") + kPoolNames[p] + "\"",
+                     static_cast<uint64_t>(std::max<int64_t>(0, r.threads[p].load(std::memory_order_relaxed))));
+    }
+    return out;
+}
@@ -20,17 +20,21 @@
  * @return The compressed data as a vector of chars
  */
 std::vector<char> RLECompression::compress(const std::vector<char>& data) {
+    return compress(data.data(), data.size());
+}
+
+std::vector<char> RLECompression::compress(const char* data, size_t len) {
     std::vector<char> out;
-    if (data.empty()) {
+    if (len == 0) {
         return out;
     }
 
-    out.reserve(data.size()); // best-effort (may grow if many short runs)
+    out.reserve(len); // best-effort (may grow if many short runs)
 
     char current = data[0];
     unsigned int run = 1;
 
-    for (size_t i = 1; i < data.size(); ++i) {
+    for (size_t i = 1; i < len; ++i) {
         if (data[i] == current && run < 255) {
             ++run;
             continue;
@@ -71,17 +75,21 @@ std::vector<char> RLECompression::compress(const std::vector<char>& data) {
  * @throws std::runtime_error if data is malformed (odd length or zero count)
  */
 std::vector<char> RLECompression::decompress(const std::vector<char>& data) {
+    return decompress(data.data(), data.size());
+}
+
+std::vector<char> RLECompression::decompress(const char* data, size_t len) {
     std::vector<char> out;
-    if (data.empty()) {
+    if (len == 0) {
         return out;
     }
-    if ((data.size() % 2) != 0) {
+    if ((len % 2) != 0) {
         throw std::runtime_error("RLECompression::decompress: malformed input (odd length)");
     }
 
     // conservative reserve: cannot know exact size cheaply without a pre-pass, so do a quick one
     size_t total = 0;
-    for (size_t i = 1; i < data.size(); i += 2) {
+    for (size_t i = 1; i < len; i += 2) {
         unsigned char count = static_cast<unsigned char>(data[i]);
         if (count == 0) {
             throw std::runtime_error("RLECompression::decompress: malformed input (zero count)");
@@ -90,7 +98,7 @@ std::vector<char> RLECompression::decompress(const std::vector<char>& data) {
     }
     out.reserve(total);
 
-    for (size_t i = 0; i < data.size(); i += 2) {
+    for (size_t i = 0; i < len; i += 2) {
         char value = data[i];
         unsigned char count = static_cast<unsigned char>(data[i + 1]);
         if (count == 0) {
@@ -0,0 +1,89 @@
+#include "RequestTrace.h"
+
+#include <cstdio>
+
+thread_local RequestTrace* RequestTrace::installed = nullptr;
+
+namespace {
+constexpr size_t kPhases = static_cast<size_t>(RequestTrace::Phase::Count);
+
+void appendDuration(std::string& out, RequestTrace::Clock::duration elapsed, double unitsPerSecond) {
+    char text[32];
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    std::snprintf(text, sizeof text, "%.3f", seconds * unitsPerSecond);
+    out += text;
+}
+
+void appendJsonString(std::string& out, const std::string& s) {
+    out += '"';
+    for (const char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof escaped, "\\u%04x", static_cast<unsigned>(c));
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+} // namespace
+
+RequestTrace::RequestTrace() : started(Clock::now()) {}
+
+RequestTrace::Clock::duration RequestTrace::total() const {
+    return Clock::now() - started;
+}
+
+const char* RequestTrace::name(Phase phase) {
+    switch (phase) {
+    case Phase::Recv: return "recv";
+    case Phase::Parse: return "parse";
+    case Phase::Body: return "body";
+    case Phase::Queue: return "queue";
+    case Phase::Hash: return "hash";
+    case Phase::Decide: return "decide";
+    case Phase::Codec: return "codec";
+    case Phase::Send: return "send";
+    case Phase::Count: break;
+    }
+    return "unknown";
+}
+
+std::string RequestTrace::serverTiming() const {
+    std::string out;
+    for (size_t i = 0; i < kPhases; ++i) {
+        if (phases[i] == Clock::duration::zero()) continue;
+        out += name(static_cast<Phase>(i));
+        out += ";dur=";
+        appendDuration(out, phases[i], 1e3);
+        out += ", ";
+    }
+    out += "total;dur=";
+    appendDuration(out, total(), 1e3);
+    return out;
+}
+
+std::string RequestTrace::json(const std::string& method, const std::string& path, int status, size_t bytesIn,
+                               size_t bytesOut) const {
+    std::string out = "{\"method\":";
+    appendJsonString(out, method);
+    out += ",\"path\":";
+    appendJsonString(out, path);
+    out += ",\"status\":" + std::to_string(status);
+    out += ",\"bytes_in\":" + std::to_string(bytesIn);
+    out += ",\"bytes_out\":" + std::to_string(bytesOut);
+    for (size_t i = 0; i < kPhases; ++i) {
+        out += ",\"";
+        out += name(static_cast<Phase>(i));
+        out += "_us\":";
+        appendDuration(out, phases[i], 1e6);
+    }
+    out += ",\"total_us\":";
+    appendDuration(out, total(), 1e6);
+    out += '}';
+    return out;
+}
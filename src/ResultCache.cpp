@@ -0,0 +1,171 @@
+#include "ResultCache.h"
+
+#include "Metrics.h"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+
+namespace {
+inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t load64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v)); // unaligned-safe; compiles to a plain load
+    return v;
+}
+
+inline void sipRound(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) {
+    v0 += v1;
+    v1 = rotl64(v1, 13);
+    v1 ^= v0;
+    v0 = rotl64(v0, 32);
+    v2 += v3;
+    v3 = rotl64(v3, 16);
+    v3 ^= v2;
+    v0 += v3;
+    v3 = rotl64(v3, 21);
+    v3 ^= v0;
+    v2 += v1;
+    v1 = rotl64(v1, 17);
+    v1 ^= v2;
+    v2 = rotl64(v2, 32);
+}
+
+// Random per process, so nobody outside can compute keys (and so craft collisions).
+ResultCache::Key processSecret() {
+    static const ResultCache::Key secret = [] {
+        std::random_device rd;
+        ResultCache::Key k;
+        k.hi = (static_cast<uint64_t>(rd()) << 32) ^ rd();
+        k.lo = (static_cast<uint64_t>(rd()) << 32) ^ rd();
+        k.lo ^= static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        return k;
+    }();
+    return secret;
+}
+} // namespace
+
+std::string ResultCache::Key::hex() const {
+    static const char digits[] = "0123456789abcdef";
+    std::string out(32, '0');
+    for (int i = 0; i < 16; ++i) {
+        out[15 - i] = digits[(hi >> (4 * i)) & 0xf];
+        out[31 - i] = digits[(lo >> (4 * i)) & 0xf];
+    }
+    return out;
+}
+
+ResultCache::ResultCache(size_t maxBytes) : shardBudget(maxBytes / kShards) {}
+
+ResultCache::~ResultCache() {
+    Metrics::addCacheBytes(-static_cast<long long>(bytes()));
+}
+
+// SipHash-2-4 with 128-bit output (Aumasson & Bernstein), little-endian word reads.
+ResultCache::Key ResultCache::keyedHash(const Key& secret, const char* data, size_t len) {
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+    const uint64_t k0 = secret.hi;
+    const uint64_t k1 = secret.lo;
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1 ^ 0xee;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+    const size_t whole = len - len % 8;
+    for (size_t i = 0; i < whole; i += 8) {
+        const uint64_t m = load64(in + i);
+        v3 ^= m;
+        sipRound(v0, v1, v2, v3);
+        sipRound(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+    uint64_t b = static_cast<uint64_t>(len) << 56;
+    for (size_t i = 0; i < len % 8; ++i) {
+        b |= static_cast<uint64_t>(in[whole + i]) << (8 * i);
+    }
+    v3 ^= b;
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+    v0 ^= b;
+
+    Key out;
+    v2 ^= 0xee;
+    for (int i = 0; i < 4; ++i) sipRound(v0, v1, v2, v3);
+    out.hi = v0 ^ v1 ^ v2 ^ v3;
+    v1 ^= 0xdd;
+    for (int i = 0; i < 4; ++i) sipRound(v0, v1, v2, v3);
+    out.lo = v0 ^ v1 ^ v2 ^ v3;
+    return out;
+}
+
+ResultCache::Key ResultCache::keyFor(std::string_view variant, const char* data, size_t len) {
+    // The variant's hash is the key for the body's, so each operation has its own keyed hash.
+    const Key variantKey = keyedHash(processSecret(), variant.data(), variant.size());
+    return keyedHash(variantKey, data, len);
+}
+
+ResultCache::Value ResultCache::get(const Key& key) {
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        Metrics::recordCache(Metrics::CacheEvent::Miss);
+        return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    Metrics::recordCache(Metrics::CacheEvent::Hit);
+    return it->second->value;
+}
+
+ResultCache::Value ResultCache::put(const Key& key, ByteBuffer value) {
+    Value shared = std::make_shared<const ByteBuffer>(value.compact());
+    if (shared->size() > maxValueBytes()) {
+        return shared;
+    }
+    const size_t cost = costOf(shared);
+
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        shard.bytes -= costOf(it->second->value);
+        Metrics::addCacheBytes(-static_cast<long long>(costOf(it->second->value)));
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+    while (!shard.lru.empty() && shard.bytes + cost > shardBudget) {
+        const Entry& victim = shard.lru.back();
+        const size_t victimCost = costOf(victim.value);
+        shard.bytes -= victimCost;
+        Metrics::addCacheBytes(-static_cast<long long>(victimCost));
+        Metrics::recordCache(Metrics::CacheEvent::Eviction);
+        shard.index.erase(victim.key);
+        shard.lru.pop_back();
+    }
+    shard.lru.push_front(Entry{key, shared});
+    shard.index.emplace(key, shard.lru.begin());
+    shard.bytes += cost;
+    Metrics::addCacheBytes(static_cast<long long>(cost));
+    return shared;
+}
+
+size_t ResultCache::bytes() const {
+    size_t total = 0;
+    for (const Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        total += shard.bytes;
+    }
+    return total;
+}
+
+size_t ResultCache::entries() const {
+    size_t total = 0;
+    for (const Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        total += shard.lru.size();
+    }
+    return total;
+}
@@ -1,4 +1,6 @@
 #include "Server.h"
+#include "RLECompression.h"
+#include "SocketIo.h"
 #include <iostream>
 #include <netinet/in.h>
 #include <unistd.h>
@@ -6,6 +8,7 @@
 #include <sys/socket.h>
 #include <cerrno>
 #include <stdexcept>
+#include <vector>
 
 #include "platform/socket_init.h"
 
@@ -18,13 +21,29 @@ void defaultEchoHandler(int clientSock) {
     }
     ::close(clientSock);
 }
+
+// Reads until the peer half-closes; false on socket error.
+bool readToEof(int clientSock, std::vector<char>& out) {
+    char buf[4096];
+    while (true) {
+        ssize_t n = ::recv(clientSock, buf, sizeof(buf), 0);
+        if (n > 0) {
+            out.insert(out.end(), buf, buf + n);
+            continue;
+        }
+        if (n == 0) return true;
+        if (errno == EINTR) continue;
+        return false;
+    }
+}
 } // namespace
 
 /**
  * Server constructor - Initialize member variables
  * This is already implemented for you.
  */
-Server::Server(int port) : port(port), serverSocket(-1), running(false) {}
+Server::Server(int port, const SocketOptions& options)
+    : port(port), options(options), running(false) {}
 
 /**
  * Server destructor - Clean up resources
@@ -42,10 +61,8 @@ Server::~Server() {
  * 
  * Important considerations:
  * - Check if already running (return early if so)
- * - Create a TCP socket using socket(AF_INET, SOCK_STREAM, 0)
- * - Set SO_REUSEADDR socket option to allow quick restart
- * - Bind socket to INADDR_ANY on the specified port
- * - Start listening with a reasonable backlog (e.g., 8)
+ * - Create, tune, bind and listen via SocketSetup::openListeners (TCP and/or a Unix
+ *   socket, with SocketOptions: SO_REUSEADDR, backlog, defer-accept, fastopen, buffer sizes)
  * - Set running flag to true
  * - Start acceptLoop in a separate thread (use std::thread)
  * - Throw std::runtime_error with descriptive message on failure
@@ -60,43 +77,7 @@ void Server::start() {
         return;
     }
 
-    ensure_socket_init();
-
-    serverSocket = ::socket(AF_INET, SOCK_STREAM, 0);
-    if (serverSocket < 0) {
-        throw std::runtime_error(std::string("Server::start: socket() failed: ") + std::strerror(errno));
-    }
-
-    int opt = 1;
-#ifdef _WIN32
-    const char* optPtr = reinterpret_cast<const char*>(&opt);
-    const int optLen = static_cast<int>(sizeof(opt));
-#else
-    const void* optPtr = &opt;
-    const socklen_t optLen = static_cast<socklen_t>(sizeof(opt));
-#endif
-    if (::setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, optPtr, optLen) < 0) {
-        ::close(serverSocket);
-        serverSocket = -1;
-        throw std::runtime_error(std::string("Server::start: setsockopt(SO_REUSEADDR) failed: ") + std::strerror(errno));
-    }
-
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(static_cast<uint16_t>(port));
-
-    if (::bind(serverSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
-        ::close(serverSocket);
-        serverSocket = -1;
-        throw std::runtime_error(std::string("Server::start: bind() failed: ") + std::strerror(errno));
-    }
-
-    if (::listen(serverSocket, 8) < 0) {
-        ::close(serverSocket);
-        serverSocket = -1;
-        throw std::runtime_error(std::string("Server::start: listen() failed: ") + std::strerror(errno));
-    }
+    listeners = SocketSetup::openListeners(port, options, "Server::start");
 
     running = true;
     serverThread = std::thread(&Server::acceptLoop, this);
@@ -110,11 +91,8 @@ void Server::start() {
  * Important considerations:
  * - Check if server is running (return early if not)
  * - Set running flag to false to signal threads to stop
- * - Shutdown and close the server socket
  * - Wait for serverThread to finish (use join() if joinable)
- * - Reset serverSocket to -1
- * 
- * Hint: Use shutdown(serverSocket, SHUT_RDWR) before close()
+ * - Shutdown and close the listening sockets (SocketSetup::closeListeners)
  * 
  * @return void
  */
@@ -125,15 +103,12 @@ void Server::stop() {
 
     running = false;
 
-    if (serverSocket >= 0) {
-        (void)::shutdown(serverSocket, SHUT_RDWR);
-        ::close(serverSocket);
-        serverSocket = -1;
-    }
-
+    // The accept loop polls with a timeout, so it notices `running` without the sockets
+    // being closed underneath it; close them only once it has exited.
     if (serverThread.joinable()) {
         serverThread.join();
     }
+    SocketSetup::closeListeners(listeners, options);
 }
 
 /**
@@ -171,6 +146,37 @@ void Server::setHandler(std::function<void(int)> handler) {
     clientHandler = handler;
 }
 
+std::function<void(int)> Server::makeRelayHandler() {
+    return [](int clientSock) {
+        (void)SocketIo::relay(clientSock, clientSock);
+        ::close(clientSock);
+    };
+}
+
+std::function<void(int)> Server::makeDecompressHandler() {
+    return [](int clientSock) {
+        char tag = 0;
+        if (SocketIo::recvExact(clientSock, &tag, 1)) {
+            if (tag == 'I') {
+                // Identity payload: the stream after the tag already is the original data.
+                (void)SocketIo::relay(clientSock, clientSock);
+            } else if (tag == 'R') {
+                std::vector<char> payload;
+                if (readToEof(clientSock, payload)) {
+                    try {
+                        RLECompression rle;
+                        const auto out = rle.decompress(payload);
+                        (void)SocketIo::sendAll(clientSock, out.data(), out.size());
+                    } catch (const std::exception&) {
+                        // malformed RLE payload: close without a response
+                    }
+                }
+            }
+        }
+        ::close(clientSock);
+    };
+}
+
 /**
  * TODO: Implement accept loop for incoming connections
  * 
@@ -178,7 +184,7 @@ void Server::setHandler(std::function<void(int)> handler) {
  * 
  * Important considerations:
  * - Loop while running flag is true
- * - Use accept() to wait for and accept new client connections
+ * - Use SocketSetup::acceptAny() to wait (bounded) for and accept new client connections
  * - Handle accept() errors appropriately (check running flag)
  * - For each accepted connection, create a new detached thread to handle the client
  * - Use std::thread with handleClient method
@@ -191,7 +197,7 @@ void Server::setHandler(std::function<void(int)> handler) {
  */
 void Server::acceptLoop() {
     while (running) {
-        int clientSock = ::accept(serverSocket, nullptr, nullptr);
+        int clientSock = SocketSetup::acceptAny(listeners, options);
         if (clientSock < 0) {
             if (!running) {
                 break;
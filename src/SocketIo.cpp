@@ -0,0 +1,350 @@
+#include "SocketIo.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#  define poll WSAPoll
+#else
+#  include <poll.h>
+#  include <sys/time.h>
+#  include <sys/uio.h>
+#endif
+
+#if defined(__linux__)
+#  include <fcntl.h>
+#  include <signal.h>
+#  include <sys/sendfile.h>
+#elif defined(__APPLE__)
+#  include <sys/types.h>
+#  include <sys/uio.h>
+#elif defined(_WIN32)
+#  include <io.h>
+#endif
+
+namespace {
+// Writing to a socket the peer already closed must surface as an error, not kill the process.
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+constexpr size_t kCopyChunk = 64 * 1024;
+
+#if defined(__linux__)
+/**
+ * sendfile()/splice() have no MSG_NOSIGNAL equivalent. Block SIGPIPE on this thread for the
+ * duration of the call and swallow any SIGPIPE it raised, so the caller just sees EPIPE.
+ */
+class SigpipeGuard {
+public:
+    SigpipeGuard() {
+        sigemptyset(&pipeMask);
+        sigaddset(&pipeMask, SIGPIPE);
+        sigset_t pending;
+        sigpending(&pending);
+        wasPending = sigismember(&pending, SIGPIPE) == 1;
+        blocked = pthread_sigmask(SIG_BLOCK, &pipeMask, &oldMask) == 0;
+    }
+    ~SigpipeGuard() {
+        if (!blocked) return;
+        if (!wasPending) {
+            const timespec zero{0, 0};
+            while (sigtimedwait(&pipeMask, nullptr, &zero) > 0) {
+            }
+        }
+        pthread_sigmask(SIG_SETMASK, &oldMask, nullptr);
+    }
+
+private:
+    sigset_t pipeMask{};
+    sigset_t oldMask{};
+    bool wasPending = false;
+    bool blocked = false;
+};
+#endif
+
+// Portable fallback for relay(): read into a bounce buffer, then write it all out.
+long long copyLoop(int inFd, int outFd, size_t maxBytes) {
+    char buf[kCopyChunk];
+    long long total = 0;
+    size_t remaining = maxBytes;
+    while (remaining > 0) {
+        const size_t want = std::min(sizeof(buf), remaining);
+#ifdef _WIN32
+        ssize_t n = ::recv(inFd, buf, static_cast<int>(want), 0);
+#else
+        ssize_t n = ::read(inFd, buf, want);
+#endif
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+#ifdef _WIN32
+        if (!SocketIo::sendAll(outFd, buf, static_cast<size_t>(n))) return -1;
+#else
+        size_t off = 0;
+        while (off < static_cast<size_t>(n)) {
+            ssize_t w = ::send(outFd, buf + off, static_cast<size_t>(n) - off, kSendFlags);
+            if (w < 0 && errno == ENOTSOCK) {
+                w = ::write(outFd, buf + off, static_cast<size_t>(n) - off);
+            }
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) return -1;
+            off += static_cast<size_t>(w);
+        }
+#endif
+        total += n;
+        remaining -= static_cast<size_t>(n);
+    }
+    return total;
+}
+} // namespace
+
+bool SocketIo::sendAll(int sock, const char* data, size_t len) {
+    size_t off = 0;
+    while (off < len) {
+        // Winsock send() takes an int length; POSIX takes size_t. Cast safely.
+        const int chunk = static_cast<int>(std::min(len - off, static_cast<size_t>(INT_MAX)));
+        ssize_t n = ::send(sock, data + off, chunk, kSendFlags);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool SocketIo::recvExact(int sock, char* data, size_t len) {
+    size_t off = 0;
+    while (off < len) {
+        const int chunk = static_cast<int>(std::min(len - off, static_cast<size_t>(INT_MAX)));
+        ssize_t n = ::recv(sock, data + off, chunk, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool SocketIo::waitReadable(int sock, int timeoutMs) {
+    while (true) {
+        pollfd pfd{};
+        pfd.fd = sock;
+        pfd.events = POLLIN;
+        const int rc = ::poll(&pfd, 1, timeoutMs);
+        if (rc < 0 && errno == EINTR) continue;
+        return rc > 0;
+    }
+}
+
+#ifndef _WIN32
+namespace {
+// Resumable iovec walk shared by sendv()/recvv(): issues one sendmsg/recvmsg per batch
+// of up to 64 segments and advances past whatever the kernel transferred.
+template <typename SliceT, typename Op>
+bool transferv(const SliceT* slices, size_t count, Op op) {
+    constexpr size_t kMaxIov = 64;
+    size_t idx = 0;
+    size_t offsetInSlice = 0;
+    iovec iov[kMaxIov];
+    while (idx < count) {
+        size_t n = 0;
+        for (size_t i = idx; i < count && n < kMaxIov; ++i) {
+            const size_t skip = (i == idx) ? offsetInSlice : 0;
+            if (slices[i].size == skip) continue;
+            iov[n].iov_base = const_cast<char*>(slices[i].data) + skip;
+            iov[n].iov_len = slices[i].size - skip;
+            ++n;
+        }
+        if (n == 0) return true;
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n;
+        ssize_t done = op(&msg);
+        if (done < 0 && errno == EINTR) continue;
+        if (done <= 0) return false;
+
+        size_t left = static_cast<size_t>(done);
+        while (idx < count && left > 0) {
+            const size_t avail = slices[idx].size - offsetInSlice;
+            if (left < avail) {
+                offsetInSlice += left;
+                left = 0;
+            } else {
+                left -= avail;
+                ++idx;
+                offsetInSlice = 0;
+            }
+        }
+        while (idx < count && slices[idx].size == offsetInSlice) {
+            ++idx;
+            offsetInSlice = 0;
+        }
+    }
+    return true;
+}
+} // namespace
+#endif
+
+bool SocketIo::sendv(int sock, const ConstSlice* slices, size_t count) {
+#ifdef _WIN32
+    for (size_t i = 0; i < count; ++i) {
+        if (!sendAll(sock, slices[i].data, slices[i].size)) return false;
+    }
+    return true;
+#else
+    return transferv(slices, count, [sock](msghdr* msg) { return ::sendmsg(sock, msg, kSendFlags); });
+#endif
+}
+
+bool SocketIo::recvv(int sock, const Slice* slices, size_t count) {
+#ifdef _WIN32
+    for (size_t i = 0; i < count; ++i) {
+        if (!recvExact(sock, slices[i].data, slices[i].size)) return false;
+    }
+    return true;
+#else
+    return transferv(slices, count, [sock](msghdr* msg) { return ::recvmsg(sock, msg, MSG_WAITALL); });
+#endif
+}
+
+bool SocketIo::setBufferSizes(int sock, int receiveBytes, int sendBytes) {
+    bool ok = true;
+#ifdef _WIN32
+    using OptPtr = const char*;
+#else
+    using OptPtr = const void*;
+#endif
+    if (receiveBytes > 0) {
+        ok = ::setsockopt(sock, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<OptPtr>(&receiveBytes),
+                          sizeof(receiveBytes)) == 0 && ok;
+    }
+    if (sendBytes > 0) {
+        ok = ::setsockopt(sock, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<OptPtr>(&sendBytes),
+                          sizeof(sendBytes)) == 0 && ok;
+    }
+    return ok;
+}
+
+bool SocketIo::setTimeouts(int sock, int receiveMs, int sendMs) {
+    bool ok = true;
+    const auto apply = [sock](int option, int ms) {
+#ifdef _WIN32
+        const DWORD value = static_cast<DWORD>(ms);
+        return ::setsockopt(sock, SOL_SOCKET, option, reinterpret_cast<const char*>(&value), sizeof(value)) == 0;
+#else
+        timeval tv{};
+        tv.tv_sec = ms / 1000;
+        tv.tv_usec = (ms % 1000) * 1000;
+        return ::setsockopt(sock, SOL_SOCKET, option, &tv, sizeof(tv)) == 0;
+#endif
+    };
+    if (receiveMs > 0) ok = apply(SO_RCVTIMEO, receiveMs) && ok;
+    if (sendMs > 0) ok = apply(SO_SNDTIMEO, sendMs) && ok;
+    return ok;
+}
+
+bool SocketIo::lastErrorWasTimeout() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAETIMEDOUT;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+bool SocketIo::sendFile(int sock, int fd, size_t offset, size_t count) {
+#if defined(__linux__)
+    SigpipeGuard guard;
+    off_t off = static_cast<off_t>(offset);
+    size_t remaining = count;
+    while (remaining > 0) {
+        ssize_t n = ::sendfile(sock, fd, &off, std::min(remaining, static_cast<size_t>(INT_MAX)));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        remaining -= static_cast<size_t>(n);
+    }
+    return true;
+#elif defined(__APPLE__)
+    off_t off = static_cast<off_t>(offset);
+    size_t remaining = count;
+    while (remaining > 0) {
+        off_t len = static_cast<off_t>(remaining);
+        const int rc = ::sendfile(fd, sock, off, &len, nullptr, 0);
+        if (rc < 0 && errno != EINTR && errno != EAGAIN) return false;
+        if (rc == 0 && len == 0) return false; // unexpected EOF on the file
+        off += len;
+        remaining -= static_cast<size_t>(len);
+    }
+    return true;
+#else
+    char buf[kCopyChunk];
+    size_t remaining = count;
+    long long off = static_cast<long long>(offset);
+    while (remaining > 0) {
+        const size_t want = std::min(sizeof(buf), remaining);
+#  ifdef _WIN32
+        if (_lseeki64(fd, off, SEEK_SET) < 0) return false;
+        const int n = _read(fd, buf, static_cast<unsigned int>(want));
+#  else
+        const ssize_t n = ::pread(fd, buf, want, static_cast<off_t>(off));
+#  endif
+        if (n <= 0) return false;
+        if (!sendAll(sock, buf, static_cast<size_t>(n))) return false;
+        off += n;
+        remaining -= static_cast<size_t>(n);
+    }
+    return true;
+#endif
+}
+
+long long SocketIo::relay(int inFd, int outFd, size_t maxBytes) {
+#if defined(__linux__)
+    int pipeFds[2];
+    if (::pipe2(pipeFds, O_CLOEXEC) < 0) {
+        return copyLoop(inFd, outFd, maxBytes);
+    }
+    SigpipeGuard guard;
+    long long total = 0;
+    size_t remaining = maxBytes;
+    bool failed = false;
+    while (remaining > 0) {
+        ssize_t in = ::splice(inFd, nullptr, pipeFds[1], nullptr, std::min(remaining, kCopyChunk),
+                              SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (in < 0 && errno == EINTR) continue;
+        if (in < 0 && errno == EINVAL && total == 0) {
+            // Neither end supports splicing (e.g. some special files): copy instead.
+            ::close(pipeFds[0]);
+            ::close(pipeFds[1]);
+            return copyLoop(inFd, outFd, maxBytes);
+        }
+        if (in < 0) {
+            failed = true;
+            break;
+        }
+        if (in == 0) break; // EOF
+        size_t pending = static_cast<size_t>(in);
+        while (pending > 0) {
+            ssize_t out = ::splice(pipeFds[0], nullptr, outFd, nullptr, pending, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (out < 0 && errno == EINTR) continue;
+            if (out <= 0) {
+                failed = true;
+                break;
+            }
+            pending -= static_cast<size_t>(out);
+        }
+        if (failed) break;
+        total += in;
+        remaining -= static_cast<size_t>(in);
+    }
+    ::close(pipeFds[0]);
+    ::close(pipeFds[1]);
+    return failed ? -1 : total;
+#else
+    return copyLoop(inFd, outFd, maxBytes);
+#endif
+}
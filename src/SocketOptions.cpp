@@ -0,0 +1,276 @@
+#include "SocketOptions.h"
+#include "SocketIo.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#  define poll WSAPoll
+#else
+#  include <fcntl.h>
+#  include <netinet/tcp.h>
+#  include <poll.h>
+#  include <sys/stat.h>
+#  include <sys/un.h>
+#endif
+
+#include "platform/socket_init.h"
+
+namespace {
+bool setIntOption(int sock, int level, int name, int value) {
+#ifdef _WIN32
+    const char* optPtr = reinterpret_cast<const char*>(&value);
+    const int optLen = static_cast<int>(sizeof(value));
+#else
+    const void* optPtr = &value;
+    const socklen_t optLen = static_cast<socklen_t>(sizeof(value));
+#endif
+    return ::setsockopt(sock, level, name, optPtr, optLen) == 0;
+}
+
+[[noreturn]] void failListener(int& sock, const std::string& what) {
+    const std::string reason = std::strerror(errno);
+    ::close(sock);
+    sock = -1;
+    throw std::runtime_error(what + " failed: " + reason);
+}
+
+// Long enough that an idle accept loop costs nothing, short enough that stop() is prompt.
+constexpr int kAcceptPollMs = 200;
+
+#ifndef _WIN32
+bool isAbstract(const std::string& path) {
+    return !path.empty() && path[0] == '@';
+}
+
+// Fills `addr` for `path`; abstract names map '@' to the leading NUL byte.
+bool fillUnixAddress(const std::string& path, sockaddr_un& addr, socklen_t& len) {
+    addr = sockaddr_un{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.data(), path.size());
+    if (isAbstract(path)) {
+#  ifdef __linux__
+        addr.sun_path[0] = '\0';
+#  else
+        return false;
+#  endif
+    }
+    len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size() + (isAbstract(path) ? 0 : 1));
+    return true;
+}
+#endif
+} // namespace
+
+std::vector<int> SocketSetup::openListeners(int port, const SocketOptions& options, const std::string& who) {
+    std::vector<int> listeners;
+    if (options.tcpEnabled) {
+        listeners.push_back(openTcpListener(port, options, who));
+    }
+    if (!options.unixPath.empty()) {
+        try {
+            listeners.push_back(openUnixListener(options.unixPath, options, who));
+        } catch (...) {
+            closeListeners(listeners, SocketOptions());
+            throw;
+        }
+    }
+    if (listeners.empty()) {
+        throw std::runtime_error(who + ": no listener configured (TCP disabled and no Unix socket path)");
+    }
+    return listeners;
+}
+
+void SocketSetup::closeListeners(std::vector<int>& listeners, const SocketOptions& options) {
+    for (int sock : listeners) {
+        (void)::shutdown(sock, SHUT_RDWR);
+        ::close(sock);
+    }
+    listeners.clear();
+#ifndef _WIN32
+    if (!options.unixPath.empty() && !isAbstract(options.unixPath)) {
+        (void)::unlink(options.unixPath.c_str());
+    }
+#endif
+}
+
+int SocketSetup::acceptAny(const std::vector<int>& listeners, const SocketOptions& options) {
+    pollfd fds[4];
+    const size_t n = std::min(listeners.size(), sizeof(fds) / sizeof(fds[0]));
+    for (size_t i = 0; i < n; ++i) {
+        fds[i] = pollfd{};
+        fds[i].fd = listeners[i];
+        fds[i].events = POLLIN;
+    }
+    if (::poll(fds, static_cast<unsigned long>(n), kAcceptPollMs) <= 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (fds[i].revents & POLLIN) {
+            return acceptConnection(fds[i].fd, options);
+        }
+    }
+    return -1;
+}
+
+int SocketSetup::openUnixListener(const std::string& path, const SocketOptions& options, const std::string& who) {
+#ifdef _WIN32
+    (void)path;
+    (void)options;
+    throw std::runtime_error(who + ": Unix domain sockets are not supported on this platform");
+#else
+    sockaddr_un addr{};
+    socklen_t addrLen = 0;
+    if (!fillUnixAddress(path, addr, addrLen)) {
+        throw std::runtime_error(who + ": invalid Unix socket path '" + path + "'");
+    }
+
+    int sock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        throw std::runtime_error(who + ": socket(AF_UNIX) failed: " + std::strerror(errno));
+    }
+    (void)::fcntl(sock, F_SETFD, FD_CLOEXEC);
+
+    if (!isAbstract(path)) {
+        // Replace a stale socket left by a previous run, but never clobber other file types.
+        struct stat st {};
+        if (::lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+            (void)::unlink(path.c_str());
+        }
+    }
+    if (::bind(sock, reinterpret_cast<sockaddr*>(&addr), addrLen) < 0) {
+        failListener(sock, who + ": bind(" + path + ")");
+    }
+    if (!isAbstract(path) && ::chmod(path.c_str(), static_cast<mode_t>(options.unixMode)) < 0) {
+        const int err = errno;
+        (void)::unlink(path.c_str());
+        errno = err;
+        failListener(sock, who + ": chmod(" + path + ")");
+    }
+    if (::listen(sock, options.backlog > 0 ? options.backlog : SOMAXCONN) < 0) {
+        const int err = errno;
+        if (!isAbstract(path)) (void)::unlink(path.c_str());
+        errno = err;
+        failListener(sock, who + ": listen()");
+    }
+    return sock;
+#endif
+}
+
+int SocketSetup::connectUnix(const std::string& path, const SocketOptions& options) {
+#ifdef _WIN32
+    (void)path;
+    (void)options;
+    return -1;
+#else
+    sockaddr_un addr{};
+    socklen_t addrLen = 0;
+    if (!fillUnixAddress(path, addr, addrLen)) {
+        return -1;
+    }
+    int sock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return -1;
+    }
+    (void)::fcntl(sock, F_SETFD, FD_CLOEXEC);
+    (void)SocketIo::setBufferSizes(sock, options.receiveBufferBytes, options.sendBufferBytes);
+    if (::connect(sock, reinterpret_cast<sockaddr*>(&addr), addrLen) < 0) {
+        ::close(sock);
+        return -1;
+    }
+    return sock;
+#endif
+}
+
+int SocketSetup::openTcpListener(int port, const SocketOptions& options, const std::string& who) {
+    ensure_socket_init();
+
+    int sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        throw std::runtime_error(who + ": socket() failed: " + std::strerror(errno));
+    }
+#ifndef _WIN32
+    (void)::fcntl(sock, F_SETFD, FD_CLOEXEC);
+#endif
+
+    if (options.reuseAddress && !setIntOption(sock, SOL_SOCKET, SO_REUSEADDR, 1)) {
+        failListener(sock, who + ": setsockopt(SO_REUSEADDR)");
+    }
+    // Buffer sizes are inherited by accepted sockets and must be set before listen()
+    // for the TCP window scale to take them into account.
+    (void)SocketIo::setBufferSizes(sock, options.receiveBufferBytes, options.sendBufferBytes);
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+
+    if (::bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        failListener(sock, who + ": bind()");
+    }
+
+#if defined(TCP_DEFER_ACCEPT)
+    if (options.deferAcceptSeconds > 0) {
+        (void)setIntOption(sock, IPPROTO_TCP, TCP_DEFER_ACCEPT, options.deferAcceptSeconds);
+    }
+#endif
+#if defined(TCP_FASTOPEN)
+    if (options.fastOpenQueue > 0) {
+        (void)setIntOption(sock, IPPROTO_TCP, TCP_FASTOPEN, options.fastOpenQueue);
+    }
+#endif
+
+    if (::listen(sock, options.backlog > 0 ? options.backlog : SOMAXCONN) < 0) {
+        failListener(sock, who + ": listen()");
+    }
+    return sock;
+}
+
+int SocketSetup::acceptConnection(int listenSocket, const SocketOptions& options) {
+#if defined(__linux__)
+    int flags = 0;
+    if (options.closeOnExec) flags |= SOCK_CLOEXEC;
+    if (options.nonBlockingAccept) flags |= SOCK_NONBLOCK;
+    int sock = ::accept4(listenSocket, nullptr, nullptr, flags);
+#else
+    int sock = static_cast<int>(::accept(listenSocket, nullptr, nullptr));
+#  ifndef _WIN32
+    if (sock >= 0 && options.closeOnExec) {
+        (void)::fcntl(sock, F_SETFD, FD_CLOEXEC);
+    }
+    if (sock >= 0 && options.nonBlockingAccept) {
+        (void)::fcntl(sock, F_SETFL, ::fcntl(sock, F_GETFL) | O_NONBLOCK);
+    }
+#  endif
+#endif
+    if (sock >= 0) {
+        applyConnectionOptions(sock, options);
+    }
+    return sock;
+}
+
+void SocketSetup::applyConnectionOptions(int sock, const SocketOptions& options) {
+    if (options.noDelay) {
+        (void)setIntOption(sock, IPPROTO_TCP, TCP_NODELAY, 1);
+    }
+    if (options.keepAlive) {
+        (void)setIntOption(sock, SOL_SOCKET, SO_KEEPALIVE, 1);
+        if (options.keepAliveIdleSeconds > 0) {
+#if defined(TCP_KEEPIDLE)
+            (void)setIntOption(sock, IPPROTO_TCP, TCP_KEEPIDLE, options.keepAliveIdleSeconds);
+#elif defined(TCP_KEEPALIVE)
+            (void)setIntOption(sock, IPPROTO_TCP, TCP_KEEPALIVE, options.keepAliveIdleSeconds);
+#endif
+        }
+    }
+    (void)SocketIo::setBufferSizes(sock, options.receiveBufferBytes, options.sendBufferBytes);
+}
@@ -0,0 +1,146 @@
+#include "SpoolFile.h"
+#include "SocketIo.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#  include <fcntl.h>
+#  include <io.h>
+#  include <stdio.h>
+#  include <sys/stat.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+namespace {
+std::string defaultDirectory() {
+#ifdef _WIN32
+    if (const char* tmp = std::getenv("TEMP")) return tmp;
+    return ".";
+#else
+    if (const char* tmp = std::getenv("TMPDIR")) {
+        if (*tmp) return tmp;
+    }
+    return "/tmp";
+#endif
+}
+
+std::runtime_error spoolError(const std::string& what) {
+    return std::runtime_error("SpoolFile::" + what + ": " + std::strerror(errno));
+}
+} // namespace
+
+std::shared_ptr<SpoolFile> SpoolFile::create(const std::string& dir) {
+    const std::string where = dir.empty() ? defaultDirectory() : dir;
+#ifdef _WIN32
+    // _O_TEMPORARY: deleted when the last descriptor closes.
+    char* name = _tempnam(where.c_str(), "spool");
+    if (!name) {
+        throw spoolError("create(" + where + ")");
+    }
+    const int fd = _open(name, _O_CREAT | _O_EXCL | _O_RDWR | _O_BINARY | _O_TEMPORARY, _S_IREAD | _S_IWRITE);
+    std::free(name);
+    if (fd < 0) {
+        throw spoolError("create(" + where + ")");
+    }
+    return std::shared_ptr<SpoolFile>(new SpoolFile(fd));
+#else
+    int fd = -1;
+#  if defined(__linux__) && defined(O_TMPFILE)
+    // Never has a name at all; not every filesystem supports it, hence the fallback.
+    fd = ::open(where.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+#  endif
+    if (fd < 0) {
+        std::string path = where + "/file-compressor-spool-XXXXXX";
+        fd = ::mkstemp(&path[0]);
+        if (fd < 0) {
+            throw spoolError("create(" + where + ")");
+        }
+        ::unlink(path.c_str());
+        (void)::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    return std::shared_ptr<SpoolFile>(new SpoolFile(fd));
+#endif
+}
+
+SpoolFile::~SpoolFile() {
+#ifndef _WIN32
+    if (isMapped && length > 0) {
+        ::munmap(const_cast<char*>(mapped), length);
+    }
+    ::close(descriptor);
+#else
+    _close(descriptor);
+#endif
+}
+
+void SpoolFile::write(const char* data, size_t len) {
+    if (isMapped) {
+        throw std::logic_error("SpoolFile::write after map");
+    }
+    while (len > 0) {
+#ifdef _WIN32
+        const int n = _write(descriptor, data, static_cast<unsigned int>(std::min<size_t>(len, 1u << 30)));
+#else
+        const ssize_t n = ::write(descriptor, data, len);
+        if (n < 0 && errno == EINTR) continue;
+#endif
+        if (n <= 0) {
+            throw spoolError("write");
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+        length += static_cast<size_t>(n);
+    }
+}
+
+size_t SpoolFile::appendFrom(int inFd, size_t count) {
+    if (isMapped) {
+        throw std::logic_error("SpoolFile::appendFrom after map");
+    }
+    const long long moved = SocketIo::relay(inFd, descriptor, count);
+    if (moved < 0) {
+        throw spoolError("appendFrom");
+    }
+    length += static_cast<size_t>(moved);
+    return static_cast<size_t>(moved);
+}
+
+std::string_view SpoolFile::map() {
+    if (isMapped || length == 0) {
+        isMapped = true;
+        return view();
+    }
+#ifdef _WIN32
+    copy.resize(length);
+    if (_lseeki64(descriptor, 0, SEEK_SET) < 0) {
+        throw spoolError("map");
+    }
+    size_t done = 0;
+    while (done < length) {
+        const int n = _read(descriptor, copy.data() + done, static_cast<unsigned int>(std::min<size_t>(length - done, 1u << 30)));
+        if (n <= 0) {
+            throw spoolError("map");
+        }
+        done += static_cast<size_t>(n);
+    }
+    mapped = copy.data();
+#else
+    void* p = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, descriptor, 0);
+    if (p == MAP_FAILED) {
+        throw spoolError("map");
+    }
+#  ifdef MADV_SEQUENTIAL
+    (void)::madvise(p, length, MADV_SEQUENTIAL); // codecs read front to back
+#  endif
+    mapped = static_cast<const char*>(p);
+#endif
+    isMapped = true;
+    return view();
+}
@@ -0,0 +1,183 @@
+#include "StreamCodec.h"
+#include "AdaptiveCompression.h"
+#include "RequestTrace.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void RLEStreamEncoder::write(const char* data, size_t len, const Sink& out) {
+    if (len == 0) {
+        return;
+    }
+    scratch.clear();
+    scratch.reserve(len);
+    for (size_t i = 0; i < len; ++i) {
+        if (hasRun && data[i] == current && run < 255) {
+            ++run;
+            continue;
+        }
+        if (hasRun) {
+            scratch.push_back(current);
+            scratch.push_back(static_cast<char>(static_cast<unsigned char>(run)));
+        }
+        current = data[i];
+        run = 1;
+        hasRun = true;
+    }
+    // The last run stays open: the next write() may extend it.
+    if (!scratch.empty()) {
+        out(scratch.data(), scratch.size());
+    }
+}
+
+void RLEStreamEncoder::finish(const Sink& out) {
+    if (!hasRun) {
+        return;
+    }
+    const char pair[2] = {current, static_cast<char>(static_cast<unsigned char>(run))};
+    hasRun = false;
+    run = 0;
+    out(pair, sizeof(pair));
+}
+
+void RLEStreamDecoder::write(const char* data, size_t len, const Sink& out) {
+    scratch.clear();
+    for (size_t i = 0; i < len; ++i) {
+        if (!haveValue) {
+            value = data[i];
+            haveValue = true;
+            continue;
+        }
+        const unsigned char count = static_cast<unsigned char>(data[i]);
+        if (count == 0) {
+            throw std::runtime_error("RLECompression::decompress: malformed input (zero count)");
+        }
+        scratch.insert(scratch.end(), static_cast<size_t>(count), value);
+        haveValue = false;
+    }
+    if (!scratch.empty()) {
+        out(scratch.data(), scratch.size());
+    }
+}
+
+void RLEStreamDecoder::finish(const Sink&) {
+    if (haveValue) {
+        throw std::runtime_error("RLECompression::decompress: malformed input (odd length)");
+    }
+}
+
+AdaptiveStreamCompressor::AdaptiveStreamCompressor(size_t decisionBytes)
+    : decisionBytes(decisionBytes == 0 ? 1 : decisionBytes), mode(Mode::Deciding) {}
+
+void AdaptiveStreamCompressor::decide(const Sink& out) {
+    bool useRle;
+    {
+        RequestTrace::Timer trialTimer(RequestTrace::Phase::Decide);
+        RLECompression rle;
+        useRle = rle.compress(pending).size() < pending.size();
+    }
+    if (useRle) {
+        mode = Mode::Rle;
+        const char tag = 'R';
+        out(&tag, 1);
+        encoder.write(pending.data(), pending.size(), out);
+    } else {
+        mode = Mode::Identity;
+        const char tag = 'I';
+        out(&tag, 1);
+        out(pending.data(), pending.size());
+    }
+    pending.clear();
+    pending.shrink_to_fit();
+}
+
+void AdaptiveStreamCompressor::write(const char* data, size_t len, const Sink& out) {
+    switch (mode) {
+    case Mode::Deciding: {
+        const size_t take = std::min(len, decisionBytes - pending.size());
+        pending.insert(pending.end(), data, data + take);
+        if (pending.size() < decisionBytes) {
+            return;
+        }
+        decide(out);
+        write(data + take, len - take, out);
+        return;
+    }
+    case Mode::Rle:
+        encoder.write(data, len, out);
+        return;
+    case Mode::Identity:
+        if (len > 0) {
+            out(data, len);
+        }
+        return;
+    }
+}
+
+void AdaptiveStreamCompressor::finish(const Sink& out) {
+    if (mode == Mode::Deciding) {
+        // Short input: identical to the one-shot codec.
+        AdaptiveCompression adaptive;
+        const auto bytes = adaptive.compress(pending);
+        pending.clear();
+        if (!bytes.empty()) {
+            out(bytes.data(), bytes.size());
+        }
+        return;
+    }
+    if (mode == Mode::Rle) {
+        encoder.finish(out);
+    }
+}
+
+TaggedStreamEncoder::TaggedStreamEncoder(char tag, std::unique_ptr<StreamCodec> inner)
+    : tag(tag), inner(std::move(inner)) {}
+
+void TaggedStreamEncoder::write(const char* data, size_t len, const Sink& out) {
+    if (len == 0) {
+        return;
+    }
+    if (!tagWritten) {
+        out(&tag, 1);
+        tagWritten = true;
+    }
+    if (inner) {
+        inner->write(data, len, out);
+    } else {
+        out(data, len);
+    }
+}
+
+void TaggedStreamEncoder::finish(const Sink& out) {
+    if (inner && tagWritten) {
+        inner->finish(out);
+    }
+}
+
+void AdaptiveStreamDecompressor::write(const char* data, size_t len, const Sink& out) {
+    if (len == 0) {
+        return;
+    }
+    if (mode == Mode::NeedTag) {
+        if (data[0] == 'R') {
+            mode = Mode::Rle;
+        } else if (data[0] == 'I') {
+            mode = Mode::Identity;
+        } else {
+            throw std::runtime_error("AdaptiveCompression::decompress: unknown algorithm tag");
+        }
+        ++data;
+        --len;
+    }
+    if (mode == Mode::Rle) {
+        decoder.write(data, len, out);
+    } else if (len > 0) {
+        out(data, len);
+    }
+}
+
+void AdaptiveStreamDecompressor::finish(const Sink& out) {
+    if (mode == Mode::Rle) {
+        decoder.finish(out);
+    }
+}
@@ -0,0 +1,558 @@
+// tcp_bench: connection rate, request latency and MB/s through an in-process Server, swept over
+// client concurrency and payload size for the echo, compression and relay handlers.
+
+#include "AdaptiveCompression.h"
+#include "FrameProtocol.h"
+#include "LatencyHistogram.h"
+#include "Server.h"
+#include "SocketOptions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#  include <arpa/inet.h>
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <netinet/in.h>
+#  include <netinet/tcp.h>
+#  include <poll.h>
+#  include <sys/resource.h>
+#  include <sys/socket.h>
+#  include <unistd.h>
+#endif
+
+#ifndef _WIN32
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+    int port = 9500;
+    std::vector<std::string> handlers{"echo", "compress"};
+    std::vector<size_t> clients{1, 10, 100, 1000};
+    std::vector<size_t> sizes{64, 4096, 65536};
+    bool connectPerRequest = false;
+    size_t threads = 0; // client driver threads; 0 = half the cores
+    double durationSeconds = 2;
+    double warmupSeconds = 0.5;
+    int backlog = 4096;
+    bool noDelay = true;
+    std::string format = "csv";
+};
+
+size_t parseSize(const std::string& s) {
+    size_t used = 0;
+    const unsigned long long n = std::stoull(s, &used);
+    size_t scale = 1;
+    if (used + 1 == s.size()) {
+        switch (s[used]) {
+        case 'K': case 'k': scale = size_t{1} << 10; break;
+        case 'M': case 'm': scale = size_t{1} << 20; break;
+        default: throw std::invalid_argument("bad size '" + s + "'");
+        }
+    } else if (used != s.size()) {
+        throw std::invalid_argument("bad size '" + s + "'");
+    }
+    return static_cast<size_t>(n) * scale;
+}
+
+// Client counts: plain, or with a decimal k suffix (10k = 10000).
+size_t parseCount(const std::string& s) {
+    size_t used = 0;
+    const unsigned long long n = std::stoull(s, &used);
+    if (used == s.size()) return static_cast<size_t>(n);
+    if (used + 1 == s.size() && (s[used] == 'k' || s[used] == 'K')) return static_cast<size_t>(n) * 1000;
+    throw std::invalid_argument("bad count '" + s + "'");
+}
+
+std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> out;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) out.push_back(item);
+    }
+    if (out.empty()) throw std::invalid_argument("empty list");
+    return out;
+}
+
+// RLE-friendly bytes (runs of 1..16), so the compression handler has real work to do.
+std::vector<char> makePayload(size_t size) {
+    std::vector<char> out;
+    out.reserve(size);
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    while (out.size() < size) {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        const uint64_t r = state * 0x2545F4914F6CDD1DULL;
+        out.insert(out.end(), std::min<size_t>(1 + (r & 15), size - out.size()), static_cast<char>('a' + (r >> 59)));
+    }
+    return out;
+}
+
+// "relay" speaks the peer-close protocol (send, half-close, read to EOF), so every request
+// needs its own connection; "echo" and "compress" exchange FrameProtocol frames.
+std::function<void(int)> makeHandler(const std::string& name) {
+    if (name == "echo") {
+        return FrameProtocol::makeHandler([](const std::vector<char>& in) { return in; });
+    }
+    if (name == "compress") {
+        return FrameProtocol::makeHandler([](const std::vector<char>& in) {
+            AdaptiveCompression codec;
+            return codec.compress(in);
+        });
+    }
+    if (name == "relay") {
+        return Server::makeRelayHandler();
+    }
+    throw std::invalid_argument("unknown handler '" + name + "' (expected echo, compress or relay)");
+}
+
+struct Point {
+    std::string handler;
+    bool perRequest;
+    size_t clients;
+    size_t size;
+};
+
+struct Result {
+    LatencyHistogram latency;
+    uint64_t requests = 0;
+    uint64_t connects = 0;
+    uint64_t failures = 0;
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+};
+
+// One simulated client: a non-blocking socket driven through connect -> send -> receive.
+struct Conn {
+    enum class State { Closed, Connecting, Sending, Receiving };
+    int fd = -1;
+    State state = State::Closed;
+    size_t sent = 0;
+    size_t received = 0;
+    size_t expected = 0;      // framed: header + payload length, once the header is in
+    char header[FrameProtocol::kHeaderSize];
+    Clock::time_point started;
+    bool fresh = false;       // connected for this request (counts towards connects)
+};
+
+// Drives `count` clients from one thread with poll(), so 10k clients cost a handful of client
+// threads and the server's thread-per-connection model is what gets measured.
+class Driver {
+public:
+    Driver(const Point& point, const std::vector<char>& request, size_t count, sockaddr_in addr,
+           Clock::time_point measureFrom, Clock::time_point end)
+        : point(point), request(request), conns(count), addr(addr), measureFrom(measureFrom), end(end),
+          framed(point.handler != "relay"), scratch(256 * 1024) {}
+
+    void run(Result& result) {
+        for (Conn& c : conns) begin(c, result);
+        std::vector<pollfd> fds;
+        std::vector<Conn*> owners;
+        while (Clock::now() < end) {
+            fds.clear();
+            owners.clear();
+            for (Conn& c : conns) {
+                if (c.state == Conn::State::Closed) {
+                    begin(c, result); // a failed connect is retried on the next pass
+                    if (c.state == Conn::State::Closed) continue;
+                }
+                pollfd p{};
+                p.fd = c.fd;
+                p.events = c.state == Conn::State::Receiving ? POLLIN : POLLOUT;
+                fds.push_back(p);
+                owners.push_back(&c);
+            }
+            if (fds.empty()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            const int ready = ::poll(fds.data(), fds.size(), 50);
+            if (ready <= 0) continue;
+            for (size_t i = 0; i < fds.size(); ++i) {
+                if (fds[i].revents != 0) step(*owners[i], result);
+            }
+        }
+        for (Conn& c : conns) close(c);
+    }
+
+private:
+    const Point& point;
+    const std::vector<char>& request;
+    std::vector<Conn> conns;
+    sockaddr_in addr;
+    Clock::time_point measureFrom;
+    Clock::time_point end;
+    bool framed;
+    std::vector<char> scratch;
+
+    bool measuring(const Conn& c) const { return c.started >= measureFrom; }
+
+    void close(Conn& c) {
+        if (c.fd >= 0) ::close(c.fd);
+        c.fd = -1;
+        c.state = Conn::State::Closed;
+    }
+
+    void fail(Conn& c, Result& result) {
+        if (measuring(c)) ++result.failures;
+        close(c);
+    }
+
+    // Start the next request: on the open connection, or on a new one.
+    void begin(Conn& c, Result& result) {
+        c.started = Clock::now();
+        c.sent = 0;
+        c.received = 0;
+        c.expected = 0;
+        if (c.fd >= 0) {
+            c.fresh = false;
+            c.state = Conn::State::Sending;
+            return;
+        }
+        c.fresh = true;
+        c.fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (c.fd < 0) {
+            fail(c, result);
+            return;
+        }
+        ::fcntl(c.fd, F_SETFL, ::fcntl(c.fd, F_GETFL, 0) | O_NONBLOCK);
+        const int one = 1;
+        ::setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (::connect(c.fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0) {
+            c.state = Conn::State::Sending;
+        } else if (errno == EINPROGRESS) {
+            c.state = Conn::State::Connecting;
+        } else {
+            fail(c, result);
+        }
+    }
+
+    void finish(Conn& c, Result& result) {
+        if (measuring(c)) {
+            result.latency.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - c.started).count()));
+            ++result.requests;
+            if (c.fresh) ++result.connects;
+            result.bytesSent += request.size();
+            result.bytesReceived += c.received;
+        }
+        if (point.perRequest || !framed) close(c);
+        if (Clock::now() < end) begin(c, result);
+    }
+
+    void step(Conn& c, Result& result) {
+        if (c.state == Conn::State::Connecting) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            ::getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err != 0) {
+                fail(c, result);
+                return;
+            }
+            c.state = Conn::State::Sending;
+        }
+        if (c.state == Conn::State::Sending) {
+            while (c.sent < request.size()) {
+                const ssize_t n = ::send(c.fd, request.data() + c.sent, request.size() - c.sent, MSG_NOSIGNAL);
+                if (n > 0) {
+                    c.sent += static_cast<size_t>(n);
+                } else if (n < 0 && errno == EINTR) {
+                    continue;
+                } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    return;
+                } else {
+                    fail(c, result);
+                    return;
+                }
+            }
+            if (!framed) ::shutdown(c.fd, SHUT_WR);
+            c.state = Conn::State::Receiving;
+            return; // poll for the response
+        }
+        // Receiving.
+        while (true) {
+            size_t want = scratch.size();
+            char* into = scratch.data();
+            if (framed && c.received < FrameProtocol::kHeaderSize) {
+                into = c.header + c.received;
+                want = FrameProtocol::kHeaderSize - c.received;
+            } else if (framed) {
+                want = std::min(want, c.expected - c.received);
+            }
+            const ssize_t n = ::recv(c.fd, into, want, 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            if (n == 0 && !framed) {
+                finish(c, result); // relay: EOF ends the response
+                return;
+            }
+            if (n <= 0) {
+                fail(c, result);
+                return;
+            }
+            c.received += static_cast<size_t>(n);
+            if (framed && c.expected == 0 && c.received == FrameProtocol::kHeaderSize) {
+                if (c.header[0] != FrameProtocol::kData) {
+                    fail(c, result);
+                    return;
+                }
+                const auto* h = reinterpret_cast<const unsigned char*>(c.header);
+                c.expected = FrameProtocol::kHeaderSize + ((size_t{h[1]} << 24) | (size_t{h[2]} << 16) |
+                                                           (size_t{h[3]} << 8) | size_t{h[4]});
+            }
+            if (framed && c.expected != 0 && c.received == c.expected) {
+                finish(c, result);
+                return;
+            }
+        }
+    }
+};
+
+Result runPoint(const Config& cfg, const Point& point) {
+    std::vector<char> request;
+    const std::vector<char> payload = makePayload(point.size);
+    if (point.handler == "relay") {
+        request = payload;
+    } else {
+        request.resize(FrameProtocol::kHeaderSize);
+        request[0] = FrameProtocol::kData;
+        for (int i = 0; i < 4; ++i) request[1 + i] = static_cast<char>(point.size >> (24 - 8 * i));
+        request.insert(request.end(), payload.begin(), payload.end());
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(cfg.port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    size_t threads = cfg.threads ? cfg.threads : std::max<size_t>(1, std::thread::hardware_concurrency() / 2);
+    threads = std::min(threads, point.clients);
+    const auto start = Clock::now();
+    const auto measureFrom =
+        start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.warmupSeconds));
+    const auto end =
+        measureFrom + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.durationSeconds));
+
+    std::vector<Result> results(threads);
+    std::vector<std::unique_ptr<Driver>> drivers;
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        const size_t count = point.clients / threads + (t < point.clients % threads ? 1 : 0);
+        drivers.emplace_back(new Driver(point, request, count, addr, measureFrom, end));
+        workers.emplace_back([&drivers, &results, t]() { drivers[t]->run(results[t]); });
+    }
+    for (std::thread& w : workers) w.join();
+
+    Result total;
+    for (const Result& r : results) {
+        total.latency.merge(r.latency);
+        total.requests += r.requests;
+        total.connects += r.connects;
+        total.failures += r.failures;
+        total.bytesSent += r.bytesSent;
+        total.bytesReceived += r.bytesReceived;
+    }
+    return total;
+}
+
+const char* const kColumns[] = {"handler",  "mode",     "clients", "payload",  "seconds", "requests",
+                                "failures", "conn_per_s", "req_per_s", "sent_mb_s", "received_mb_s", "p50_us",
+                                "p90_us",   "p99_us",   "p99_9_us", "max_us"};
+
+std::vector<std::string> fields(const Point& point, const Result& r, double seconds) {
+    auto fixed = [](double v, int decimals) {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+        return std::string(buf);
+    };
+    auto us = [&](uint64_t ns) { return fixed(static_cast<double>(ns) / 1000.0, 1); };
+    return {point.handler,
+            point.perRequest ? "per_request" : "persistent",
+            std::to_string(point.clients),
+            std::to_string(point.size),
+            fixed(seconds, 3),
+            std::to_string(r.requests),
+            std::to_string(r.failures),
+            fixed(r.connects / seconds, 1),
+            fixed(r.requests / seconds, 1),
+            fixed(r.bytesSent / seconds / 1e6, 2),
+            fixed(r.bytesReceived / seconds / 1e6, 2),
+            us(r.latency.percentile(50)),
+            us(r.latency.percentile(90)),
+            us(r.latency.percentile(99)),
+            us(r.latency.percentile(99.9)),
+            us(r.latency.max())};
+}
+
+// Every client holds a socket here and one in the server; ask for the hard limit up front.
+size_t raiseFileLimit() {
+    rlimit limit{};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) != 0) return 0;
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        (void)::setrlimit(RLIMIT_NOFILE, &limit);
+        (void)::getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    return static_cast<size_t>(limit.rlim_cur);
+}
+
+void printUsage() {
+    std::cerr << "Usage: tcp_bench [options]\n"
+                 "  --handlers LIST      echo, compress, relay (default echo,compress)\n"
+                 "                       echo/compress answer FrameProtocol frames; relay echoes one\n"
+                 "                       request per connection until the client half-closes\n"
+                 "  --clients LIST       concurrent clients per run (default 1,10,100,1000; up to 10000)\n"
+                 "  --sizes LIST         request payload bytes, K/M suffixes (default 64,4K,64K)\n"
+                 "  --connect-per-request\n"
+                 "                       open a new connection for every echo/compress request\n"
+                 "  --duration SECS      measured time per run (default 2)\n"
+                 "  --warmup SECS        unmeasured time before each run (default 0.5)\n"
+                 "  --threads N          client driver threads (default: half the cores)\n"
+                 "  --port N             port for the in-process Server (default 9500)\n"
+                 "  --backlog N          listen() backlog (default 4096)\n"
+                 "  --no-nodelay         leave Nagle on for server connections\n"
+                 "  --format csv|json    (default csv)\n"
+                 "One row per handler, client count and payload size, in that order.\n";
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    Config cfg;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(arg + " expects a value");
+            }
+            return argv[++i];
+        };
+        try {
+            if (arg == "--handlers") {
+                cfg.handlers = splitList(value());
+                for (const std::string& h : cfg.handlers) (void)makeHandler(h);
+            } else if (arg == "--clients") {
+                cfg.clients.clear();
+                for (const std::string& c : splitList(value())) cfg.clients.push_back(parseCount(c));
+            } else if (arg == "--sizes") {
+                cfg.sizes.clear();
+                for (const std::string& s : splitList(value())) cfg.sizes.push_back(parseSize(s));
+            } else if (arg == "--connect-per-request") {
+                cfg.connectPerRequest = true;
+            } else if (arg == "--duration") {
+                cfg.durationSeconds = std::stod(value());
+            } else if (arg == "--warmup") {
+                cfg.warmupSeconds = std::stod(value());
+            } else if (arg == "--threads") {
+                cfg.threads = parseCount(value());
+            } else if (arg == "--port") {
+                cfg.port = std::stoi(value());
+            } else if (arg == "--backlog") {
+                cfg.backlog = std::stoi(value());
+            } else if (arg == "--no-nodelay") {
+                cfg.noDelay = false;
+            } else if (arg == "--format") {
+                cfg.format = value();
+                if (cfg.format != "csv" && cfg.format != "json") {
+                    throw std::invalid_argument("--format expects csv or json");
+                }
+            } else if (arg == "-h" || arg == "--help") {
+                printUsage();
+                return 0;
+            } else {
+                throw std::invalid_argument("unknown argument '" + arg + "'");
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "tcp_bench: " << e.what() << "\n";
+            printUsage();
+            return 2;
+        }
+    }
+    for (size_t clients : cfg.clients) {
+        if (clients == 0) {
+            std::cerr << "tcp_bench: client counts must be at least 1\n";
+            return 2;
+        }
+    }
+
+    const size_t fileLimit = raiseFileLimit();
+    const size_t maxClients = *std::max_element(cfg.clients.begin(), cfg.clients.end());
+    if (fileLimit != 0 && 2 * maxClients + 64 > fileLimit) {
+        std::cerr << "tcp_bench: warning: " << maxClients << " clients need about " << 2 * maxClients + 64
+                  << " file descriptors, the limit is " << fileLimit << "; expect connect failures\n";
+    }
+
+    std::ostream& out = std::cout;
+    if (cfg.format == "csv") {
+        for (size_t i = 0; i < sizeof(kColumns) / sizeof(kColumns[0]); ++i) out << (i ? "," : "") << kColumns[i];
+        out << "\n" << std::flush;
+    } else {
+        out << "{\n  \"benchmark\": \"tcp_bench\",\n  \"results\": [" << std::flush;
+    }
+
+    bool first = true;
+    for (const std::string& handler : cfg.handlers) {
+        SocketOptions options;
+        options.backlog = cfg.backlog;
+        options.noDelay = cfg.noDelay;
+        Server server(cfg.port, options);
+        server.setHandler(makeHandler(handler));
+        try {
+            server.start();
+        } catch (const std::exception& e) {
+            std::cerr << "tcp_bench: " << e.what() << "\n";
+            return 1;
+        }
+        for (size_t clients : cfg.clients) {
+            for (size_t size : cfg.sizes) {
+                const Point point{handler, cfg.connectPerRequest || handler == "relay", clients, size};
+                const Result result = runPoint(cfg, point);
+                const auto values = fields(point, result, cfg.durationSeconds);
+                if (cfg.format == "csv") {
+                    for (size_t i = 0; i < values.size(); ++i) out << (i ? "," : "") << values[i];
+                    out << "\n";
+                } else {
+                    out << (first ? "\n    {" : ",\n    {");
+                    for (size_t i = 0; i < values.size(); ++i) {
+                        out << (i ? ", " : "") << '"' << kColumns[i] << "\": ";
+                        if (i < 2) {
+                            out << '"' << values[i] << '"';
+                        } else {
+                            out << values[i];
+                        }
+                    }
+                    out << "}";
+                }
+                out << std::flush;
+                first = false;
+                // Let the server's connection threads see the closes and exit before the next run.
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            }
+        }
+        server.stop();
+    }
+    if (cfg.format == "json") {
+        out << (first ? "]\n}\n" : "\n  ]\n}\n");
+    }
+    return 0;
+}
+#else
+#include <iostream>
+
+int main() {
+    std::cerr << "tcp_bench: needs POSIX poll() and non-blocking connect; not built for Windows\n";
+    return 1;
+}
+#endif
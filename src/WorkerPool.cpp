@@ -0,0 +1,162 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+
+WorkerPool::WorkerPool(size_t threads, size_t smallJobBytes)
+    : smallJobBytes(smallJobBytes), largeRunning(0), smallBypass(0), stopping(false) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+    largeLimit = threads > 1 ? threads - 1 : 1;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    shutdown();
+}
+
+void WorkerPool::enqueue(size_t cost, std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopping) {
+            throw std::runtime_error("WorkerPool::submit: pool is shut down");
+        }
+        if (cost < smallJobBytes) {
+            smallJobs.push_back(std::move(job));
+        } else {
+            largeJobs.push_back(std::move(job));
+        }
+    }
+    cv.notify_one();
+}
+
+void WorkerPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& t : workers) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+}
+
+namespace {
+// Shared by the caller of forEach() and its helper jobs. Helpers that only get to run after
+// the loop closed find nothing to do and never touch `fn`, which may be gone by then.
+struct ForEachState {
+    const std::function<void(size_t)>* fn;
+    size_t count;
+    std::atomic<size_t> next{0};
+    std::mutex mtx;
+    std::condition_variable done;
+    bool closed = false;
+    size_t active = 0; // helpers currently running items
+    std::exception_ptr error;
+
+    void runItems() {
+        size_t i;
+        while ((i = next.fetch_add(1, std::memory_order_relaxed)) < count) {
+            try {
+                (*fn)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (!error) error = std::current_exception();
+            }
+        }
+    }
+};
+} // namespace
+
+void WorkerPool::forEach(size_t count, size_t costPerItem, const std::function<void(size_t)>& fn) {
+    auto state = std::make_shared<ForEachState>();
+    state->fn = &fn;
+    state->count = count;
+
+    const size_t helpers = std::min(count > 0 ? count - 1 : 0, workers.size() > 1 ? workers.size() - 1 : 0);
+    for (size_t h = 0; h < helpers; ++h) {
+        try {
+            enqueue(costPerItem, [state]() {
+                {
+                    std::lock_guard<std::mutex> lock(state->mtx);
+                    if (state->closed) return;
+                    ++state->active;
+                }
+                state->runItems();
+                std::lock_guard<std::mutex> lock(state->mtx);
+                if (--state->active == 0) state->done.notify_all();
+            });
+        } catch (const std::runtime_error&) {
+            break; // shutting down: the caller does the rest alone
+        }
+    }
+
+    state->runItems();
+
+    std::unique_lock<std::mutex> lock(state->mtx);
+    state->closed = true;
+    state->done.wait(lock, [&state]() { return state->active == 0; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+size_t WorkerPool::queued() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return smallJobs.size() + largeJobs.size();
+}
+
+void WorkerPool::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        bool large = false;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [this]() {
+                return !smallJobs.empty() || largeRunnable() ||
+                       (stopping && smallJobs.empty() && largeJobs.empty());
+            });
+            if (smallJobs.empty() && largeJobs.empty()) {
+                break; // stopping and drained
+            }
+            large = largeRunnable() && (smallJobs.empty() || smallBypass >= kMaxSmallBypass);
+            if (large) {
+                job = std::move(largeJobs.front());
+                largeJobs.pop_front();
+                ++largeRunning;
+                smallBypass = 0;
+            } else {
+                job = std::move(smallJobs.front());
+                smallJobs.pop_front();
+                if (!largeJobs.empty()) {
+                    ++smallBypass;
+                }
+            }
+        }
+
+        job(); // packaged_task: exceptions land in the future
+
+        if (large) {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                --largeRunning;
+            }
+            // A large job may be waiting for the slot just freed, or the pool may be draining.
+            cv.notify_all();
+        }
+    }
+}
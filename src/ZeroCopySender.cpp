@@ -0,0 +1,172 @@
+#include "ZeroCopySender.h"
+#include "SocketIo.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#if defined(__linux__)
+#  include <linux/errqueue.h>
+#  include <netinet/in.h>
+#  include <poll.h>
+#  include <sys/socket.h>
+#  include <sys/uio.h>
+#endif
+
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#  define HAVE_MSG_ZEROCOPY 1
+#endif
+
+namespace {
+// Beyond this many unacknowledged bytes, send() waits for completions first, so a slow
+// reader cannot make one connection pin unbounded memory.
+constexpr size_t kMaxInFlightBytes = 64 * 1024 * 1024;
+constexpr int kCloseWaitMs = 1000;
+
+bool sendCopy(int sock, std::string_view head, const ByteBuffer& body) {
+    const SocketIo::ConstSlice slices[] = {{head.data(), head.size()}, {body.data(), body.size()}};
+    return SocketIo::sendv(sock, slices, body.empty() ? 1 : 2);
+}
+} // namespace
+
+ZeroCopySender::ZeroCopySender(int sock) : sock(sock) {
+#ifdef HAVE_MSG_ZEROCOPY
+    const int one = 1;
+    on = ::setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+#endif
+}
+
+ZeroCopySender::~ZeroCopySender() {
+    // Past the deadline the buffers are released anyway: the connection is going away, and
+    // the kernel keeps its own reference to the pages it still has to transmit.
+    (void)reap(kCloseWaitMs);
+}
+
+bool ZeroCopySender::send(std::string_view head, const ByteBuffer& body) {
+#ifdef HAVE_MSG_ZEROCOPY
+    if (on) {
+        (void)reap(0);
+        if (inFlightBytes > kMaxInFlightBytes) {
+            (void)reap(kCloseWaitMs);
+        }
+    }
+    if (!on || body.empty()) {
+        return sendCopy(sock, head, body);
+    }
+
+    // The head buffer is reused for the next response, so it travels as a private copy.
+    InFlight entry{nextId, nextId, 0, ByteBuffer::copyOf(head), body};
+    const SocketIo::ConstSlice slices[] = {{entry.head.data(), entry.head.size()}, {body.data(), body.size()}};
+    size_t idx = 0;
+    size_t offset = 0;
+    bool ok = true;
+    while (idx < 2) {
+        iovec iov[2];
+        size_t n = 0;
+        for (size_t i = idx; i < 2; ++i) {
+            const size_t skip = i == idx ? offset : 0;
+            iov[n].iov_base = const_cast<char*>(slices[i].data) + skip;
+            iov[n].iov_len = slices[i].size - skip;
+            ++n;
+        }
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n;
+        const ssize_t sent = ::sendmsg(sock, &msg, MSG_ZEROCOPY | MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && errno == ENOBUFS) {
+            // Out of option memory for notifications: copy the rest.
+            const SocketIo::ConstSlice rest[] = {{slices[idx].data + offset, slices[idx].size - offset},
+                                                 {idx == 0 ? slices[1].data : "", idx == 0 ? slices[1].size : 0}};
+            ok = SocketIo::sendv(sock, rest, 2);
+            break;
+        }
+        if (sent <= 0) {
+            ok = false;
+            break;
+        }
+        ++nextId;
+        ++entry.remaining;
+        size_t left = static_cast<size_t>(sent);
+        while (idx < 2 && left >= slices[idx].size - offset) {
+            left -= slices[idx].size - offset;
+            ++idx;
+            offset = 0;
+        }
+        offset += left;
+    }
+    if (entry.remaining > 0) {
+        entry.lastId = nextId - 1;
+        inFlightBytes += entry.head.size() + entry.body.size();
+        inFlight.push_back(std::move(entry));
+    }
+    return ok;
+#else
+    return sendCopy(sock, head, body);
+#endif
+}
+
+size_t ZeroCopySender::reap(int timeoutMs) {
+#ifdef HAVE_MSG_ZEROCOPY
+    while (!inFlight.empty()) {
+        if (readCompletions()) continue;
+        if (timeoutMs <= 0) break;
+        // Error-queue data is signalled as POLLERR, which poll() reports unasked.
+        pollfd pfd{};
+        pfd.fd = sock;
+        const int rc = ::poll(&pfd, 1, timeoutMs);
+        if (rc < 0 && errno == EINTR) continue;
+        if (rc <= 0) break;
+        if ((pfd.revents & POLLERR) == 0) break; // hangup without notifications
+    }
+#else
+    (void)timeoutMs;
+#endif
+    return inFlight.size();
+}
+
+bool ZeroCopySender::readCompletions() {
+#ifdef HAVE_MSG_ZEROCOPY
+    char control[128];
+    msghdr msg{};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (::recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+        return false;
+    }
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+        const bool ipError = (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                             (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+        if (!ipError) continue;
+        const auto* err = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cm));
+        if (err->ee_origin != SO_EE_ORIGIN_ZEROCOPY || err->ee_errno != 0) continue;
+        if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+            // The kernel had to copy after all (e.g. loopback): pinning pages only adds cost.
+            copied = true;
+            on = false;
+        }
+        complete(err->ee_info, err->ee_data);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ZeroCopySender::complete(uint32_t first, uint32_t last) {
+    // Notifications cover id ranges and may arrive out of order, but each id is reported
+    // once, so an entry is done when the overlaps with its fixed range add up to its size.
+    for (auto& entry : inFlight) {
+        const uint32_t lo = std::max(first, entry.firstId);
+        const uint32_t hi = std::min(last, entry.lastId);
+        if (lo > hi) continue;
+        entry.remaining -= hi - lo + 1;
+    }
+    for (auto it = inFlight.begin(); it != inFlight.end();) {
+        if (it->remaining == 0) {
+            inFlightBytes -= it->head.size() + it->body.size();
+            it = inFlight.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
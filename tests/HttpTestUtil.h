@@ -0,0 +1,72 @@
+#ifndef HTTP_TEST_UTIL_H
+#define HTTP_TEST_UTIL_H
+
+// Helpers shared by the HTTP tests: requests built for calling handlers directly, and raw
+// request/response exchanges over a Client.
+
+#include <catch2/catch_all.hpp>
+#include "Client.h"
+#include "HttpTypes.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// `n` bytes of short runs (1-7 repeats of 'a'..'e'): compressible, but not trivially.
+inline std::vector<char> runs(size_t n) {
+    std::vector<char> out;
+    for (size_t i = 0; out.size() < n; ++i) out.insert(out.end(), std::min<size_t>(1 + i % 7, n - out.size()), 'a' + i % 5);
+    return out;
+}
+
+// POST request for `target` (path, optionally followed by '?' and a query) with `body`.
+inline HttpRequest post(const std::string& target, std::vector<char> body) {
+    HttpRequest req;
+    req.method = "POST";
+    const size_t question = target.find('?');
+    req.path = target.substr(0, question);
+    if (question != std::string::npos) req.query = target.substr(question + 1);
+    req.version = "HTTP/1.1";
+    req.body = std::move(body);
+    return req;
+}
+
+inline HttpRequest post(const std::string& target, const std::string& body) {
+    return post(target, std::vector<char>(body.begin(), body.end()));
+}
+
+// Number of (possibly overlapping) occurrences of `needle` in `haystack`.
+inline size_t countOf(const std::string& haystack, const std::string& needle) {
+    size_t n = 0;
+    for (size_t pos = haystack.find(needle); pos != std::string::npos; pos = haystack.find(needle, pos + 1)) n++;
+    return n;
+}
+
+inline bool startsWith(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Everything received until the server closes (up to 1 MiB).
+inline std::string receiveAll(Client& client) {
+    auto response = client.receiveData(1 << 20);
+    return std::string(response.begin(), response.end());
+}
+
+// Sends `raw` as is and returns everything received until the server closes.
+inline std::string sendRaw(Client& client, const std::string& raw) {
+    REQUIRE(client.sendData(std::vector<char>(raw.begin(), raw.end())));
+    return receiveAll(client);
+}
+
+// The same over a fresh connection to 127.0.0.1:`port`.
+inline std::string sendRaw(int port, const std::string& raw) {
+    Client client("127.0.0.1", port);
+    REQUIRE(client.connect());
+    const std::string response = sendRaw(client, raw);
+    client.disconnect();
+    return response;
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include <catch2/catch_all.hpp>
+#include "Server.h"
+#include "ClientPool.h"
+#include "FrameProtocol.h"
+#include "RLECompression.h"
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+TEST_CASE("ClientPool multiplexes framed requests over warm connections", "[network][pool]") {
+    std::atomic<int> connections{0};
+    auto framed = FrameProtocol::makeHandler([](const std::vector<char>& in) {
+        RLECompression rle;
+        return rle.compress(in);
+    });
+
+    Server server(9130);
+    server.setHandler([&connections, framed](int clientSock) {
+        connections++;
+        framed(clientSock);
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    {
+        ClientPool pool("127.0.0.1", 9130, 3);
+        std::vector<std::vector<char>> inputs;
+        std::vector<std::future<std::vector<char>>> results;
+        for (int i = 0; i < 60; i++) {
+            std::vector<char> payload(static_cast<size_t>(10 + i * 37), static_cast<char>('A' + (i % 26)));
+            inputs.push_back(payload);
+            results.push_back(pool.submit(std::move(payload)));
+        }
+
+        RLECompression rle;
+        for (size_t i = 0; i < results.size(); i++) {
+            REQUIRE(rle.decompress(results[i].get()) == inputs[i]);
+        }
+    }
+
+    // 60 requests were served by the 3 pooled connections, not one connection each.
+    REQUIRE(connections.load() == 3);
+    server.stop();
+}
+
+TEST_CASE("ClientPool reconnects transparently and reports server errors", "[network][pool]") {
+    // Serves one frame per connection, then closes: every request after the first finds its
+    // pooled connection closed by the server.
+    std::atomic<int> closed{0};
+    Server server(9131);
+    server.setHandler([&closed](int clientSock) {
+        char type = 0;
+        std::vector<char> payload;
+        if (FrameProtocol::readFrame(clientSock, type, payload)) {
+            if (std::string(payload.begin(), payload.end()) == "boom") {
+                const std::string msg = "bad payload";
+                FrameProtocol::writeFrame(clientSock, FrameProtocol::kError, std::vector<char>(msg.begin(), msg.end()));
+            } else {
+                FrameProtocol::writeFrame(clientSock, FrameProtocol::kData, payload);
+            }
+        }
+        close(clientSock);
+        closed++;
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    ClientPool pool("127.0.0.1", 9131, 1);
+    for (int i = 0; i < 5; i++) {
+        // Once the close has happened the pool must notice it before sending, not after.
+        for (int wait = 0; closed.load() < i && wait < 200; wait++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        std::string msg = "req" + std::to_string(i);
+        auto response = pool.submit(std::vector<char>(msg.begin(), msg.end())).get();
+        REQUIRE(std::string(response.begin(), response.end()) == msg);
+    }
+
+    std::string bad = "boom";
+    auto failed = pool.submit(std::vector<char>(bad.begin(), bad.end()));
+    REQUIRE_THROWS_AS(failed.get(), std::runtime_error);
+
+    pool.shutdown();
+    server.stop();
+}
+
+TEST_CASE("ClientPool does not resend a request whose response was lost", "[network][pool]") {
+    // Reads the request, then drops the connection without answering.
+    std::atomic<int> received{0};
+    Server server(9164);
+    server.setHandler([&received](int clientSock) {
+        char type = 0;
+        std::vector<char> payload;
+        if (FrameProtocol::readFrame(clientSock, type, payload)) {
+            received++;
+        }
+        close(clientSock);
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    ClientPool pool("127.0.0.1", 9164, 1);
+    std::string msg = "not idempotent";
+    auto lost = pool.submit(std::vector<char>(msg.begin(), msg.end()));
+    REQUIRE_THROWS_AS(lost.get(), std::runtime_error);
+    REQUIRE(received.load() == 1);
+
+    pool.shutdown();
+    server.stop();
+}
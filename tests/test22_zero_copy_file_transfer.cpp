@@ -0,0 +1,84 @@
+#include <catch2/catch_all.hpp>
+#include "Server.h"
+#include "Client.h"
+#include "FileHandler.h"
+#include "RLECompression.h"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+std::vector<char> patternBytes(size_t n) {
+    std::vector<char> data(n);
+    for (size_t i = 0; i < n; i++) {
+        data[i] = static_cast<char>((i * 131 + (i >> 7)) & 0xFF);
+    }
+    return data;
+}
+
+// The handlers echo while the upload is still arriving, so the response is read on a
+// second thread: otherwise both directions stall once the socket buffers fill.
+std::vector<char> sendFileAndCollect(int port, const std::string& path, size_t expected) {
+    Client client("127.0.0.1", port);
+    REQUIRE(client.connect());
+    std::vector<char> response;
+    std::thread reader([&]() { response = client.receiveData(expected + 1); });
+    const bool sent = client.sendFile(path);
+    const bool shutDown = client.shutdownWrite();
+    reader.join();
+    client.disconnect();
+    REQUIRE(sent);
+    REQUIRE(shutDown);
+    return response;
+}
+} // namespace
+
+TEST_CASE("Client::sendFile streams a file through the relay handler", "[network][zerocopy]") {
+    const std::string path = "test22_payload.bin";
+    const auto data = patternBytes(1024 * 1024 + 17);
+    FileHandler::writeFile(path, data);
+
+    Server server(9132);
+    server.setHandler(Server::makeRelayHandler());
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    auto response = sendFileAndCollect(9132, path, data.size());
+    REQUIRE(response == data);
+
+    server.stop();
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Decompress handler passes identity payloads through and decodes RLE", "[network][zerocopy]") {
+    const std::string identityPath = "test22_identity.bin";
+    const std::string rlePath = "test22_rle.bin";
+    const auto raw = patternBytes(512 * 1024);
+
+    std::vector<char> identity;
+    identity.push_back('I');
+    identity.insert(identity.end(), raw.begin(), raw.end());
+    FileHandler::writeFile(identityPath, identity);
+
+    RLECompression rle;
+    const std::vector<char> runs(100000, 'Q');
+    std::vector<char> rleTagged;
+    rleTagged.push_back('R');
+    const auto encoded = rle.compress(runs);
+    rleTagged.insert(rleTagged.end(), encoded.begin(), encoded.end());
+    FileHandler::writeFile(rlePath, rleTagged);
+
+    Server server(9133);
+    server.setHandler(Server::makeDecompressHandler());
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    REQUIRE(sendFileAndCollect(9133, identityPath, raw.size()) == raw);
+    REQUIRE(sendFileAndCollect(9133, rlePath, runs.size()) == runs);
+
+    server.stop();
+    std::remove(identityPath.c_str());
+    std::remove(rlePath.c_str());
+}
@@ -0,0 +1,76 @@
+#include <catch2/catch_all.hpp>
+#include "Server.h"
+#include "Client.h"
+#include "SocketIo.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+TEST_CASE("Client gathers sends and receives into caller buffers", "[network][iov]") {
+    // Echo handler: reads exactly 3 + 5 + 100000 bytes, then echoes them back in one go.
+    constexpr size_t kTotal = 3 + 5 + 100000;
+    Server server(9134);
+    server.setHandler([](int clientSock) {
+        std::vector<char> all(kTotal);
+        if (SocketIo::recvExact(clientSock, all.data(), all.size())) {
+            (void)SocketIo::sendAll(clientSock, all.data(), all.size());
+        }
+        close(clientSock);
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    Client client("127.0.0.1", 9134);
+    client.setBufferSizes(256 * 1024, 256 * 1024);
+    REQUIRE(client.connect());
+
+    const std::string head = "abc";
+    const std::string mid = "12345";
+    std::vector<char> tail(100000);
+    for (size_t i = 0; i < tail.size(); i++) tail[i] = static_cast<char>(i % 251);
+
+    REQUIRE(client.sendBuffers({{head.data(), head.size()}, {mid.data(), mid.size()}, {tail.data(), tail.size()}}));
+
+    // Scatter the first 8 bytes into two small buffers, then read the known-size rest exactly.
+    char a[3];
+    char b[5];
+    REQUIRE(client.receiveBuffers({{a, sizeof(a)}, {b, sizeof(b)}}));
+    REQUIRE(std::string(a, sizeof(a)) == head);
+    REQUIRE(std::string(b, sizeof(b)) == mid);
+
+    std::vector<char> rest(tail.size());
+    REQUIRE(client.receiveInto(rest));
+    REQUIRE(rest == tail);
+
+    // Nothing left: the server closed, so a further exact read must fail.
+    char extra;
+    REQUIRE_FALSE(client.receiveInto(&extra, 1));
+
+    client.disconnect();
+    server.stop();
+}
+
+TEST_CASE("receiveData returns large responses whole", "[network][iov]") {
+    Server server(9135);
+    server.setHandler([](int clientSock) {
+        std::vector<char> big(2 * 1024 * 1024, 'z');
+        big.back() = '!';
+        (void)SocketIo::sendAll(clientSock, big.data(), big.size());
+        close(clientSock);
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    Client client("127.0.0.1", 9135);
+    REQUIRE(client.connect());
+    auto response = client.receiveData(4 * 1024 * 1024);
+    REQUIRE(response.size() == 2 * 1024 * 1024);
+    REQUIRE(response.back() == '!');
+
+    client.disconnect();
+    server.stop();
+}
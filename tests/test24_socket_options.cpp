@@ -0,0 +1,84 @@
+#include <catch2/catch_all.hpp>
+#include "Server.h"
+#include "Client.h"
+#include "SocketOptions.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+TEST_CASE("SocketOptions are applied to accepted and client sockets", "[network][sockopt]") {
+    SocketOptions opts;
+    opts.backlog = 4;
+    opts.noDelay = true;
+    opts.keepAlive = true;
+    opts.keepAliveIdleSeconds = 30;
+    opts.deferAcceptSeconds = 1;
+    opts.fastOpenQueue = 8;
+    opts.receiveBufferBytes = 128 * 1024;
+    opts.sendBufferBytes = 128 * 1024;
+
+    std::atomic<int> noDelay{-1};
+    std::atomic<int> keepAlive{-1};
+
+    Server server(9136, opts);
+    server.setHandler([&](int clientSock) {
+#ifndef _WIN32
+        int value = 0;
+        socklen_t len = sizeof(value);
+        if (getsockopt(clientSock, IPPROTO_TCP, TCP_NODELAY, &value, &len) == 0) noDelay = value != 0;
+        len = sizeof(value);
+        if (getsockopt(clientSock, SOL_SOCKET, SO_KEEPALIVE, &value, &len) == 0) keepAlive = value != 0;
+#endif
+        char buffer[256];
+        int bytes = read(clientSock, buffer, sizeof(buffer));
+        if (bytes > 0) {
+            send(clientSock, buffer, bytes, 0);
+        }
+        close(clientSock);
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    SocketOptions clientOpts;
+    clientOpts.noDelay = true;
+    Client client("127.0.0.1", 9136, clientOpts);
+    REQUIRE(client.connect());
+
+    std::string msg = "tuned";
+    REQUIRE(client.sendData(std::vector<char>(msg.begin(), msg.end())));
+    auto response = client.receiveData();
+    REQUIRE(std::string(response.begin(), response.end()) == msg);
+
+#ifndef _WIN32
+    REQUIRE(noDelay.load() == 1);
+    REQUIRE(keepAlive.load() == 1);
+#endif
+
+    client.disconnect();
+    server.stop();
+}
+
+TEST_CASE("SocketSetup reports bind failures with the caller's prefix", "[network][sockopt]") {
+    Server first(9137);
+    first.start();
+
+    SocketOptions opts;
+    opts.reuseAddress = false;
+    Server second(9137, opts);
+    try {
+        second.start();
+        FAIL("second bind on the same port should fail");
+    } catch (const std::runtime_error& e) {
+        REQUIRE(std::string(e.what()).find("Server::start: bind()") == 0);
+    }
+
+    first.stop();
+}
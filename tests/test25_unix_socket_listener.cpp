@@ -0,0 +1,75 @@
+#include <catch2/catch_all.hpp>
+#include "Server.h"
+#include "Client.h"
+#include "HttpServer.h"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+namespace {
+std::string echoOnce(const std::string& host, int port, const std::string& msg) {
+    Client client(host, port);
+    REQUIRE(client.connect());
+    REQUIRE(client.sendData(std::vector<char>(msg.begin(), msg.end())));
+    auto response = client.receiveData();
+    client.disconnect();
+    return std::string(response.begin(), response.end());
+}
+} // namespace
+
+TEST_CASE("Server listens on a Unix socket alongside TCP", "[network][unix]") {
+#ifdef _WIN32
+    SUCCEED("Unix domain sockets are not supported on Windows");
+#else
+    const std::string path = "test25_server.sock";
+    SocketOptions opts;
+    opts.unixPath = path;
+    opts.unixMode = 0600;
+
+    Server server(9138, opts);
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    struct stat st {};
+    REQUIRE(stat(path.c_str(), &st) == 0);
+    REQUIRE((st.st_mode & 0777) == 0600);
+
+    REQUIRE(echoOnce("unix:" + path, 0, "over-unix") == "over-unix");
+    REQUIRE(echoOnce("127.0.0.1", 9138, "over-tcp") == "over-tcp");
+
+    server.stop();
+    // The socket file is removed on stop.
+    REQUIRE(stat(path.c_str(), &st) != 0);
+#endif
+}
+
+TEST_CASE("HttpServer serves requests on a Unix-only listener", "[network][unix][http]") {
+#if !defined(__linux__)
+    SUCCEED("abstract Unix socket namespace is Linux-only");
+#else
+    SocketOptions opts;
+    opts.tcpEnabled = false;
+    opts.unixPath = "@file-compressor-test25";
+
+    HttpServer server(0, opts);
+    server.setHandler([](const HttpRequest& req) {
+        HttpResponse res;
+        res.body.assign(req.path.begin(), req.path.end());
+        return res;
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const std::string response = echoOnce("unix:@file-compressor-test25", 0,
+                                          "GET /via-unix HTTP/1.1\r\nHost: local\r\n\r\n");
+    REQUIRE(response.find("HTTP/1.1 200 OK") == 0);
+    REQUIRE(response.substr(response.size() - 9) == "/via-unix");
+
+    server.stop();
+#endif
+}
@@ -0,0 +1,120 @@
+#include <catch2/catch_all.hpp>
+#include "HttpServer.h"
+#include "Client.h"
+#include "HttpTestUtil.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace {
+HttpServer::Handler echoPathAndBody(std::atomic<int>& calls) {
+    return [&calls](const HttpRequest& req) {
+        calls++;
+        HttpResponse res;
+        std::string body = req.path + ":" + std::string(req.body.begin(), req.body.end());
+        res.body.assign(body.begin(), body.end());
+        return res;
+    };
+}
+} // namespace
+
+TEST_CASE("HttpServer answers pipelined requests in order on one connection", "[http][keepalive]") {
+    std::atomic<int> calls{0};
+    HttpServer server(9139);
+    server.setHandler(echoPathAndBody(calls));
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    Client client("127.0.0.1", 9139);
+    REQUIRE(client.connect());
+
+    // Three requests in one write; the second body straddles the third request's headers.
+    const std::string pipelined =
+        "POST /first HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc"
+        "POST /second HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello"
+        "GET /third HTTP/1.1\r\nConnection: close\r\n\r\n";
+    const std::string all = sendRaw(client, pipelined);
+
+    REQUIRE(calls.load() == 3);
+    const size_t a = all.find("/first:abc");
+    const size_t b = all.find("/second:hello");
+    const size_t c = all.find("/third:");
+    REQUIRE(a != std::string::npos);
+    REQUIRE(b != std::string::npos);
+    REQUIRE(c != std::string::npos);
+    REQUIRE(a < b);
+    REQUIRE(b < c);
+    REQUIRE(countOf(all, "Connection: keep-alive") == 2);
+    REQUIRE(countOf(all, "Connection: close") == 1);
+
+    client.disconnect();
+    server.stop();
+}
+
+TEST_CASE("HttpServer enforces max requests per connection and idle timeout", "[http][keepalive]") {
+    std::atomic<int> calls{0};
+    HttpServerOptions httpOptions;
+    httpOptions.maxRequestsPerConnection = 2;
+    httpOptions.idleTimeoutMs = 200;
+    HttpServer server(9140, SocketOptions(), httpOptions);
+    server.setHandler(echoPathAndBody(calls));
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    {
+        // The second response announces the close even though the client asked to keep going.
+        Client client("127.0.0.1", 9140);
+        REQUIRE(client.connect());
+        const std::string all = sendRaw(client,
+            "GET /1 HTTP/1.1\r\n\r\nGET /2 HTTP/1.1\r\n\r\nGET /3 HTTP/1.1\r\n\r\n");
+        REQUIRE(countOf(all, "HTTP/1.1 200") == 2);
+        REQUIRE(countOf(all, "Connection: close") == 1);
+        client.disconnect();
+    }
+
+    {
+        // An idle kept-alive connection is closed by the server after idleTimeoutMs.
+        Client client("127.0.0.1", 9140);
+        REQUIRE(client.connect());
+        const auto start = std::chrono::steady_clock::now();
+        const std::string all = sendRaw(client, "GET /idle HTTP/1.1\r\n\r\n");
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        REQUIRE(countOf(all, "Connection: keep-alive") == 1);
+        REQUIRE(elapsed >= std::chrono::milliseconds(150));
+        REQUIRE(elapsed < std::chrono::seconds(3));
+        client.disconnect();
+    }
+
+    {
+        // HTTP/1.0 without an explicit keep-alive gets a single response.
+        Client client("127.0.0.1", 9140);
+        REQUIRE(client.connect());
+        const std::string all = sendRaw(client, "GET /old HTTP/1.0\r\n\r\n");
+        REQUIRE(countOf(all, "Connection: close") == 1);
+        client.disconnect();
+    }
+
+    server.stop();
+}
+
+TEST_CASE("HttpServer::stop closes idle kept-alive connections promptly", "[http][keepalive]") {
+    std::atomic<int> calls{0};
+    HttpServerOptions httpOptions;
+    httpOptions.idleTimeoutMs = 60 * 1000;
+    HttpServer server(9141, SocketOptions(), httpOptions);
+    server.setHandler(echoPathAndBody(calls));
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    Client client("127.0.0.1", 9141);
+    REQUIRE(client.connect());
+    const std::string req = "GET /x HTTP/1.1\r\n\r\n";
+    REQUIRE(client.sendData(std::vector<char>(req.begin(), req.end())));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const auto start = std::chrono::steady_clock::now();
+    server.stop();
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+    client.disconnect();
+}
@@ -0,0 +1,106 @@
+#include <catch2/catch_all.hpp>
+#include "StreamCodec.h"
+#include "AdaptiveCompression.h"
+#include "RLECompression.h"
+
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+// Feeds `input` to `codec` in pseudo-random piece sizes (including 0 and 1) and collects the output.
+std::vector<char> runInPieces(StreamCodec& codec, const std::vector<char>& input, unsigned seed) {
+    std::vector<char> out;
+    StreamCodec::Sink sink = [&out](const char* d, size_t n) { out.insert(out.end(), d, d + n); };
+    std::srand(seed);
+    size_t pos = 0;
+    while (pos < input.size()) {
+        size_t piece = static_cast<size_t>(std::rand() % 700);
+        piece = std::min(piece, input.size() - pos);
+        codec.write(input.data() + pos, piece, sink);
+        pos += piece;
+    }
+    codec.finish(sink);
+    return out;
+}
+
+std::vector<char> runsOf(size_t n) {
+    std::vector<char> data;
+    while (data.size() < n) {
+        data.insert(data.end(), static_cast<size_t>(1 + std::rand() % 400), static_cast<char>('a' + std::rand() % 3));
+    }
+    data.resize(n);
+    return data;
+}
+} // namespace
+
+TEST_CASE("RLE stream codecs match the one-shot codec across arbitrary splits", "[stream][rle]") {
+    RLECompression rle;
+    for (unsigned seed = 1; seed <= 5; seed++) {
+        std::srand(seed);
+        auto input = runsOf(20000);
+        RLEStreamEncoder enc;
+        auto encoded = runInPieces(enc, input, seed);
+        REQUIRE(encoded == rle.compress(input));
+
+        RLEStreamDecoder dec;
+        REQUIRE(runInPieces(dec, encoded, seed + 100) == input);
+    }
+}
+
+TEST_CASE("Adaptive stream compressor is byte-identical below the decision size", "[stream][adaptive]") {
+    AdaptiveCompression adaptive;
+    std::vector<char> runs(5000, 'x');
+    std::vector<char> noisy;
+    for (int i = 0; i < 5000; i++) noisy.push_back(static_cast<char>(i * 7));
+
+    for (const auto* input : {&runs, &noisy}) {
+        AdaptiveStreamCompressor comp;
+        REQUIRE(runInPieces(comp, *input, 3) == adaptive.compress(*input));
+    }
+
+    AdaptiveStreamCompressor comp;
+    REQUIRE(runInPieces(comp, {}, 3).empty());
+}
+
+TEST_CASE("Adaptive stream codecs round-trip large inputs in both modes", "[stream][adaptive]") {
+    AdaptiveCompression adaptive;
+    std::srand(42);
+    std::vector<char> runs = runsOf(300000);
+    std::vector<char> noisy(300000);
+    for (auto& c : noisy) c = static_cast<char>(std::rand());
+
+    AdaptiveStreamCompressor runComp(4096);
+    auto packedRuns = runInPieces(runComp, runs, 9);
+    REQUIRE(packedRuns[0] == 'R');
+    REQUIRE(packedRuns == adaptive.compress(runs));
+
+    AdaptiveStreamCompressor noiseComp(4096);
+    auto packedNoise = runInPieces(noiseComp, noisy, 10);
+    REQUIRE(packedNoise[0] == 'I');
+    REQUIRE(packedNoise.size() == noisy.size() + 1);
+
+    // The streaming decoder accepts both, and the one-shot decoder accepts streamed output.
+    AdaptiveStreamDecompressor d1;
+    REQUIRE(runInPieces(d1, packedRuns, 11) == runs);
+    AdaptiveStreamDecompressor d2;
+    REQUIRE(runInPieces(d2, packedNoise, 12) == noisy);
+    REQUIRE(adaptive.decompress(packedNoise) == noisy);
+}
+
+TEST_CASE("Stream decoders reject malformed input", "[stream]") {
+    StreamCodec::Sink ignore = [](const char*, size_t) {};
+
+    AdaptiveStreamDecompressor badTag;
+    const char junk[] = {'Z', 'a', 1};
+    REQUIRE_THROWS_AS(badTag.write(junk, sizeof(junk), ignore), std::runtime_error);
+
+    RLEStreamDecoder odd;
+    const char half[] = {'a'};
+    odd.write(half, 1, ignore);
+    REQUIRE_THROWS_AS(odd.finish(ignore), std::runtime_error);
+
+    RLEStreamDecoder zero;
+    const char zeroCount[] = {'a', 0};
+    REQUIRE_THROWS_AS(zero.write(zeroCount, 2, ignore), std::runtime_error);
+}
@@ -0,0 +1,116 @@
+#include <catch2/catch_all.hpp>
+#include "HttpServer.h"
+#include "CompressionApi.h"
+#include "AdaptiveCompression.h"
+#include "Client.h"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+namespace {
+std::string exchange(int port, const std::string& raw) {
+    Client client("127.0.0.1", port);
+    REQUIRE(client.connect());
+    REQUIRE(client.sendData(std::vector<char>(raw.begin(), raw.end())));
+    auto response = client.receiveData(64 << 20);
+    client.disconnect();
+    return std::string(response.begin(), response.end());
+}
+
+std::string chunkedUpload(const std::string& path, const std::string& body, size_t chunkSize) {
+    std::string raw = "POST " + path + " HTTP/1.1\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n";
+    for (size_t pos = 0; pos < body.size(); pos += chunkSize) {
+        const std::string piece = body.substr(pos, chunkSize);
+        char line[32];
+        std::snprintf(line, sizeof(line), "%zX;ext=1\r\n", piece.size());
+        raw += line + piece + "\r\n";
+    }
+    return raw + "0\r\nX-Trailer: yes\r\n\r\n";
+}
+
+// Splits a raw response into head and decoded body (chunked or Content-Length).
+std::string decodeBody(const std::string& response, bool& wasChunked) {
+    const size_t headEnd = response.find("\r\n\r\n");
+    REQUIRE(headEnd != std::string::npos);
+    const std::string head = response.substr(0, headEnd);
+    std::string rest = response.substr(headEnd + 4);
+    wasChunked = head.find("Transfer-Encoding: chunked") != std::string::npos;
+    if (!wasChunked) return rest;
+
+    std::string body;
+    size_t pos = 0;
+    while (true) {
+        const size_t eol = rest.find("\r\n", pos);
+        REQUIRE(eol != std::string::npos);
+        const size_t size = std::stoul(rest.substr(pos, eol - pos), nullptr, 16);
+        if (size == 0) break;
+        body += rest.substr(eol + 2, size);
+        pos = eol + 2 + size + 2;
+    }
+    return body;
+}
+} // namespace
+
+TEST_CASE("Chunked uploads stream through /compress and /decompress", "[http][chunked]") {
+    HttpServerOptions httpOptions;
+    httpOptions.streamThreshold = 1024;
+    CompressionApi api(0); // no cache, so known-length uploads stream rather than go to handle()
+    HttpServer server(9142, SocketOptions(), httpOptions);
+    server.setHandler([&api](const HttpRequest& req) { return api.handle(req); });
+    server.setStreamHandler([&api](const HttpRequest& req, HttpBodyReader& in, HttpResponseWriter& out) {
+        return api.handleStream(req, in, out);
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Incompressible, so the (identity) output is larger than the writer's buffer.
+    std::string input(200000, '\0');
+    for (size_t i = 0; i < input.size(); i++) input[i] = static_cast<char>((i * 7 + i / 13) & 0xFF);
+
+    bool chunked = false;
+    const std::string compressed = decodeBody(exchange(9142, chunkedUpload("/compress", input, 3000)), chunked);
+    REQUIRE(chunked); // large output leaves before the upload is fully processed
+    AdaptiveCompression adaptive;
+    REQUIRE(adaptive.decompress(std::vector<char>(compressed.begin(), compressed.end())) ==
+            std::vector<char>(input.begin(), input.end()));
+
+    // Content-Length upload above the threshold also streams; the result round-trips.
+    const std::string raw = "POST /decompress HTTP/1.1\r\nContent-Length: " + std::to_string(compressed.size()) +
+                            "\r\nConnection: close\r\n\r\n" + compressed;
+    REQUIRE(decodeBody(exchange(9142, raw), chunked) == input);
+    REQUIRE(chunked);
+
+    // Small streamed results are sent with Content-Length.
+    const std::string small = decodeBody(exchange(9142, chunkedUpload("/compress", "aaaaaaaaaa", 4)), chunked);
+    REQUIRE_FALSE(chunked);
+    REQUIRE(small == std::string("R") + 'a' + static_cast<char>(10));
+
+    // Malformed compressed input is rejected before any response bytes are sent.
+    const std::string bad = exchange(9142, chunkedUpload("/decompress", "Zjunk", 2));
+    REQUIRE(bad.find("HTTP/1.1 400") == 0);
+
+    server.stop();
+}
+
+TEST_CASE("Chunked bodies are decoded for the buffered handler", "[http][chunked]") {
+    HttpServer server(9143);
+    server.setHandler([](const HttpRequest& req) {
+        HttpResponse res;
+        res.sharedBody = req.body;
+        return res;
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Two chunked requests pipelined: the second must parse cleanly after the first's trailer.
+    const std::string first = chunkedUpload("/echo", "hello chunked world", 5);
+    std::string second = chunkedUpload("/echo", "again", 2);
+    const std::string all = exchange(9143, first.substr(0, first.find("Connection: close\r\n")) +
+                                           first.substr(first.find("Connection: close\r\n") + 19) + second);
+    REQUIRE(all.find("hello chunked world") != std::string::npos);
+    REQUIRE(all.find("again") != std::string::npos);
+    REQUIRE(all.find("hello chunked world") < all.find("again"));
+
+    server.stop();
+}
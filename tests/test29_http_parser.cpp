@@ -0,0 +1,87 @@
+#include <catch2/catch_all.hpp>
+#include "HttpParser.h"
+#include "HttpTypes.h"
+
+#include <string>
+
+TEST_CASE("HttpRequestParser parses a head fed one byte at a time", "[http][parser]") {
+    const std::string raw =
+        "POST /compress?level=1 HTTP/1.1\r\n"
+        "Host: example\r\n"
+        "content-LENGTH:  12 \r\n"
+        "X-Empty:\r\n"
+        "\r\n"
+        "leftover";
+
+    HttpRequestParser parser;
+    std::string buf;
+    HttpRequestParser::Result result = HttpRequestParser::Result::Incomplete;
+    for (char c : raw) {
+        buf.push_back(c); // the buffer reallocates as it grows; parsing must resume correctly
+        result = parser.parse(buf.data(), buf.size());
+        if (result != HttpRequestParser::Result::Incomplete) break;
+    }
+
+    REQUIRE(result == HttpRequestParser::Result::Complete);
+    REQUIRE(parser.headerBytes() == raw.find("leftover"));
+    REQUIRE(parser.method() == "POST");
+    REQUIRE(parser.target() == "/compress?level=1");
+    REQUIRE(parser.version() == "HTTP/1.1");
+    REQUIRE(parser.headerCount() == 3);
+    REQUIRE(parser.find("Content-Length") == "12");
+    REQUIRE(parser.find("x-empty").empty());
+    REQUIRE(parser.find("missing").empty());
+
+    HttpRequest req;
+    parser.fill(req);
+    REQUIRE(req.method == "POST");
+    REQUIRE(req.headers.get("HOST") == "example");
+    REQUIRE(req.headers.get("content-length") == "12");
+}
+
+TEST_CASE("HttpRequestParser rejects malformed heads", "[http][parser]") {
+    const char* bad[] = {
+        "GET\r\n\r\n",
+        "GET / HTTP/1.1\r\nNo colon here\r\n\r\n",
+        "GET / HTTP/1.1\nHost: x\r\n\r\n",
+        "G(T / HTTP/1.1\r\n\r\n",
+        "GET / HTTP/1.1\r\nHost: a\x01b\r\n\r\n",
+    };
+    for (const char* raw : bad) {
+        HttpRequestParser parser;
+        const std::string s(raw);
+        REQUIRE(parser.parse(s.data(), s.size()) == HttpRequestParser::Result::Error);
+        REQUIRE(std::string(parser.error()).size() > 0);
+    }
+
+    std::string tooMany = "GET / HTTP/1.1\r\n";
+    for (size_t i = 0; i <= HttpRequestParser::kMaxHeaders; i++) tooMany += "X-" + std::to_string(i) + ": v\r\n";
+    tooMany += "\r\n";
+    HttpRequestParser parser;
+    REQUIRE(parser.parse(tooMany.data(), tooMany.size()) == HttpRequestParser::Result::Error);
+}
+
+TEST_CASE("HttpHeaders is a flat, case-insensitive, ordered list", "[http][headers]") {
+    HttpHeaders h;
+    h.set("Content-Type", "text/plain");
+    h.add("Set-Cookie", "a=1");
+    h.add("set-cookie", "b=2");
+    h.set("CONTENT-TYPE", "application/octet-stream");
+
+    REQUIRE(h.size() == 3);
+    REQUIRE(h.get("content-type") == "application/octet-stream");
+    REQUIRE(h.get("Set-Cookie") == "a=1");
+    REQUIRE(h.at(0).first == "Set-Cookie");
+    REQUIRE(h.at(2).first == "CONTENT-TYPE");
+
+    REQUIRE(h.erase("SET-COOKIE"));
+    REQUIRE_FALSE(h.has("set-cookie"));
+    REQUIRE_FALSE(h.erase("set-cookie"));
+
+    size_t n = 0;
+    for (const auto field : h) {
+        REQUIRE(field.first == "CONTENT-TYPE");
+        n++;
+    }
+    REQUIRE(n == 1);
+}
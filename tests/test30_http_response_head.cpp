@@ -0,0 +1,81 @@
+#include <catch2/catch_all.hpp>
+#include "HttpServer.h"
+#include "CompressionApi.h"
+#include "Client.h"
+#include "HttpTestUtil.h"
+
+#include <string>
+#include <thread>
+
+TEST_CASE("HttpServer serializes preset headers and regenerates framing headers", "[http][response]") {
+    static const char kPreset[] = "X-Preset: yes\r\n";
+    HttpServer server(9144);
+    server.setHandler([](const HttpRequest& req) {
+        HttpResponse res;
+        if (req.path == "/long") {
+            // Stale framing headers from the handler must not reach the wire.
+            res.headers.set("Content-Length", "999");
+            res.headers.set("Transfer-Encoding", "gzip");
+            res.headers.set("X-Long", std::string(300, 'x'));
+        }
+        res.headers.set("X-Path", req.path);
+        res.presetHeaders = kPreset;
+        res.body.assign(req.path.begin(), req.path.end());
+        return res;
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    Client client("127.0.0.1", 9144);
+    REQUIRE(client.connect());
+
+    // A short head after a long one reuses the connection's head buffer.
+    const std::string all = sendRaw(client,
+                                    "GET /long HTTP/1.1\r\n\r\n"
+                                    "GET /s HTTP/1.1\r\nConnection: close\r\n\r\n");
+
+    const std::string expectedShort =
+        "HTTP/1.1 200 OK\r\n"
+        "X-Path: /s\r\n"
+        "X-Preset: yes\r\n"
+        "Content-Length: 2\r\n"
+        "Connection: close\r\n"
+        "\r\n"
+        "/s";
+    REQUIRE(all.size() > expectedShort.size());
+    REQUIRE(all.substr(all.size() - expectedShort.size()) == expectedShort);
+    REQUIRE(all.find("Content-Length: 5\r\n") != std::string::npos);
+    REQUIRE(all.find("999") == std::string::npos);
+    REQUIRE(all.find("gzip") == std::string::npos);
+    REQUIRE(countOf(all, "Content-Length:") == 2);
+    REQUIRE(countOf(all, "X-Preset: yes\r\n") == 2);
+    REQUIRE(countOf(all, "Connection: keep-alive") == 1);
+
+    client.disconnect();
+    server.stop();
+}
+
+TEST_CASE("CompressionApi responses carry the cached CORS header blocks", "[http][response]") {
+    CompressionApi api;
+    HttpServer server(9145);
+    server.setHandler([&api](const HttpRequest& req) { return api.handle(req); });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    Client client("127.0.0.1", 9145);
+    REQUIRE(client.connect());
+    const std::string all = sendRaw(client,
+                                    "GET /health HTTP/1.1\r\n\r\n"
+                                    "OPTIONS /compress HTTP/1.1\r\n\r\n"
+                                    "POST /compress HTTP/1.1\r\nContent-Length: 4\r\nConnection: close\r\n\r\naaaa");
+
+    REQUIRE(all.rfind("HTTP/1.1 200 OK\r\nContent-Type: text/plain; charset=utf-8\r\n", 0) == 0);
+    REQUIRE(countOf(all, "Access-Control-Allow-Origin: *\r\n") == 3);
+    REQUIRE(countOf(all, "Access-Control-Allow-Methods: POST, OPTIONS, GET\r\n") == 1);
+    REQUIRE(countOf(all, "Access-Control-Allow-Methods: POST, OPTIONS\r\n") == 2);
+    REQUIRE(all.find("HTTP/1.1 204 No Content\r\n") != std::string::npos);
+    REQUIRE(all.find("Content-Type: application/octet-stream\r\n") != std::string::npos);
+
+    client.disconnect();
+    server.stop();
+}
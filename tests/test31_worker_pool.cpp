@@ -0,0 +1,149 @@
+#include <catch2/catch_all.hpp>
+#include "WorkerPool.h"
+#include "HttpServer.h"
+#include "HttpTestUtil.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("WorkerPool runs small jobs before queued large ones", "[workerpool]") {
+    WorkerPool pool(1, 1024);
+
+    // Occupy the only worker so everything below queues up.
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    auto blocker = pool.submit(0, [opened]() { opened.wait(); });
+
+    std::mutex mtx;
+    std::vector<std::string> order;
+    auto record = [&](const std::string& name) {
+        return [&, name]() {
+            std::lock_guard<std::mutex> lock(mtx);
+            order.push_back(name);
+        };
+    };
+    auto big = pool.submit(1 << 20, record("large"));
+    auto s1 = pool.submit(10, record("small1"));
+    auto s2 = pool.submit(10, record("small2"));
+
+    gate.set_value();
+    blocker.get();
+    big.get();
+    s1.get();
+    s2.get();
+
+    REQUIRE(order == std::vector<std::string>{"small1", "small2", "large"});
+}
+
+TEST_CASE("WorkerPool keeps a worker free for small jobs while large ones run", "[workerpool]") {
+    WorkerPool pool(2, 1024);
+
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    auto big1 = pool.submit(1 << 20, [opened]() { opened.wait(); return 1; });
+    auto big2 = pool.submit(1 << 20, [opened]() { opened.wait(); return 2; });
+
+    // Only one of the two large jobs may hold a worker; the small one must still finish.
+    auto small = pool.submit(1, []() { return std::string("fast"); });
+    REQUIRE(small.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    REQUIRE(small.get() == "fast");
+
+    gate.set_value();
+    REQUIRE(big1.get() + big2.get() == 3);
+}
+
+TEST_CASE("WorkerPool delivers exceptions and drains on shutdown", "[workerpool]") {
+    WorkerPool pool(2);
+    REQUIRE(pool.size() == 2);
+
+    auto failing = pool.submit(0, []() -> int { throw std::runtime_error("boom"); });
+    REQUIRE_THROWS_AS(failing.get(), std::runtime_error);
+
+    std::vector<std::future<size_t>> results;
+    for (size_t i = 0; i < 50; ++i) {
+        results.push_back(pool.submit(i * 4096, [i]() { return i * i; }));
+    }
+    pool.shutdown();
+    for (size_t i = 0; i < results.size(); ++i) {
+        REQUIRE(results[i].get() == i * i);
+    }
+    REQUIRE(pool.queued() == 0);
+    REQUIRE_THROWS_AS(pool.submit(0, []() { return 0; }), std::runtime_error);
+}
+
+TEST_CASE("WorkerPool::forEach covers every item, even from inside a saturated pool", "[workerpool]") {
+    WorkerPool pool(2);
+
+    std::vector<int> hits(1000, 0);
+    pool.forEach(hits.size(), 0, [&hits](size_t i) { hits[i]++; });
+    for (int h : hits) REQUIRE(h == 1);
+
+    // Both workers run jobs that fan out again; no helper can start, so each caller must
+    // finish its items alone instead of waiting for queued helpers.
+    auto nested = [&pool]() {
+        std::vector<int> local(100, 0);
+        pool.forEach(local.size(), 0, [&local](size_t i) { local[i] = static_cast<int>(i); });
+        int sum = 0;
+        for (int v : local) sum += v;
+        return sum;
+    };
+    auto a = pool.submit(0, nested);
+    auto b = pool.submit(0, nested);
+    REQUIRE(a.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    REQUIRE(b.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    REQUIRE(a.get() == 4950);
+    REQUIRE(b.get() == 4950);
+
+    REQUIRE_THROWS_AS(pool.forEach(10, 0, [](size_t i) {
+        if (i == 7) throw std::runtime_error("item 7");
+    }), std::runtime_error);
+}
+
+TEST_CASE("HttpServer runs stream handlers as large compute jobs", "[workerpool][http]") {
+    // Two workers: one large job at a time, the other worker is kept for small requests.
+    HttpServerOptions options;
+    options.computeThreads = 2;
+    options.streamThreshold = 1024;
+    HttpServer server(9165, SocketOptions(), options);
+    std::atomic<int> active{0};
+    std::atomic<int> peak{0};
+    server.setStreamHandler([&](const HttpRequest&, HttpBodyReader& in, HttpResponseWriter& out) {
+        const int now = ++active;
+        for (int seen = peak.load(); now > seen && !peak.compare_exchange_weak(seen, now);) {
+        }
+        char buf[4096];
+        while (in.read(buf, sizeof(buf)) > 0) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        --active;
+        out.start(HttpResponse());
+        out.write("streamed", 8);
+        out.finish();
+        return true;
+    });
+    server.setHandler([](const HttpRequest&) { return HttpResponse(); });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const std::string upload = "POST /s HTTP/1.1\r\nContent-Length: 2048\r\nConnection: close\r\n\r\n" +
+                               std::string(2048, 'x');
+    std::vector<std::thread> clients;
+    std::vector<std::string> responses(3);
+    for (size_t i = 0; i < responses.size(); i++) {
+        clients.emplace_back([&, i]() { responses[i] = sendRaw(9165, upload); });
+    }
+    for (auto& t : clients) t.join();
+    server.stop();
+
+    for (const auto& response : responses) {
+        REQUIRE(startsWith(response, "HTTP/1.1 200 OK\r\n"));
+        REQUIRE(response.find("\r\n\r\nstreamed") != std::string::npos);
+    }
+    REQUIRE(peak.load() == 1);
+}
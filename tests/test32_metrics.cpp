@@ -0,0 +1,115 @@
+#include <catch2/catch_all.hpp>
+#include "Metrics.h"
+#include "HttpServer.h"
+#include "CompressionApi.h"
+#include "Client.h"
+#include "HttpTestUtil.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+// Value of the first sample line that starts with `series` (name plus labels), or -1.
+long long sampleValue(const std::string& text, const std::string& series) {
+    size_t pos = 0;
+    while ((pos = text.find(series + " ", pos)) != std::string::npos) {
+        if (pos == 0 || text[pos - 1] == '\n') {
+            return std::stoll(text.substr(pos + series.size() + 1));
+        }
+        pos += series.size();
+    }
+    return -1;
+}
+} // namespace
+
+TEST_CASE("Metrics merges per-thread shards on render", "[metrics]") {
+    const std::string series = "compressor_http_requests_total{endpoint=\"other\",code=\"other\"}";
+    const long long before = std::max(0LL, sampleValue(Metrics::render(), series));
+
+    // Short-lived threads, in waves: exited threads' shards are reused, and their counts kept.
+    for (int wave = 0; wave < 4; ++wave) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; ++t) {
+            threads.emplace_back([]() {
+                for (int i = 0; i < 1000; ++i) {
+                    Metrics::recordRequest(Metrics::Endpoint::Other, 299, 1, 2);
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+    }
+
+    REQUIRE(sampleValue(Metrics::render(), series) - before == 32000);
+}
+
+TEST_CASE("Metrics renders cumulative histograms", "[metrics]") {
+    Metrics::recordCompression(Metrics::Codec::Rle, 1000, 10); // ratio 100
+    Metrics::recordPhase(Metrics::Phase::Send, std::chrono::microseconds(30));
+
+    const std::string text = Metrics::render();
+    REQUIRE(text.find("# TYPE compressor_phase_seconds histogram") != std::string::npos);
+    const long long le1 = sampleValue(text, "compressor_phase_seconds_bucket{phase=\"send\",le=\"5e-05\"}");
+    const long long inf = sampleValue(text, "compressor_phase_seconds_bucket{phase=\"send\",le=\"+Inf\"}");
+    REQUIRE(le1 >= 1);
+    REQUIRE(inf >= le1);
+    REQUIRE(sampleValue(text, "compressor_phase_seconds_count{phase=\"send\"}") == inf);
+    REQUIRE(sampleValue(text, "compressor_compression_ratio_bucket{le=\"64\"}") <
+            sampleValue(text, "compressor_compression_ratio_bucket{le=\"256\"}"));
+    REQUIRE(sampleValue(text, "compressor_codec_selected_total{codec=\"rle\"}") >= 1);
+}
+
+TEST_CASE("CompressionApi serves /metrics", "[metrics][http]") {
+    CompressionApi api;
+    HttpServerOptions httpOptions;
+    httpOptions.computeThreads = 3;
+    HttpServer server(9146, SocketOptions(), httpOptions);
+    server.setHandler([&api](const HttpRequest& req) { return api.handle(req); });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    Client client("127.0.0.1", 9146);
+    REQUIRE(client.connect());
+    const std::string all = sendRaw(client,
+                                    "POST /compress HTTP/1.1\r\nContent-Length: 8\r\n\r\naaaaaaaa"
+                                    "GET /metrics HTTP/1.1\r\nConnection: close\r\n\r\n");
+
+    const size_t bodyStart = all.rfind("\r\n\r\n");
+    REQUIRE(bodyStart != std::string::npos);
+    const std::string text = all.substr(bodyStart + 4);
+    REQUIRE(all.find("Content-Type: text/plain; version=0.0.4") != std::string::npos);
+    REQUIRE(sampleValue(text, "compressor_http_requests_total{endpoint=\"compress\",code=\"200\"}") >= 1);
+    REQUIRE(sampleValue(text, "compressor_http_request_bytes_total{endpoint=\"compress\"}") >= 8);
+    REQUIRE(sampleValue(text, "compressor_active_connections") >= 1);
+    REQUIRE(sampleValue(text, "compressor_threads{pool=\"compute\"}") >= 3);
+    REQUIRE(sampleValue(text, "compressor_threads{pool=\"io\"}") >= 2);
+    REQUIRE(sampleValue(text, "compressor_phase_seconds_count{phase=\"parse\"}") >= 2);
+
+    client.disconnect();
+    server.stop();
+}
+
+TEST_CASE("The parse phase leaves out waiting for the request head", "[metrics][http]") {
+    HttpServer server(9166, SocketOptions(), HttpServerOptions());
+    server.setHandler([](const HttpRequest&) { return HttpResponse(); });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const std::string fast = "compressor_phase_seconds_bucket{phase=\"parse\",le=\"0.25\"}";
+    const std::string all = "compressor_phase_seconds_count{phase=\"parse\"}";
+    const std::string before = Metrics::render();
+
+    // The head arrives in two parts, 400 ms apart.
+    Client client("127.0.0.1", 9166);
+    REQUIRE(client.connect());
+    const std::string first = "GET /slow HTTP/1.1\r\n";
+    REQUIRE(client.sendData(std::vector<char>(first.begin(), first.end())));
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    REQUIRE(startsWith(sendRaw(client, "Connection: close\r\n\r\n"), "HTTP/1.1 200 OK\r\n"));
+    client.disconnect();
+    server.stop();
+
+    const std::string after = Metrics::render();
+    REQUIRE(sampleValue(after, all) - sampleValue(before, all) == 1);
+    REQUIRE(sampleValue(after, fast) - sampleValue(before, fast) == 1);
+}
@@ -0,0 +1,158 @@
+#include <catch2/catch_all.hpp>
+#include "ResultCache.h"
+#include "CompressionApi.h"
+#include "HttpServer.h"
+#include "HttpTestUtil.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("ResultCache keys depend on the bytes and the variant", "[cache]") {
+    const std::string a = "the same payload";
+    const auto k1 = ResultCache::keyFor("compress", a.data(), a.size());
+    const auto k2 = ResultCache::keyFor("compress", a.data(), a.size());
+    const auto k3 = ResultCache::keyFor("decompress", a.data(), a.size());
+    const auto k4 = ResultCache::keyFor("compress", a.data(), a.size() - 1);
+    REQUIRE(k1 == k2);
+    REQUIRE_FALSE(k1 == k3);
+    REQUIRE_FALSE(k1 == k4);
+    REQUIRE(k1.hex().size() == 32);
+    REQUIRE(k1.hex().find_first_not_of("0123456789abcdef") == std::string::npos);
+}
+
+TEST_CASE("ResultCache::keyedHash is SipHash-2-4-128", "[cache]") {
+    // Reference test vectors: key 00 01 .. 0f, messages "" and "\x00"; the output bytes
+    // a3 81 7f 04 ... read as two little-endian words.
+    ResultCache::Key secret;
+    secret.hi = 0x0706050403020100ULL;
+    secret.lo = 0x0f0e0d0c0b0a0908ULL;
+    const ResultCache::Key empty = ResultCache::keyedHash(secret, "", 0);
+    REQUIRE(empty.hi == 0xe6a825ba047f81a3ULL);
+    REQUIRE(empty.lo == 0x930255c71472f66dULL);
+    const ResultCache::Key zero = ResultCache::keyedHash(secret, "\0", 1);
+    REQUIRE(zero.hi == 0x44af996bd8c187daULL);
+    REQUIRE(zero.lo == 0x45fc229b11597634ULL);
+}
+
+TEST_CASE("ResultCache evicts least recently used entries within its budget", "[cache]") {
+    // 16 KiB per shard; every key below lands in one shard so the LRU order is observable.
+    ResultCache cache(ResultCache::kShards * 16 * 1024);
+    std::vector<ResultCache::Key> keys;
+    for (uint64_t i = 0; keys.size() < 6; ++i) {
+        ResultCache::Key k;
+        k.hi = i * ResultCache::kShards; // same shard
+        k.lo = i;
+        keys.push_back(k);
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        cache.put(keys[i], std::vector<char>(4000, static_cast<char>('a' + i)));
+    }
+    REQUIRE(cache.entries() == 3);
+    REQUIRE(cache.get(keys[0]) != nullptr); // keys[1] is now the oldest
+
+    cache.put(keys[3], std::vector<char>(4000, 'd'));
+    cache.put(keys[4], std::vector<char>(4000, 'e'));
+    REQUIRE(cache.bytes() <= 16 * 1024);
+    REQUIRE(cache.get(keys[1]) == nullptr);
+    REQUIRE(cache.get(keys[0]) != nullptr);
+    REQUIRE((*cache.get(keys[4]))[0] == 'e');
+
+    // Larger than half a shard: returned but not kept.
+    REQUIRE(cache.put(keys[5], std::vector<char>(9000, 'x'))->size() == 9000);
+    REQUIRE(cache.get(keys[5]) == nullptr);
+}
+
+TEST_CASE("ResultCache tolerates concurrent access", "[cache]") {
+    ResultCache cache(1 << 20);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&cache, t]() {
+            for (int i = 0; i < 2000; ++i) {
+                const std::string body = std::to_string((i * 7 + t) % 300);
+                const auto key = ResultCache::keyFor("v", body.data(), body.size());
+                auto hit = cache.get(key);
+                if (hit) {
+                    REQUIRE(std::string(hit->begin(), hit->end()) == body);
+                } else {
+                    cache.put(key, std::vector<char>(body.begin(), body.end()));
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    REQUIRE(cache.entries() == 300);
+}
+
+TEST_CASE("CompressionApi sends ETags, answers If-None-Match with 304 and serves repeats", "[cache][http]") {
+    CompressionApi api;
+    const std::string payload(5000, 'z');
+
+    const HttpResponse first = api.handle(post("/compress", payload));
+    REQUIRE(first.statusCode == 200);
+    const std::string etag(first.headers.get("ETag"));
+    REQUIRE(etag.size() == 34);
+    REQUIRE(etag.front() == '"');
+
+    const HttpResponse second = api.handle(post("/compress", payload));
+    REQUIRE(second.bodyView() == first.bodyView());
+    REQUIRE(second.headers.get("ETag") == etag);
+
+    // A different operation (and body) gets its own tag.
+    const HttpResponse decompressed = api.handle(post("/decompress", std::string(first.bodyView())));
+    REQUIRE(decompressed.bodyView() == payload);
+    REQUIRE(decompressed.headers.get("ETag") != etag);
+
+    HttpRequest conditional = post("/compress", payload);
+    conditional.headers.set("If-None-Match", "\"nope\", W/" + etag);
+    const HttpResponse notModified = api.handle(conditional);
+    REQUIRE(notModified.statusCode == 304);
+    REQUIRE(notModified.bodyView().empty());
+    REQUIRE(notModified.headers.get("ETag") == etag);
+
+    conditional.headers.set("If-None-Match", "\"something-else\"");
+    REQUIRE(api.handle(conditional).statusCode == 200);
+
+    // Failures are neither cached nor tagged.
+    const HttpResponse bad = api.handle(post("/decompress", "Xgarbage"));
+    REQUIRE(bad.statusCode == 400);
+    REQUIRE_FALSE(bad.headers.has("ETag"));
+
+    CompressionApi uncached(0);
+    REQUIRE(uncached.handle(post("/compress", payload)).bodyView() == first.bodyView());
+}
+
+TEST_CASE("Uploads the cache can hold skip the stream handler", "[cache][http]") {
+    CompressionApi api(1 << 20); // 64 KiB shards: results up to ~32 KiB are cached
+    HttpServerOptions options;
+    options.streamThreshold = 1024;
+    HttpServer server(9167, SocketOptions(), options);
+    server.setHandler([&api](const HttpRequest& req) { return api.handle(req); });
+    server.setStreamHandler([&api](const HttpRequest& req, HttpBodyReader& in, HttpResponseWriter& out) {
+        return api.handleStream(req, in, out);
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const auto upload = [](const std::string& body, const std::string& extra) {
+        return "POST /compress HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) + "\r\n" + extra +
+               "Connection: close\r\n\r\n" + body;
+    };
+    const std::string small(8 * 1024, 'z');
+    const std::string first = sendRaw(9167, upload(small, ""));
+    REQUIRE(startsWith(first, "HTTP/1.1 200 OK\r\n"));
+    const size_t tagAt = first.find("\r\nETag: ");
+    REQUIRE(tagAt != std::string::npos);
+    const std::string etag = first.substr(tagAt + 8, 34);
+    REQUIRE(startsWith(sendRaw(9167, upload(small, "If-None-Match: " + etag + "\r\n")), "HTTP/1.1 304 Not Modified\r\n"));
+
+    // Too big to cache: streamed, so no ETag.
+    const std::vector<char> large = runs(128 * 1024);
+    const std::string streamed = sendRaw(9167, upload(std::string(large.begin(), large.end()), ""));
+    REQUIRE(startsWith(streamed, "HTTP/1.1 200 OK\r\n"));
+    REQUIRE(streamed.find("\r\nETag: ") == std::string::npos);
+
+    server.stop();
+}
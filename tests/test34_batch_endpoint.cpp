@@ -0,0 +1,99 @@
+#include <catch2/catch_all.hpp>
+#include "CompressionApi.h"
+#include "WorkerPool.h"
+#include "HttpTestUtil.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+void appendItem(std::vector<char>& out, const std::string& bytes) {
+    const uint32_t n = static_cast<uint32_t>(bytes.size());
+    out.push_back(static_cast<char>((n >> 24) & 0xFF));
+    out.push_back(static_cast<char>((n >> 16) & 0xFF));
+    out.push_back(static_cast<char>((n >> 8) & 0xFF));
+    out.push_back(static_cast<char>(n & 0xFF));
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+struct Entry {
+    unsigned char status;
+    std::string bytes;
+};
+
+std::vector<Entry> parseEntries(std::string_view body) {
+    std::vector<Entry> entries;
+    size_t pos = 0;
+    while (pos < body.size()) {
+        REQUIRE(body.size() - pos >= 5);
+        const unsigned char* b = reinterpret_cast<const unsigned char*>(body.data() + pos);
+        const size_t n = (static_cast<size_t>(b[1]) << 24) | (static_cast<size_t>(b[2]) << 16) |
+                         (static_cast<size_t>(b[3]) << 8) | b[4];
+        REQUIRE(body.size() - pos - 5 >= n);
+        entries.push_back(Entry{b[0], std::string(body.data() + pos + 5, n)});
+        pos += 5 + n;
+    }
+    return entries;
+}
+} // namespace
+
+TEST_CASE("Batch compress and decompress round-trip items in order", "[batch]") {
+    CompressionApi api;
+    api.setWorkerPool(std::make_shared<WorkerPool>(4));
+
+    std::vector<std::string> items;
+    for (int i = 0; i < 300; ++i) {
+        if (i % 3 == 0) {
+            items.push_back(std::string(static_cast<size_t>(i * 10), static_cast<char>('a' + i % 26)));
+        } else {
+            items.push_back("item-" + std::to_string(i));
+        }
+    }
+    items.push_back(std::string()); // empty items are fine too
+
+    std::vector<char> request;
+    for (const auto& item : items) appendItem(request, item);
+    const HttpResponse compressed = api.handle(post("/batch/compress", request));
+    REQUIRE(compressed.statusCode == 200);
+    const auto compressedEntries = parseEntries(compressed.bodyView());
+    REQUIRE(compressedEntries.size() == items.size());
+
+    std::vector<char> back;
+    for (const auto& e : compressedEntries) {
+        REQUIRE(e.status == CompressionApi::kBatchOk);
+        appendItem(back, e.bytes);
+    }
+    const auto restored = parseEntries(api.handle(post("/batch/decompress", back)).bodyView());
+    REQUIRE(restored.size() == items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        REQUIRE(restored[i].status == CompressionApi::kBatchOk);
+        REQUIRE(restored[i].bytes == items[i]);
+    }
+}
+
+TEST_CASE("Batch reports per-item errors and rejects broken framing", "[batch]") {
+    CompressionApi api(0); // no cache, no pool: serial path
+
+    std::vector<char> request;
+    appendItem(request, "Ihello");
+    appendItem(request, "Zbad-tag");
+    appendItem(request, "Ibye");
+    const auto entries = parseEntries(api.handle(post("/batch/decompress", request)).bodyView());
+    REQUIRE(entries.size() == 3);
+    REQUIRE(entries[0].status == CompressionApi::kBatchOk);
+    REQUIRE(entries[0].bytes == "hello");
+    REQUIRE(entries[1].status == CompressionApi::kBatchError);
+    REQUIRE_FALSE(entries[1].bytes.empty());
+    REQUIRE(entries[2].bytes == "bye");
+
+    REQUIRE(api.handle(post("/batch/compress", std::vector<char>())).bodyView().empty());
+
+    std::vector<char> truncated;
+    appendItem(truncated, "abcdef");
+    truncated.pop_back();
+    REQUIRE(api.handle(post("/batch/compress", truncated)).statusCode == 400);
+    REQUIRE(api.handle(post("/batch/compress", std::vector<char>{0, 0, 0})).statusCode == 400);
+}
@@ -0,0 +1,120 @@
+#include <catch2/catch_all.hpp>
+#include "CompressionApi.h"
+#include "HttpParser.h"
+#include "HttpTestUtil.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+// Request head as HttpServer would see it, so the parser's path/query split is covered.
+HttpRequest parsed(const std::string& target) {
+    const std::string raw = "POST " + target + " HTTP/1.1\r\n\r\n";
+    HttpRequestParser parser;
+    REQUIRE(parser.parse(raw.data(), raw.size()) == HttpRequestParser::Result::Complete);
+    HttpRequest req;
+    parser.fill(req);
+    return req;
+}
+
+std::string str(std::string_view v) {
+    return std::string(v);
+}
+} // namespace
+
+TEST_CASE("Request targets are split into path and decoded query parameters", "[http][codec]") {
+    const HttpRequest req = parsed("/compress?x&algorithm=r%6Ce&note=a+b%20c&bad=%zz");
+    REQUIRE(req.path == "/compress");
+    REQUIRE(req.query == "x&algorithm=r%6Ce&note=a+b%20c&bad=%zz");
+
+    std::string value;
+    REQUIRE(req.queryParam("algorithm", value));
+    REQUIRE(value == "rle");
+    REQUIRE(req.queryParam("note", value));
+    REQUIRE(value == "a b c");
+    REQUIRE(req.queryParam("bad", value));
+    REQUIRE(value == "%zz");
+    REQUIRE(req.queryParam("x", value));
+    REQUIRE(value.empty());
+    REQUIRE_FALSE(req.queryParam("level", value));
+    REQUIRE(parsed("/health").query.empty());
+}
+
+TEST_CASE("Forced codecs still produce the tagged container", "[codec]") {
+    CompressionApi api;
+    const std::string runs(3000, 'a');
+    const std::string noisy = "abcdefghijklmnopqrstuvwxyz0123456789";
+
+    const HttpResponse rle = api.handle(post("/compress?algorithm=rle", noisy));
+    REQUIRE(rle.statusCode == 200);
+    REQUIRE(rle.bodyView()[0] == 'R');
+    REQUIRE(rle.headers.get("X-Compression-Algorithm") == "rle");
+    REQUIRE(rle.bodyView().size() > noisy.size()); // forced even though it expands
+
+    HttpRequest identityReq = post("/compress", runs);
+    identityReq.headers.set("X-Compression-Algorithm", "identity");
+    const HttpResponse identity = api.handle(identityReq);
+    REQUIRE(identity.bodyView()[0] == 'I');
+    REQUIRE(identity.bodyView().size() == runs.size() + 1);
+
+    // Query beats header.
+    HttpRequest both = post("/compress?algorithm=rle", runs);
+    both.headers.set("X-Compression-Algorithm", "identity");
+    REQUIRE(api.handle(both).bodyView()[0] == 'R');
+
+    for (const HttpResponse* r : {&rle, &identity}) {
+        REQUIRE(api.handle(post("/decompress", str(r->bodyView()))).statusCode == 200);
+    }
+    REQUIRE(str(api.handle(post("/decompress", str(rle.bodyView()))).bodyView()) == noisy);
+    REQUIRE(str(api.handle(post("/decompress", str(identity.bodyView()))).bodyView()) == runs);
+
+    // Different codecs, different ETags for the same body.
+    REQUIRE(api.handle(post("/compress?algorithm=rle", runs)).headers.get("ETag") !=
+            api.handle(post("/compress?algorithm=identity", runs)).headers.get("ETag"));
+    REQUIRE(api.handle(post("/compress?algorithm=rle", "")).bodyView().empty());
+}
+
+TEST_CASE("Adaptive levels and block size", "[codec]") {
+    CompressionApi api(0);
+    // Runs first, noise after: a 4 KiB sample says RLE, the full trial says stored.
+    std::string data(4096, 'x');
+    for (int i = 0; i < 20000; ++i) data += static_cast<char>('a' + (i * 7) % 26);
+
+    const HttpResponse sampled = api.handle(post("/compress?level=1&block=4096", data));
+    const HttpResponse full = api.handle(post("/compress?level=9", data));
+    REQUIRE(sampled.bodyView()[0] == 'R');
+    REQUIRE(full.bodyView()[0] == 'I');
+    REQUIRE(str(api.handle(post("/decompress", str(sampled.bodyView()))).bodyView()) == data);
+    REQUIRE(str(api.handle(post("/decompress", str(full.bodyView()))).bodyView()) == data);
+    REQUIRE(api.handle(post("/compress", data)).bodyView() == full.bodyView()); // default level is a full trial
+
+    const CompressionApi::CodecParams defaults = CompressionApi::codecParams(post("/compress", ""));
+    REQUIRE(defaults.algorithm == "adaptive");
+    REQUIRE(defaults.level == 6);
+    REQUIRE(defaults.blockSize == 64 * 1024);
+    REQUIRE(CompressionApi::codecParams(post("/compress?algorithm=rle", "")).level == 0);
+}
+
+TEST_CASE("Invalid codec parameters are rejected with 400", "[codec]") {
+    CompressionApi api;
+    for (const char* target : {"/compress?algorithm=zstd", "/compress?algorithm=rle&level=3", "/compress?level=0",
+                               "/compress?level=10", "/compress?level=abc", "/compress?block=12",
+                               "/compress?algorithm=identity&block=4096", "/batch/compress?algorithm=nope"}) {
+        const HttpResponse res = api.handle(post(target, "aaaa"));
+        REQUIRE(res.statusCode == 400);
+    }
+}
+
+TEST_CASE("GET /algorithms describes the codecs", "[codec]") {
+    CompressionApi api;
+    HttpRequest req = post("/algorithms", "");
+    req.method = "GET";
+    const HttpResponse res = api.handle(req);
+    REQUIRE(res.statusCode == 200);
+    const std::string body = str(res.bodyView());
+    REQUIRE(body.front() == '{');
+    for (const char* needle : {"\"name\":\"adaptive\"", "\"name\":\"rle\"", "\"name\":\"identity\"",
+                               "\"level\":{\"min\":1,\"max\":9,\"default\":6}", "X-Compression-Algorithm"}) {
+        REQUIRE(body.find(needle) != std::string::npos);
+    }
+}
@@ -0,0 +1,200 @@
+#include <catch2/catch_all.hpp>
+#include "HttpServer.h"
+#include "CompressionApi.h"
+#include "SpoolFile.h"
+#include "Client.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+
+namespace {
+std::string sendRaw(int port, const std::string& raw) {
+    Client client("127.0.0.1", port);
+    REQUIRE(client.connect());
+    REQUIRE(client.sendData(std::vector<char>(raw.begin(), raw.end())));
+    auto response = client.receiveData(16 << 20);
+    client.disconnect();
+    return std::string(response.begin(), response.end());
+}
+
+std::string post(const std::string& path, const std::string& body) {
+    return "POST " + path + " HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) +
+           "\r\nConnection: close\r\n\r\n" + body;
+}
+
+std::string postChunked(const std::string& path, const std::string& body) {
+    std::string raw = "POST " + path + " HTTP/1.1\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n";
+    for (size_t pos = 0; pos < body.size(); pos += 1000) {
+        const std::string piece = body.substr(pos, 1000);
+        char size[16];
+        std::snprintf(size, sizeof(size), "%zx\r\n", piece.size());
+        raw += size + piece + "\r\n";
+    }
+    return raw + "0\r\n\r\n";
+}
+
+std::string bodyOf(const std::string& response) {
+    const size_t end = response.find("\r\n\r\n");
+    REQUIRE(end != std::string::npos);
+    return response.substr(end + 4);
+}
+
+std::string pattern(size_t n) {
+    std::string s;
+    for (size_t i = 0; i < n; ++i) s.push_back(static_cast<char>('a' + (i / 7) % 26));
+    return s;
+}
+
+// Echoes the body and reports where it was kept.
+HttpResponse echo(const HttpRequest& req) {
+    HttpResponse res;
+    res.headers.set("X-Spooled", req.spooledBody ? "yes" : "no");
+    const std::string_view body = req.bodyView();
+    res.body.assign(body.begin(), body.end());
+    return res;
+}
+} // namespace
+
+TEST_CASE("SpoolFile appends, splices and maps its content", "[spool]") {
+    auto file = SpoolFile::create();
+    file->write("hello ", 6);
+#ifndef _WIN32
+    int fds[2];
+    REQUIRE(::pipe(fds) == 0);
+    REQUIRE(::write(fds[1], "spooled world", 13) == 13);
+    ::close(fds[1]);
+    REQUIRE(file->appendFrom(fds[0], 7) == 7);
+    REQUIRE(file->appendFrom(fds[0], 100) == 6); // short at EOF
+    ::close(fds[0]);
+    REQUIRE(file->map() == "hello spooled world");
+#else
+    file->write("spooled world", 13);
+    REQUIRE(file->map() == "hello spooled world");
+#endif
+    REQUIRE(file->size() == 19);
+    REQUIRE(file->view() == file->map());
+    REQUIRE_THROWS_AS(file->write("x", 1), std::logic_error);
+
+    REQUIRE(SpoolFile::create()->map().empty());
+}
+
+TEST_CASE("HttpServer spools bodies above the threshold", "[spool][http]") {
+    HttpServerOptions httpOptions;
+    httpOptions.spoolThreshold = 4096;
+    HttpServer server(9147, SocketOptions(), httpOptions);
+    server.setHandler(echo);
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const std::string small = pattern(1000);
+    const std::string large = pattern(300000);
+
+    std::string res = sendRaw(9147, post("/echo", small));
+    REQUIRE(res.find("X-Spooled: no\r\n") != std::string::npos);
+    REQUIRE(bodyOf(res) == small);
+
+    res = sendRaw(9147, post("/echo", large));
+    REQUIRE(res.find("X-Spooled: yes\r\n") != std::string::npos);
+    REQUIRE(bodyOf(res) == large);
+
+    res = sendRaw(9147, postChunked("/echo", small));
+    REQUIRE(res.find("X-Spooled: no\r\n") != std::string::npos);
+    REQUIRE(bodyOf(res) == small);
+
+    res = sendRaw(9147, postChunked("/echo", large));
+    REQUIRE(res.find("X-Spooled: yes\r\n") != std::string::npos);
+    REQUIRE(bodyOf(res) == large);
+
+    server.stop();
+}
+
+TEST_CASE("HttpServer spools every body once the memory budget is used up", "[spool][http]") {
+    HttpServerOptions httpOptions;
+    httpOptions.maxBufferedBodyBytes = 0;
+    HttpServer server(9148, SocketOptions(), httpOptions);
+    server.setHandler(echo);
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const std::string small = pattern(100);
+    std::string res = sendRaw(9148, post("/echo", small));
+    REQUIRE(res.find("X-Spooled: yes\r\n") != std::string::npos);
+    REQUIRE(bodyOf(res) == small);
+
+    res = sendRaw(9148, postChunked("/echo", small));
+    REQUIRE(res.find("X-Spooled: yes\r\n") != std::string::npos);
+    REQUIRE(bodyOf(res) == small);
+
+    server.stop();
+}
+
+TEST_CASE("CompressionApi answers spooled requests from a file", "[spool][api]") {
+    CompressionApi api;
+    HttpServerOptions httpOptions;
+    httpOptions.spoolThreshold = 4096;
+    HttpServer server(9149, SocketOptions(), httpOptions);
+    server.setHandler([&api](const HttpRequest& req) { return api.handle(req); });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const std::string input = pattern(500000);
+    const std::string compressed = bodyOf(sendRaw(9149, post("/compress", input)));
+    REQUIRE(compressed.size() < input.size() / 2);
+
+    // Decompress through the API directly to look at the response file.
+    auto file = SpoolFile::create();
+    file->write(compressed.data(), compressed.size());
+    const std::string_view mapped = file->map();
+    HttpRequest req;
+    req.method = "POST";
+    req.path = "/decompress";
+    req.version = "HTTP/1.1";
+    req.body = ByteBuffer(file, mapped.data(), mapped.size());
+    req.spooledBody = file;
+    const HttpResponse res = api.handle(req);
+    REQUIRE(res.statusCode == 200);
+    REQUIRE(res.bodyFile);
+    REQUIRE(res.body.empty());
+    REQUIRE(res.bodySize() == input.size());
+    REQUIRE(res.bodyFile->view() == input);
+    REQUIRE(!res.headers.get("ETag").empty());
+
+    // Same answer for the same bytes, buffered or spooled.
+    REQUIRE(bodyOf(sendRaw(9149, post("/decompress", compressed))) == input);
+
+    server.stop();
+}
+
+TEST_CASE("With http_server's wiring, large uploads are spooled and only chunked ones stream", "[spool][api]") {
+    // Default thresholds and CompressionApi::install, as http_server runs them.
+    CompressionApi api;
+    HttpServerOptions httpOptions;
+    REQUIRE(httpOptions.streamThreshold >= httpOptions.spoolThreshold);
+    HttpServer server(9168, SocketOptions(), httpOptions);
+    api.install(server);
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Above spoolThreshold, below streamThreshold: answered from a spool file with a
+    // Content-Length and an ETag, which a streamed response could not carry.
+    const std::string input(httpOptions.spoolThreshold + 4096, 'a');
+    const std::string response = sendRaw(9168, post("/compress", input));
+    REQUIRE(response.rfind("HTTP/1.1 200 OK\r\n", 0) == 0);
+    REQUIRE(response.find("\r\nContent-Length: ") != std::string::npos);
+    REQUIRE(response.find("\r\nETag: ") != std::string::npos);
+    const std::string compressed = bodyOf(response);
+    REQUIRE(bodyOf(sendRaw(9168, post("/decompress", compressed))) == input);
+
+    // Chunked uploads have no length to decide by and go to the stream handler.
+    const std::string chunked = sendRaw(9168, postChunked("/compress", pattern(200000)));
+    REQUIRE(chunked.rfind("HTTP/1.1 200 OK\r\n", 0) == 0);
+    REQUIRE(chunked.find("\r\nETag: ") == std::string::npos);
+
+    server.stop();
+}
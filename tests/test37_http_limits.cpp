@@ -0,0 +1,188 @@
+#include <catch2/catch_all.hpp>
+#include "HttpServer.h"
+#include "CompressionApi.h"
+#include "Client.h"
+#include "HttpTestUtil.h"
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+
+namespace {
+HttpResponse ok(const HttpRequest& req) {
+    HttpResponse res;
+    const std::string_view body = req.bodyView();
+    res.body.assign(body.begin(), body.end());
+    return res;
+}
+} // namespace
+
+TEST_CASE("HttpServer answers slow clients with 408", "[http][limits]") {
+    HttpServerOptions httpOptions;
+    httpOptions.headerTimeoutMs = 300;
+    httpOptions.bodyTimeoutMs = 300;
+    HttpServer server(9150, SocketOptions(), httpOptions);
+    server.setHandler(ok);
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Headers trickling in: the deadline covers the whole head, not each byte.
+    {
+        Client client("127.0.0.1", 9150);
+        REQUIRE(client.connect());
+        const auto start = std::chrono::steady_clock::now();
+        for (const char* part : {"GET / HTTP/1.1\r\n", "X-A: 1\r\n", "X-B: 2\r\n", "X-C: 3\r\n"}) {
+            const std::string s = part;
+            REQUIRE(client.sendData(std::vector<char>(s.begin(), s.end())));
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        const std::string response = receiveAll(client);
+        REQUIRE(startsWith(response, "HTTP/1.1 408 Request Timeout\r\n"));
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(3));
+    }
+
+    // A body that stops arriving.
+    {
+        Client client("127.0.0.1", 9150);
+        REQUIRE(client.connect());
+        const std::string raw = "POST /x HTTP/1.1\r\nContent-Length: 100\r\n\r\nonly a few bytes";
+        REQUIRE(client.sendData(std::vector<char>(raw.begin(), raw.end())));
+        REQUIRE(startsWith(receiveAll(client), "HTTP/1.1 408 Request Timeout\r\n"));
+    }
+
+    // Well-behaved clients are unaffected.
+    REQUIRE(startsWith(sendRaw(9150, "GET / HTTP/1.1\r\nConnection: close\r\n\r\n"), "HTTP/1.1 200 OK\r\n"));
+    server.stop();
+}
+
+TEST_CASE("HttpServer enforces per-route size limits", "[http][limits]") {
+    HttpServerOptions httpOptions;
+    HttpRouteLimits upload;
+    upload.path = "/upload/";
+    upload.maxBodyBytes = 16;
+    HttpRouteLimits tiny;
+    tiny.path = "/tiny";
+    tiny.maxHeaderBytes = 64;
+    httpOptions.routeLimits = {upload, tiny};
+    HttpServer server(9151, SocketOptions(), httpOptions);
+    server.setHandler(ok);
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Declared too large: refused from the head alone, the body is never needed.
+    REQUIRE(startsWith(sendRaw(9151, "POST /upload/a HTTP/1.1\r\nContent-Length: 100\r\n\r\n"),
+                       "HTTP/1.1 413 Payload Too Large\r\n"));
+    REQUIRE(startsWith(sendRaw(9151, "POST /upload/a HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                                     "a\r\n0123456789\r\na\r\n0123456789\r\n0\r\n\r\n"),
+                       "HTTP/1.1 413 Payload Too Large\r\n"));
+    REQUIRE(startsWith(sendRaw(9151, "POST /upload/a HTTP/1.1\r\nContent-Length: 16\r\nConnection: close\r\n\r\n"
+                                     "0123456789abcdef"),
+                       "HTTP/1.1 200 OK\r\n"));
+    // Other routes keep the server-wide (unlimited) body size.
+    REQUIRE(startsWith(sendRaw(9151, "POST /other HTTP/1.1\r\nContent-Length: 100\r\nConnection: close\r\n\r\n" +
+                                         std::string(100, 'x')),
+                       "HTTP/1.1 200 OK\r\n"));
+
+    const std::string bigHeader = "X-Padding: " + std::string(100, 'p') + "\r\n";
+    REQUIRE(startsWith(sendRaw(9151, "GET /tiny HTTP/1.1\r\n" + bigHeader + "\r\n"),
+                       "HTTP/1.1 431 Request Header Fields Too Large\r\n"));
+    REQUIRE(startsWith(sendRaw(9151, "GET /big HTTP/1.1\r\n" + bigHeader + "Connection: close\r\n\r\n"),
+                       "HTTP/1.1 200 OK\r\n"));
+    server.stop();
+}
+
+TEST_CASE("HttpServer sheds load beyond the in-flight byte budget with 503", "[http][limits]") {
+    HttpServerOptions httpOptions;
+    httpOptions.maxInFlightBytes = 1000;
+    httpOptions.retryAfterSeconds = 7;
+    HttpServer server(9152, SocketOptions(), httpOptions);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    server.setHandler([released](const HttpRequest& req) {
+        if (req.path == "/hold") released.wait();
+        return ok(req);
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Never fits: 413, not a retry hint.
+    REQUIRE(startsWith(sendRaw(9152, "POST /x HTTP/1.1\r\nContent-Length: 5000\r\n\r\n"),
+                       "HTTP/1.1 413 Payload Too Large\r\n"));
+
+    // A held request pins 600 bytes of budget; a second one of the same size must wait.
+    auto held = std::async(std::launch::async, []() {
+        return sendRaw(9152, "POST /hold HTTP/1.1\r\nContent-Length: 600\r\nConnection: close\r\n\r\n" +
+                                 std::string(600, 'h'));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    const std::string busy = sendRaw(9152, "POST /x HTTP/1.1\r\nContent-Length: 600\r\n\r\n" + std::string(600, 'x'));
+    REQUIRE(startsWith(busy, "HTTP/1.1 503 Service Unavailable\r\n"));
+    REQUIRE(busy.find("Retry-After: 7\r\n") != std::string::npos);
+
+    release.set_value();
+    REQUIRE(startsWith(held.get(), "HTTP/1.1 200 OK\r\n"));
+    // The budget is returned once the request is done.
+    REQUIRE(startsWith(sendRaw(9152, "POST /x HTTP/1.1\r\nContent-Length: 600\r\nConnection: close\r\n\r\n" +
+                                         std::string(600, 'x')),
+                       "HTTP/1.1 200 OK\r\n"));
+    server.stop();
+}
+
+TEST_CASE("HttpServer refuses connections beyond maxConnections with 503", "[http][limits]") {
+    HttpServerOptions httpOptions;
+    httpOptions.maxConnections = 1;
+    HttpServer server(9153, SocketOptions(), httpOptions);
+    server.setHandler(ok);
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    Client first("127.0.0.1", 9153);
+    REQUIRE(first.connect());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const std::string refused = sendRaw(9153, "GET / HTTP/1.1\r\n\r\n");
+    REQUIRE(startsWith(refused, "HTTP/1.1 503 Service Unavailable\r\n"));
+    REQUIRE(refused.find("Retry-After: 1\r\n") != std::string::npos);
+
+    first.disconnect();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    REQUIRE(startsWith(sendRaw(9153, "GET / HTTP/1.1\r\nConnection: close\r\n\r\n"), "HTTP/1.1 200 OK\r\n"));
+    server.stop();
+}
+
+TEST_CASE("Requests the server refuses show up in /metrics", "[http][limits][metrics]") {
+    CompressionApi api;
+    HttpServerOptions httpOptions;
+    httpOptions.headerTimeoutMs = 300;
+    httpOptions.maxBodyBytes = 1024;
+    httpOptions.routeLimits.push_back({"/decompress", 128, 0});
+    HttpServer server(9169, SocketOptions(), httpOptions);
+    api.install(server);
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const auto requests = [](const std::string& endpoint, int code) {
+        const std::string scrape = sendRaw(9169, "GET /metrics HTTP/1.1\r\nConnection: close\r\n\r\n");
+        const std::string series =
+            "\ncompressor_http_requests_total{endpoint=\"" + endpoint + "\",code=\"" + std::to_string(code) + "\"} ";
+        REQUIRE(startsWith(scrape, "HTTP/1.1 200 OK\r\n"));
+        const size_t at = scrape.find(series);
+        return at == std::string::npos ? 0LL : std::stoll(scrape.substr(at + series.size())); // unset = 0
+    };
+    const long long timedOut = requests("other", 408);
+    const long long tooLarge = requests("compress", 413);
+    const long long headersTooLarge = requests("decompress", 431);
+
+    // The head never completes, so the path is unknown.
+    REQUIRE(startsWith(sendRaw(9169, "POST /compress HTTP/1.1\r\n"), "HTTP/1.1 408 "));
+    REQUIRE(startsWith(sendRaw(9169, "POST /compress HTTP/1.1\r\nContent-Length: 4096\r\n\r\n"), "HTTP/1.1 413 "));
+    REQUIRE(startsWith(sendRaw(9169, "POST /decompress HTTP/1.1\r\nX-Padding: " + std::string(200, 'p') + "\r\n\r\n"),
+                       "HTTP/1.1 431 "));
+
+    REQUIRE(requests("other", 408) == timedOut + 1);
+    REQUIRE(requests("compress", 413) == tooLarge + 1);
+    REQUIRE(requests("decompress", 431) == headersTooLarge + 1);
+
+    server.stop();
+}
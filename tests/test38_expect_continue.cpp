@@ -0,0 +1,115 @@
+#include <catch2/catch_all.hpp>
+#include "HttpServer.h"
+#include "CompressionApi.h"
+#include "Client.h"
+#include "HttpTestUtil.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace {
+const std::string kContinue = "HTTP/1.1 100 Continue\r\n\r\n";
+
+void sendString(Client& client, const std::string& s) {
+    REQUIRE(client.sendData(std::vector<char>(s.begin(), s.end())));
+}
+} // namespace
+
+TEST_CASE("HttpServer answers Expect: 100-continue before reading the body", "[http][expect]") {
+    HttpServer server(9154);
+    server.setHandler([](const HttpRequest& req) {
+        HttpResponse res;
+        res.sharedBody = req.body;
+        return res;
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    Client client("127.0.0.1", 9154);
+    REQUIRE(client.connect());
+    const auto start = std::chrono::steady_clock::now();
+    sendString(client, "POST /echo HTTP/1.1\r\nContent-Length: 5\r\nExpect: 100-continue\r\n\r\n");
+    std::string interim(kContinue.size(), '\0');
+    REQUIRE(client.receiveInto(&interim[0], interim.size()));
+    REQUIRE(interim == kContinue);
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+
+    // The connection stays usable: the final response follows, then the next request.
+    sendString(client, "hello");
+    sendString(client, "POST /echo HTTP/1.1\r\nContent-Length: 2\r\nConnection: close\r\n\r\nhi");
+    const std::string rest = receiveAll(client);
+    REQUIRE(startsWith(rest, "HTTP/1.1 200 OK\r\n"));
+    REQUIRE(rest.find("\r\n\r\nhello") != std::string::npos);
+    REQUIRE(rest.substr(rest.size() - 2) == "hi");
+    client.disconnect();
+
+    // No 100 when the body is already there.
+    Client eager("127.0.0.1", 9154);
+    REQUIRE(eager.connect());
+    sendString(eager, "POST /echo HTTP/1.1\r\nContent-Length: 3\r\nExpect: 100-continue\r\nConnection: close\r\n\r\nabc");
+    REQUIRE(startsWith(receiveAll(eager), "HTTP/1.1 200 OK\r\n"));
+    eager.disconnect();
+
+    Client unknown("127.0.0.1", 9154);
+    REQUIRE(unknown.connect());
+    sendString(unknown, "POST /echo HTTP/1.1\r\nContent-Length: 3\r\nExpect: magic\r\n\r\n");
+    REQUIRE(startsWith(receiveAll(unknown), "HTTP/1.1 417 Expectation Failed\r\n"));
+    unknown.disconnect();
+
+    server.stop();
+}
+
+TEST_CASE("Unacceptable uploads are refused before the body is sent", "[http][expect]") {
+    CompressionApi api;
+    HttpServerOptions httpOptions;
+    httpOptions.maxBodyBytes = 1000;
+    HttpServer server(9155, SocketOptions(), httpOptions);
+    server.setHandler([&api](const HttpRequest& req) { return api.handle(req); });
+    server.setPreflightHandler([&api](const HttpRequest& req, HttpResponse& rejection) {
+        return api.preflight(req, rejection);
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const auto refusedWith = [](const std::string& head) {
+        Client client("127.0.0.1", 9155);
+        REQUIRE(client.connect());
+        sendString(client, head);
+        const std::string response = receiveAll(client); // server closes: no body expected
+        client.disconnect();
+        REQUIRE(!startsWith(response, kContinue));
+        return response;
+    };
+    REQUIRE(startsWith(refusedWith("POST /nope HTTP/1.1\r\nContent-Length: 100\r\nExpect: 100-continue\r\n\r\n"),
+                       "HTTP/1.1 404 Not Found\r\n"));
+    REQUIRE(startsWith(refusedWith("PUT /compress HTTP/1.1\r\nContent-Length: 100\r\nExpect: 100-continue\r\n\r\n"),
+                       "HTTP/1.1 405 Method Not Allowed\r\n"));
+    REQUIRE(startsWith(refusedWith("POST /compress?algorithm=zip HTTP/1.1\r\nContent-Length: 100\r\n"
+                                   "Expect: 100-continue\r\n\r\n"),
+                       "HTTP/1.1 400 Bad Request\r\n"));
+    REQUIRE(startsWith(refusedWith("POST /compress HTTP/1.1\r\nContent-Length: 5000\r\nExpect: 100-continue\r\n\r\n"),
+                       "HTTP/1.1 413 Payload Too Large\r\n"));
+
+    // Bodiless refusals keep the connection open.
+    Client client("127.0.0.1", 9155);
+    REQUIRE(client.connect());
+    sendString(client, "DELETE /compress HTTP/1.1\r\n\r\nGET /health HTTP/1.1\r\nConnection: close\r\n\r\n");
+    const std::string both = receiveAll(client);
+    REQUIRE(startsWith(both, "HTTP/1.1 405 Method Not Allowed\r\n"));
+    REQUIRE(both.find("HTTP/1.1 200 OK\r\n") != std::string::npos);
+    client.disconnect();
+
+    // Accepted uploads go through as before.
+    Client upload("127.0.0.1", 9155);
+    REQUIRE(upload.connect());
+    sendString(upload, "POST /compress HTTP/1.1\r\nContent-Length: 4\r\nExpect: 100-continue\r\nConnection: close\r\n\r\n");
+    std::string interim(kContinue.size(), '\0');
+    REQUIRE(upload.receiveInto(&interim[0], interim.size()));
+    REQUIRE(interim == kContinue);
+    sendString(upload, "aaaa");
+    REQUIRE(startsWith(receiveAll(upload), "HTTP/1.1 200 OK\r\n"));
+    upload.disconnect();
+
+    server.stop();
+}
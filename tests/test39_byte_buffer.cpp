@@ -0,0 +1,78 @@
+#include <catch2/catch_all.hpp>
+#include "ByteBuffer.h"
+#include "AdaptiveCompression.h"
+#include "ResultCache.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST_CASE("ByteBuffer adopts vectors and slices without copying", "[buffer]") {
+    std::vector<char> bytes{'h', 'e', 'l', 'l', 'o', ' ', 'w', 'o', 'r', 'l', 'd'};
+    const char* original = bytes.data();
+    const ByteBuffer whole(std::move(bytes));
+    REQUIRE(whole.data() == original);
+    REQUIRE(whole.view() == "hello world");
+
+    const ByteBuffer world = whole.slice(6);
+    REQUIRE(world.data() == original + 6);
+    REQUIRE(world.view() == "world");
+    REQUIRE(whole.slice(0, 5).view() == "hello");
+    REQUIRE(world.slice(1, 100).view() == "orld"); // clamped to the end
+    REQUIRE(whole.slice(whole.size()).empty());
+    REQUIRE_THROWS_AS(whole.slice(whole.size() + 1), std::out_of_range);
+
+    // Slices keep the chunk alive on their own.
+    ByteBuffer survivor;
+    {
+        const ByteBuffer temp = ByteBuffer::copyOf(std::string("temporary"));
+        survivor = temp.slice(4);
+    }
+    REQUIRE(survivor.view() == "orary");
+    REQUIRE(survivor == ByteBuffer::copyOf(std::string("orary")));
+    REQUIRE(std::string(survivor.begin(), survivor.end()) == "orary");
+}
+
+TEST_CASE("ByteBuffer::compact copies only small slices of large chunks", "[buffer]") {
+    const ByteBuffer big(std::vector<char>(1000, 'x'));
+    const ByteBuffer most = big.slice(1);
+    REQUIRE(most.compact().data() == most.data());
+    const ByteBuffer little = big.slice(10, 20);
+    const ByteBuffer copy = little.compact();
+    REQUIRE(copy.data() != little.data());
+    REQUIRE(copy == little);
+}
+
+TEST_CASE("AdaptiveCompression strips the identity tag in O(1)", "[buffer][adaptive]") {
+    AdaptiveCompression algo;
+    const std::string noisy = "abcdefghij";
+    const ByteBuffer packed(algo.compress(std::vector<char>(noisy.begin(), noisy.end())));
+    REQUIRE(packed[0] == 'I');
+    const ByteBuffer unpacked = algo.decompress(packed);
+    REQUIRE(unpacked.data() == packed.data() + 1);
+    REQUIRE(unpacked.view() == noisy);
+
+    const std::string runs(300, 'r');
+    const ByteBuffer rle(algo.compress(runs.data(), runs.size()));
+    REQUIRE(rle[0] == 'R');
+    REQUIRE(algo.decompress(rle).view() == runs);
+    REQUIRE(algo.decompress(ByteBuffer()).empty());
+    REQUIRE_THROWS_AS(algo.decompress(ByteBuffer::copyOf(std::string("?x"))), std::runtime_error);
+}
+
+TEST_CASE("ResultCache shares cached bytes and does not pin large chunks", "[buffer][cache]") {
+    ResultCache cache(1 << 20);
+    const ResultCache::Key key = ResultCache::keyFor("v", "k", 1);
+
+    const ByteBuffer value = ByteBuffer::copyOf(std::string("cached result"));
+    cache.put(key, value);
+    const ResultCache::Value hit = cache.get(key);
+    REQUIRE(hit != nullptr);
+    REQUIRE(hit->data() == value.data());
+    REQUIRE(cache.get(key)->data() == hit->data()); // every hit, same bytes
+
+    const ByteBuffer request(std::vector<char>(100000, 'q'));
+    cache.put(key, request.slice(5, 10));
+    REQUIRE(cache.get(key)->data() != request.data() + 5);
+    REQUIRE(cache.get(key)->view() == std::string(10, 'q'));
+}
@@ -0,0 +1,169 @@
+#include <catch2/catch_all.hpp>
+#include "HttpServer.h"
+#include "ZeroCopySender.h"
+#include "Client.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <sys/socket.h>
+#  include <unistd.h>
+#endif
+
+namespace {
+std::string pattern(size_t n) {
+    std::string s;
+    for (size_t i = 0; i < n; ++i) s.push_back(static_cast<char>('a' + (i / 11) % 26));
+    return s;
+}
+
+std::string bodyOf(const std::string& response, size_t from = 0) {
+    const size_t end = response.find("\r\n\r\n", from);
+    REQUIRE(end != std::string::npos);
+    return response.substr(end + 4);
+}
+} // namespace
+
+TEST_CASE("ZeroCopySender delivers the bytes and releases buffers on completion", "[zerocopy]") {
+#if defined(__linux__)
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(listener >= 0);
+    const int one = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(9156);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    REQUIRE(::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    REQUIRE(::listen(listener, 1) == 0);
+    const int sender = ::socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(::connect(sender, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    const int receiver = ::accept(listener, nullptr, nullptr);
+    REQUIRE(receiver >= 0);
+
+    const std::string head = "HEAD:";
+    const std::string payload = pattern(4 << 20);
+    std::string received;
+    std::thread reader([&]() {
+        char buf[65536];
+        ssize_t n;
+        while ((n = ::recv(receiver, buf, sizeof(buf), 0)) > 0) received.append(buf, static_cast<size_t>(n));
+    });
+
+    {
+        ZeroCopySender zc(sender);
+        if (zc.enabled()) {
+            REQUIRE(zc.send(head, ByteBuffer::copyOf(payload)));
+            REQUIRE(zc.pending() == 1);
+            REQUIRE(zc.pendingBytes() == head.size() + payload.size());
+        } else {
+            REQUIRE(zc.send(head, ByteBuffer::copyOf(payload))); // copying fallback
+        }
+        REQUIRE(zc.reap(2000) == 0);
+        REQUIRE(zc.pendingBytes() == 0);
+        // Small and empty bodies go through the same call.
+        REQUIRE(zc.send("tail", ByteBuffer()));
+    }
+    ::shutdown(sender, SHUT_WR);
+    reader.join();
+    REQUIRE(received == head + payload + "tail");
+
+    ::close(sender);
+    ::close(receiver);
+    ::close(listener);
+#else
+    SUCCEED("MSG_ZEROCOPY is Linux-only");
+#endif
+}
+
+TEST_CASE("HttpServer sends large bodies through the zero-copy path", "[zerocopy][http]") {
+    const std::string large = pattern(1 << 20);
+    HttpServerOptions httpOptions;
+    httpOptions.zeroCopyThreshold = 64 * 1024;
+    HttpServer server(9157, SocketOptions(), httpOptions);
+    server.setHandler([&large](const HttpRequest& req) {
+        HttpResponse res;
+        if (req.path == "/shared") {
+            res.sharedBody = ByteBuffer::copyOf(large);
+        } else if (req.path == "/small") {
+            res.body.assign(large.begin(), large.begin() + 100);
+        } else {
+            res.body.assign(large.begin(), large.end());
+        }
+        return res;
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Pipelined on one connection: the sender outlives a response and may switch itself off.
+    const std::string raw = "GET /vector HTTP/1.1\r\n\r\n"
+                            "GET /small HTTP/1.1\r\n\r\n"
+                            "GET /shared HTTP/1.1\r\nConnection: close\r\n\r\n";
+    Client client("127.0.0.1", 9157);
+    REQUIRE(client.connect());
+    REQUIRE(client.sendData(std::vector<char>(raw.begin(), raw.end())));
+    const auto bytes = client.receiveData(8 << 20);
+    client.disconnect();
+    const std::string response(bytes.begin(), bytes.end());
+
+    const std::string first = bodyOf(response);
+    REQUIRE(first.compare(0, large.size(), large) == 0);
+    const std::string second = bodyOf(first.substr(large.size()));
+    REQUIRE(second.compare(0, 100, large, 0, 100) == 0);
+    REQUIRE(bodyOf(second.substr(100)) == large);
+
+    server.stop();
+}
+
+TEST_CASE("HttpServer sends streamed responses through the zero-copy path", "[zerocopy][http][stream]") {
+    const std::string large = pattern(1 << 20);
+    HttpServerOptions httpOptions;
+    httpOptions.zeroCopyThreshold = 256 * 1024;
+    httpOptions.streamThreshold = 1;
+    HttpServer server(9170, SocketOptions(), httpOptions);
+    server.setHandler([](const HttpRequest&) { return HttpResponse(); });
+    server.setStreamHandler([&large](const HttpRequest&, HttpBodyReader& in, HttpResponseWriter& out) {
+        char buf[256];
+        while (in.read(buf, sizeof(buf)) > 0) {
+        }
+        out.start(HttpResponse());
+        for (size_t at = 0; at < large.size(); at += 4096) out.write(large.data() + at, 4096);
+        out.finish();
+        return true;
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const std::string raw = "POST /stream HTTP/1.1\r\nContent-Length: 5\r\nConnection: close\r\n\r\nhello";
+    Client client("127.0.0.1", 9170);
+    REQUIRE(client.connect());
+    REQUIRE(client.sendData(std::vector<char>(raw.begin(), raw.end())));
+    const auto bytes = client.receiveData(8 << 20);
+    client.disconnect();
+    server.stop();
+    const std::string response(bytes.begin(), bytes.end());
+    REQUIRE(response.find("Transfer-Encoding: chunked\r\n") != std::string::npos);
+
+    // Gathered into chunks of at least the threshold, the 4 KiB writes arrive intact.
+    std::string chunks = bodyOf(response);
+    std::string decoded;
+    size_t at = 0;
+    bool first = true;
+    for (;;) {
+        const size_t lineEnd = chunks.find("\r\n", at);
+        REQUIRE(lineEnd != std::string::npos);
+        const size_t size = std::stoul(chunks.substr(at, lineEnd - at), nullptr, 16);
+        if (first) REQUIRE(size >= httpOptions.zeroCopyThreshold);
+        first = false;
+        if (size == 0) break;
+        decoded.append(chunks, lineEnd + 2, size);
+        REQUIRE(chunks.compare(lineEnd + 2 + size, 2, "\r\n") == 0);
+        at = lineEnd + 4 + size;
+    }
+    REQUIRE(decoded == large);
+}
@@ -0,0 +1,264 @@
+#include <catch2/catch_all.hpp>
+#include "Hpack.h"
+#include "HttpServer.h"
+#include "Client.h"
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+
+namespace {
+std::string unhex(const std::string& hex) {
+    std::string out;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        out.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+    }
+    return out;
+}
+
+std::string frame(uint8_t type, uint8_t flags, uint32_t id, const std::string& payload) {
+    std::string out;
+    const size_t len = payload.size();
+    for (int shift : {16, 8, 0}) out.push_back(static_cast<char>(len >> shift));
+    out.push_back(static_cast<char>(type));
+    out.push_back(static_cast<char>(flags));
+    for (int shift : {24, 16, 8, 0}) out.push_back(static_cast<char>(id >> shift));
+    return out + payload;
+}
+
+struct Frame {
+    uint8_t type;
+    uint8_t flags;
+    uint32_t id;
+    std::string payload;
+};
+
+Frame readFrame(Client& client) {
+    char head[9];
+    REQUIRE(client.receiveInto(head, sizeof(head)));
+    const auto* b = reinterpret_cast<const uint8_t*>(head);
+    Frame f{b[3], b[4], ((uint32_t{b[5]} << 24) | (uint32_t{b[6]} << 16) | (uint32_t{b[7]} << 8) | b[8]) & 0x7FFFFFFF, ""};
+    f.payload.resize((size_t{b[0]} << 16) | (size_t{b[1]} << 8) | b[2]);
+    if (!f.payload.empty()) REQUIRE(client.receiveInto(&f.payload[0], f.payload.size()));
+    return f;
+}
+
+void sendAll(Client& client, const std::string& bytes) {
+    REQUIRE(client.sendData(std::vector<char>(bytes.begin(), bytes.end())));
+}
+
+struct StreamResult {
+    std::string status;
+    std::string body;
+    uint32_t resetCode = UINT32_MAX;
+};
+
+// Reads frames until `streams` streams have ended (END_STREAM or RST_STREAM).
+std::map<uint32_t, StreamResult> readResponses(Client& client, size_t streams) {
+    HpackDecoder decoder;
+    std::map<uint32_t, StreamResult> results;
+    size_t ended = 0;
+    while (ended < streams) {
+        const Frame f = readFrame(client);
+        if (f.type == 0x1) { // HEADERS; small blocks need no CONTINUATION
+            HttpHeaders headers;
+            REQUIRE(decoder.decode(f.payload.data(), f.payload.size(), headers, 65536));
+            results[f.id].status = std::string(headers.get(":status"));
+        } else if (f.type == 0x0) {
+            results[f.id].body += f.payload;
+        } else if (f.type == 0x3) {
+            const auto* code = reinterpret_cast<const uint8_t*>(f.payload.data());
+            results[f.id].resetCode = (uint32_t{code[0]} << 24) | (uint32_t{code[1]} << 16) | (uint32_t{code[2]} << 8) | code[3];
+            ++ended;
+            continue;
+        } else if (f.type == 0x7) {
+            FAIL("unexpected GOAWAY");
+        }
+        if ((f.type == 0x0 || f.type == 0x1) && (f.flags & 0x1)) ++ended;
+    }
+    return results;
+}
+
+std::string requestBlock(HpackEncoder& encoder, const std::string& method, const std::string& path) {
+    std::string block;
+    encoder.beginBlock(block);
+    encoder.add(":method", method, block);
+    encoder.add(":scheme", "http", block);
+    encoder.add(":path", path, block);
+    encoder.add(":authority", "localhost", block);
+    return block;
+}
+
+HttpResponse echo(const HttpRequest& req) {
+    HttpResponse res;
+    res.headers.set("X-Version", req.version);
+    const std::string_view body = req.bodyView();
+    res.body.assign(body.begin(), body.end());
+    if (req.path == "/slow") std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    return res;
+}
+
+const std::string kPreface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+std::string fieldsOf(const HttpHeaders& headers) {
+    std::string out;
+    for (const auto field : headers) {
+        out += std::string(field.first) + ": " + std::string(field.second) + "\n";
+    }
+    return out;
+}
+} // namespace
+
+TEST_CASE("HPACK Huffman code round-trips and matches RFC 7541 C.4.1", "[hpack]") {
+    std::string encoded;
+    HpackHuffman::encode("www.example.com", encoded);
+    REQUIRE(encoded == unhex("f1e3c2e5f23a6ba0ab90f4ff"));
+    std::string decoded;
+    REQUIRE(HpackHuffman::decode(encoded.data(), encoded.size(), decoded));
+    REQUIRE(decoded == "www.example.com");
+
+    std::string all;
+    for (int c = 0; c < 256; ++c) all.push_back(static_cast<char>(c));
+    encoded.clear();
+    decoded.clear();
+    HpackHuffman::encode(all, encoded);
+    REQUIRE(encoded.size() == HpackHuffman::encodedSize(all));
+    REQUIRE(HpackHuffman::decode(encoded.data(), encoded.size(), decoded));
+    REQUIRE(decoded == all);
+
+    // Padding must be a short run of ones.
+    const std::string badPadding = unhex("f1e3c2e5f23a6ba0ab90f400");
+    REQUIRE_FALSE(HpackHuffman::decode(badPadding.data(), badPadding.size(), decoded));
+}
+
+TEST_CASE("HpackDecoder decodes the RFC 7541 C.4 request sequence", "[hpack]") {
+    HpackDecoder decoder;
+    const std::string blocks[] = {unhex("828684418cf1e3c2e5f23a6ba0ab90f4ff"), unhex("828684be5886a8eb10649cbf"),
+                                  unhex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf")};
+    const std::string expected[] = {
+        ":method: GET\n:scheme: http\n:path: /\n:authority: www.example.com\n",
+        ":method: GET\n:scheme: http\n:path: /\n:authority: www.example.com\ncache-control: no-cache\n",
+        ":method: GET\n:scheme: https\n:path: /index.html\n:authority: www.example.com\ncustom-key: custom-value\n"};
+    for (int i = 0; i < 3; ++i) {
+        HttpHeaders headers;
+        REQUIRE(decoder.decode(blocks[i].data(), blocks[i].size(), headers, 65536));
+        REQUIRE(fieldsOf(headers) == expected[i]);
+    }
+
+    HttpHeaders headers;
+    const std::string badIndex = unhex("ff00"); // index 127: no such entry
+    REQUIRE_THROWS_AS(decoder.decode(badIndex.data(), badIndex.size(), headers, 65536), std::runtime_error);
+    const std::string truncated = unhex("418c");
+    REQUIRE_THROWS_AS(decoder.decode(truncated.data(), truncated.size(), headers, 65536), std::runtime_error);
+}
+
+TEST_CASE("HpackEncoder output decodes back, reusing the dynamic table", "[hpack]") {
+    HpackEncoder encoder;
+    HpackDecoder decoder;
+    size_t firstSize = 0;
+    for (int round = 0; round < 3; ++round) {
+        if (round == 2) encoder.setMaxTableSize(0); // peer shrinks its table
+        std::string block;
+        encoder.beginBlock(block);
+        encoder.add(":status", "200", block);
+        encoder.add("content-type", "application/octet-stream", block);
+        encoder.add("x-compression-algorithm", "rle", block);
+        encoder.add("content-length", std::to_string(1000 + round), block);
+        if (round == 0) firstSize = block.size();
+        if (round == 1) REQUIRE(block.size() < firstSize / 2);
+
+        HttpHeaders headers;
+        REQUIRE(decoder.decode(block.data(), block.size(), headers, 65536));
+        REQUIRE(fieldsOf(headers) == ":status: 200\ncontent-type: application/octet-stream\n"
+                                     "x-compression-algorithm: rle\ncontent-length: " +
+                                         std::to_string(1000 + round) + "\n");
+    }
+
+    // Over the list size limit: still decoded (table stays in sync), fields dropped.
+    std::string block;
+    encoder.beginBlock(block);
+    encoder.add("x-big", std::string(200, 'x'), block);
+    HttpHeaders headers;
+    REQUIRE_FALSE(decoder.decode(block.data(), block.size(), headers, 100));
+    REQUIRE(headers.empty());
+}
+
+TEST_CASE("HttpServer multiplexes h2c streams with prior knowledge", "[http2][http]") {
+    HttpServer server(9158, SocketOptions(), HttpServerOptions());
+    server.setHandler(echo);
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    Client client("127.0.0.1", 9158);
+    REQUIRE(client.connect());
+    HpackEncoder encoder;
+    std::string out = kPreface + frame(0x4, 0, 0, "");
+    const uint32_t kStreams = 100;
+    for (uint32_t id = 1; id < 2 * kStreams; id += 2) {
+        out += frame(0x1, 0x4, id, requestBlock(encoder, "POST", "/echo"));
+        out += frame(0x0, 0x1, id, "payload of stream " + std::to_string(id));
+    }
+    out += frame(0x6, 0, 0, "pingpong");
+    sendAll(client, out);
+
+    const auto results = readResponses(client, kStreams);
+    REQUIRE(results.size() == kStreams);
+    for (const auto& entry : results) {
+        REQUIRE(entry.second.status == "200");
+        REQUIRE(entry.second.body == "payload of stream " + std::to_string(entry.first));
+    }
+    client.disconnect();
+    server.stop();
+}
+
+TEST_CASE("HttpServer refuses h2c streams beyond the concurrency limit", "[http2][http]") {
+    HttpServerOptions httpOptions;
+    httpOptions.http2MaxStreams = 2;
+    HttpServer server(9159, SocketOptions(), httpOptions);
+    server.setHandler(echo);
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    Client client("127.0.0.1", 9159);
+    REQUIRE(client.connect());
+    HpackEncoder encoder;
+    std::string out = kPreface + frame(0x4, 0, 0, "");
+    for (uint32_t id = 1; id <= 7; id += 2) {
+        out += frame(0x1, 0x5, id, requestBlock(encoder, "GET", "/slow"));
+    }
+    sendAll(client, out);
+
+    const auto results = readResponses(client, 4);
+    REQUIRE(results.at(1).status == "200");
+    REQUIRE(results.at(3).status == "200");
+    REQUIRE(results.at(5).resetCode == 0x7); // REFUSED_STREAM: safe to retry
+    REQUIRE(results.at(7).resetCode == 0x7);
+    client.disconnect();
+    server.stop();
+}
+
+TEST_CASE("HttpServer upgrades HTTP/1.1 to h2c and answers on stream 1", "[http2][http]") {
+    HttpServer server(9160, SocketOptions(), HttpServerOptions());
+    server.setHandler(echo);
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    Client client("127.0.0.1", 9160);
+    REQUIRE(client.connect());
+    sendAll(client, "POST /echo HTTP/1.1\r\nHost: localhost\r\nConnection: Upgrade, HTTP2-Settings\r\n"
+                    "Upgrade: h2c\r\nHTTP2-Settings: AAMAAABkAAQAAP__\r\nContent-Length: 5\r\n\r\nhello");
+    const std::string expected = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+    std::string head(expected.size(), '\0');
+    REQUIRE(client.receiveInto(&head[0], head.size()));
+    REQUIRE(head == expected);
+
+    HpackEncoder encoder;
+    sendAll(client, kPreface + frame(0x4, 0, 0, "") + frame(0x1, 0x5, 3, requestBlock(encoder, "GET", "/echo")));
+    const auto results = readResponses(client, 2);
+    REQUIRE(results.at(1).status == "200");
+    REQUIRE(results.at(1).body == "hello");
+    REQUIRE(results.at(3).status == "200");
+    client.disconnect();
+    server.stop();
+}
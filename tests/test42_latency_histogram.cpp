@@ -0,0 +1,46 @@
+#include <catch2/catch_all.hpp>
+#include "LatencyHistogram.h"
+
+#include <cstdint>
+
+TEST_CASE("LatencyHistogram counts small values exactly", "[histogram]") {
+    LatencyHistogram h;
+    REQUIRE(h.count() == 0);
+    REQUIRE(h.percentile(50) == 0);
+    for (uint64_t v = 1; v <= 100; ++v) h.record(v);
+    REQUIRE(h.count() == 100);
+    REQUIRE(h.min() == 1);
+    REQUIRE(h.max() == 100);
+    REQUIRE(h.mean() == 50.5);
+    REQUIRE(h.percentile(50) == 50);
+    REQUIRE(h.percentile(90) == 90);
+    REQUIRE(h.percentile(99.9) == 100);
+    REQUIRE(h.percentile(100) == 100);
+}
+
+TEST_CASE("LatencyHistogram keeps large values within 1% and merges", "[histogram]") {
+    LatencyHistogram fast;
+    LatencyHistogram slow;
+    for (int i = 0; i < 990; ++i) fast.record(250000);      // 250 us
+    slow.record(40000000, 10);                              // 40 ms, ten times
+    slow.record(UINT64_MAX);
+
+    LatencyHistogram all;
+    all.merge(fast);
+    all.merge(slow);
+    REQUIRE(all.count() == 1001);
+    REQUIRE(all.min() == 250000);
+    REQUIRE(all.max() == UINT64_MAX);
+
+    const uint64_t p50 = all.percentile(50);
+    REQUIRE(p50 >= 250000);
+    REQUIRE(p50 <= 250000 + 250000 / LatencyHistogram::kSubBuckets);
+    const uint64_t p99 = all.percentile(99);
+    REQUIRE(p99 >= 40000000);
+    REQUIRE(p99 <= 40000000 + 40000000 / LatencyHistogram::kSubBuckets);
+    REQUIRE(all.percentile(100) == UINT64_MAX);
+
+    all.reset();
+    REQUIRE(all.count() == 0);
+    REQUIRE(all.max() == 0);
+}
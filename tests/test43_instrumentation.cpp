@@ -0,0 +1,93 @@
+#include <catch2/catch_all.hpp>
+#include "CompressionApi.h"
+#include "HttpServer.h"
+#include "Instrumentation.h"
+#include "Client.h"
+#include "HttpTestUtil.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Meaningful in builds configured with -DCOMPRESSION_INSTRUMENTATION=ON; elsewhere the
+// counters are compiled out and only the endpoint's "disabled" answer is checked.
+
+TEST_CASE("Instrumentation attributes a thread's allocations and copies to its scope", "[instrumentation]") {
+    if (!Instrumentation::enabled()) {
+        SUCCEED("built without COMPRESSION_INSTRUMENTATION");
+        return;
+    }
+    Instrumentation::Counters outer;
+    Instrumentation::Counters inner;
+    {
+        Instrumentation::Scope scope(outer);
+        std::vector<char> bytes(1000);
+        Instrumentation::recordCopy(bytes.size());
+        {
+            Instrumentation::Scope nested(inner);
+            std::vector<char> more(24);
+        }
+        Instrumentation::recordCopy(1);
+    }
+    Instrumentation::recordCopy(5); // no scope: process totals only
+
+    const Instrumentation::Snapshot o = outer.snapshot();
+    REQUIRE(o.allocations == 1);
+    REQUIRE(o.allocatedBytes == 1000);
+    REQUIRE(o.copiedBytes == 1001);
+    const Instrumentation::Snapshot i = inner.snapshot();
+    REQUIRE(i.allocations == 1);
+    REQUIRE(i.allocatedBytes == 24);
+    REQUIRE(i.copiedBytes == 0);
+}
+
+TEST_CASE("POST /compress stays within its allocation and copy budget", "[instrumentation]") {
+    if (!Instrumentation::enabled()) {
+        SUCCEED("built without COMPRESSION_INSTRUMENTATION");
+        return;
+    }
+    CompressionApi api(0); // no cache: every call runs the codec
+    const size_t kBody = 64 * 1024;
+    for (const char* path : {"/compress", "/compress?algorithm=adaptive&level=9"}) {
+        const HttpRequest req = post(path, runs(kBody));
+        Instrumentation::Counters counters;
+        HttpResponse res;
+        {
+            Instrumentation::Scope scope(counters);
+            res = api.handle(req);
+        }
+        REQUIRE(res.statusCode == 200);
+        const Instrumentation::Snapshot s = counters.snapshot();
+        // Budget: a handful of allocations (output, headers, ETag) and at most one copy of
+        // the compressed output; raise these only with a reason.
+        REQUIRE(s.allocations <= 16);
+        REQUIRE(s.allocatedBytes <= 2 * kBody);
+        REQUIRE(s.copiedBytes <= res.bodySize());
+    }
+}
+
+TEST_CASE("GET /debug/allocations reports per-request counts from HttpServer", "[instrumentation][http]") {
+    CompressionApi api(0);
+    HttpServer server(9161, SocketOptions(), HttpServerOptions());
+    server.setHandler([&api](const HttpRequest& req) { return api.handle(req); });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const std::vector<char> payload = runs(4096);
+    const std::string response = sendRaw(9161, "POST /compress HTTP/1.1\r\nContent-Length: 4096\r\n\r\n" +
+                                                    std::string(payload.begin(), payload.end()) +
+                                                    "GET /debug/allocations HTTP/1.1\r\nConnection: close\r\n\r\n");
+    server.stop();
+
+    const size_t last = response.rfind("\r\n\r\n");
+    REQUIRE(last != std::string::npos);
+    const std::string json = response.substr(last + 4);
+    if (!Instrumentation::enabled()) {
+        REQUIRE(json == "{\"enabled\":false}\n");
+        return;
+    }
+    REQUIRE(json.find("\"enabled\":true") != std::string::npos);
+    REQUIRE(json.find("\"per_request_max\":{\"allocations\":") != std::string::npos);
+    REQUIRE(json.find("\"requests\":0") == std::string::npos);
+}
@@ -0,0 +1,108 @@
+#include <catch2/catch_all.hpp>
+#include "AdaptiveCompression.h"
+#include "CompressionApi.h"
+#include "HttpServer.h"
+#include "RequestTrace.h"
+#include "Client.h"
+#include "HttpTestUtil.h"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+// One POST /compress with Connection: close; returns the whole response.
+std::string compressOver(int port, const std::vector<char>& payload) {
+    return sendRaw(port, "POST /compress HTTP/1.1\r\nContent-Length: " + std::to_string(payload.size()) +
+                             "\r\nConnection: close\r\n\r\n" + std::string(payload.begin(), payload.end()));
+}
+} // namespace
+
+TEST_CASE("RequestTrace timers record only into an installed trace", "[trace]") {
+    {
+        RequestTrace::Timer unattached(RequestTrace::Phase::Codec); // no trace: nothing to do
+    }
+    REQUIRE(RequestTrace::current() == nullptr);
+
+    RequestTrace trace;
+    {
+        RequestTrace::Scope scope(&trace);
+        REQUIRE(RequestTrace::current() == &trace);
+        AdaptiveCompression adaptive;
+        const std::vector<char> data = runs(256 * 1024);
+        (void)adaptive.compress(data);
+        RequestTrace::record(RequestTrace::Phase::Send, std::chrono::microseconds(1500));
+        {
+            RequestTrace::Scope off(nullptr);
+            RequestTrace::record(RequestTrace::Phase::Send, std::chrono::seconds(1));
+        }
+    }
+    REQUIRE(RequestTrace::current() == nullptr);
+
+    REQUIRE(trace.get(RequestTrace::Phase::Decide) > RequestTrace::Clock::duration::zero());
+    REQUIRE(trace.get(RequestTrace::Phase::Send) == std::chrono::microseconds(1500));
+    REQUIRE(trace.get(RequestTrace::Phase::Recv) == RequestTrace::Clock::duration::zero());
+
+    const std::string timing = trace.serverTiming();
+    REQUIRE(timing.find("send;dur=1.500, ") != std::string::npos);
+    REQUIRE(timing.find("decide;dur=") != std::string::npos);
+    REQUIRE(timing.find("recv;") == std::string::npos); // phases never entered are left out
+    REQUIRE(timing.find("total;dur=") != std::string::npos);
+
+    const std::string json = trace.json("POST", "/a\"b", 200, 10, 5);
+    REQUIRE(json.rfind("{\"method\":\"POST\",\"path\":\"/a\\\"b\",\"status\":200,\"bytes_in\":10,\"bytes_out\":5,", 0) == 0);
+    REQUIRE(json.find("\"recv_us\":0.000") != std::string::npos);
+    REQUIRE(json.find("\"send_us\":1500.000") != std::string::npos);
+    REQUIRE(json.back() == '}');
+}
+
+TEST_CASE("HttpServer reports request phases in Server-Timing and the trace log", "[trace][http]") {
+    CompressionApi api(0);
+    HttpServerOptions options;
+    options.serverTiming = true;
+    std::mutex linesMutex;
+    std::vector<std::string> lines;
+    options.traceLog = [&](const std::string& line) {
+        std::lock_guard<std::mutex> lock(linesMutex);
+        lines.push_back(line);
+    };
+    HttpServer server(9162, SocketOptions(), options);
+    server.setHandler([&api](const HttpRequest& req) { return api.handle(req); });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const std::string response = compressOver(9162, runs(64 * 1024));
+    server.stop(); // waits for the connection, so its log line is in
+
+    REQUIRE(response.rfind("HTTP/1.1 200 OK\r\n", 0) == 0);
+    const size_t header = response.find("\r\nServer-Timing: ");
+    REQUIRE(header != std::string::npos);
+    const std::string timing = response.substr(header + 17, response.find("\r\n", header + 2) - header - 17);
+    for (const char* phase : {"recv;dur=", "parse;dur=", "body;dur=", "queue;dur=", "hash;dur=", "decide;dur=",
+                              "codec;dur=", "total;dur="}) {
+        REQUIRE(timing.find(phase) != std::string::npos);
+    }
+    REQUIRE(timing.find("send;") == std::string::npos); // still to come when the header is written
+
+    REQUIRE(lines.size() == 1);
+    const std::string& line = lines[0];
+    REQUIRE(line.rfind("{\"method\":\"POST\",\"path\":\"/compress\",\"status\":200,\"bytes_in\":65536,", 0) == 0);
+    REQUIRE(line.find("\"send_us\":") != std::string::npos);
+    REQUIRE(line.find("\"total_us\":") != std::string::npos);
+}
+
+TEST_CASE("HttpServer adds no Server-Timing header by default", "[trace][http]") {
+    CompressionApi api(0);
+    HttpServer server(9163, SocketOptions(), HttpServerOptions());
+    server.setHandler([&api](const HttpRequest& req) { return api.handle(req); });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const std::string response = compressOver(9163, runs(4096));
+    server.stop();
+
+    REQUIRE(response.rfind("HTTP/1.1 200 OK\r\n", 0) == 0);
+    REQUIRE(response.find("Server-Timing:") == std::string::npos);
+}